@@ -55,23 +55,33 @@ $(GEN_NODE): $(LOCAL_JS_FILES) $(JS2C_PY_NODE) $(JSMIN_PY_NODE)
 LOCAL_GENERATED_SOURCES += $(GEN_NODE)
 LOCAL_CPP_EXTENSION := .cc
 LOCAL_SRC_FILES := \
+  src/node_base64.cc \
   src/node_buffer.cc \
   src/node.cc \
   src/node_child_process.cc \
+  src/node_compile_cache.cc \
   src/node_constants.cc \
+  src/node_cpu.cc \
   src/node_extensions.cc \
   src/node_file.cc \
+  src/node_hex.cc \
   src/node_http_parser.cc \
   src/node_io_watcher.cc \
   src/node_javascript.cc \
   src/node_net.cc \
   src/node_os.cc \
+  src/node_read_pool.cc \
   src/node_script.cc \
+  src/node_search.cc \
   src/node_signal_watcher.cc \
+  src/node_slab.cc \
   src/node_stat_watcher.cc \
   src/node_stdio.cc \
   src/node_string.cc \
+  src/node_string_decoder.cc \
   src/node_timer.cc \
+  src/node_trace.cc \
+  src/node_utf8.cc \
   src/timer_wrap.cc \
   src/tcp_wrap.cc \
   src/node_cares.cc \
@@ -86,6 +96,22 @@ LOCAL_SRC_FILES := \
   deps/http_parser/http_parser.c \
   src/dapi_inode.cc
 
+# base64, hex, utf8 and search kernels, NEON is enabled for these files only and picked
+# at runtime
+ifeq ($(TARGET_ARCH),arm)
+LOCAL_SRC_FILES += \
+  src/node_base64_neon.cc.neon \
+  src/node_hex_neon.cc.neon \
+  src/node_utf8_neon.cc.neon \
+  src/node_search_neon.cc.neon
+else
+LOCAL_SRC_FILES += \
+  src/node_base64_neon.cc \
+  src/node_hex_neon.cc \
+  src/node_utf8_neon.cc \
+  src/node_search_neon.cc
+endif
+
 LOCAL_CFLAGS += \
   -Wno-endif-labels \
   -Wno-import \
@@ -0,0 +1,48 @@
+// base64 encode/decode throughput from 64 B to 8 MB, with the vectorized
+// kernels and with the scalar code (NODE_SIMD=0)
+
+var spawn = require('child_process').spawn;
+
+var sizes = [64, 256, 1024, 4096, 16384, 65536, 262144, 1048576,
+             4194304, 8388608];
+var total = 64 * 1024 * 1024; // bytes run through per size
+
+function run() {
+  sizes.forEach(function(size) {
+    var buf = new Buffer(size);
+    for (var i = 0; i < size; i++) buf[i] = i * 7;
+    var str = buf.toString('base64');
+    var iterations = Math.max(1, Math.floor(total / size));
+
+    var start = Date.now();
+    for (var i = 0; i < iterations; i++) buf.toString('base64');
+    var encode = Date.now() - start;
+
+    start = Date.now();
+    for (var i = 0; i < iterations; i++) new Buffer(str, 'base64');
+    var decode = Date.now() - start;
+
+    var mb = size * iterations / (1024 * 1024);
+    console.log('%s %d bytes: encode %d MB/s, decode %d MB/s',
+                process.env.NODE_SIMD === '0' ? 'scalar' : 'simd  ', size,
+                Math.round(mb / (encode / 1000 || 0.001)),
+                Math.round(mb / (decode / 1000 || 0.001)));
+  });
+}
+
+if (process.argv[2] === 'child') {
+  run();
+} else {
+  var env = {};
+  for (var k in process.env) env[k] = process.env[k];
+
+  function child(simd, cb) {
+    env.NODE_SIMD = simd ? '1' : '0';
+    var node = spawn(process.execPath, [__filename, 'child'], { env: env });
+    node.stdout.pipe(process.stdout);
+    node.on('exit', cb);
+  }
+  child(false, function() {
+    child(true, function() {});
+  });
+}
@@ -0,0 +1,37 @@
+// Buffer search, native indexOf against the byte by byte JS loops it
+// replaces, for a single byte (line splitting), a multipart boundary and a
+// long needle. Run with NODE_SIMD=0 for the scalar native code
+
+var size = 1024 * 1024;
+var iterations = 64;
+
+var hay = new Buffer(size);
+var text = 'Content-Disposition: form-data; name="file"\r\n--\r\n';
+for (var i = 0; i < size; i++) hay[i] = text.charCodeAt(i % text.length);
+
+function jsIndexOf(buf, needle) {
+  var first = needle[0];
+  for (var i = 0, end = buf.length - needle.length; i <= end; i++) {
+    if (buf[i] !== first) continue;
+    for (var j = 1; j < needle.length && buf[i + j] === needle[j]; j++);
+    if (j === needle.length) return i;
+  }
+  return -1;
+}
+
+function time(fn) {
+  var start = Date.now();
+  for (var i = 0; i < iterations; i++) fn();
+  var ms = Date.now() - start;
+  return Math.round(size * iterations / (1024 * 1024) / (ms / 1000 || 0.001));
+}
+
+[new Buffer([0]),
+ new Buffer('\r\n--frontier'),
+ new Buffer('\r\n------WebKitFormBoundary7MA4YWxkTrZu0gW--')].forEach(function(needle) {
+  var nativeMBs = time(function() { hay.indexOf(needle); });
+  var jsMBs = time(function() { jsIndexOf(hay, needle); });
+  console.log('%s %d byte needle: native %d MB/s, js %d MB/s',
+              process.env.NODE_SIMD === '0' ? 'scalar' : 'simd  ',
+              needle.length, nativeMBs, jsMBs);
+});
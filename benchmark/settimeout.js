@@ -1,15 +1,21 @@
+// NODE_TIMERS=timers_uv runs it on the timer wheel, an argument spreads
+// the timeouts over that many distinct values
+var timers = require(process.env.NODE_TIMERS || 'timers');
+var jitter = parseInt(process.argv[2], 10) || 1;
+
 console.log("wait...");
 var done = 0;
 var N = 5000000;
 var begin = new Date();
 for (var i = 0; i < N; i++) {
-  setTimeout(function () {
+  timers.setTimeout(function () {
     if (++done == N) {
       var end = new Date();
       console.log("smaller is better");
       console.log("startup: %d", start - begin);
       console.log("done: %d", end - start);
+      if (timers.wheelStats) console.log(timers.wheelStats());
     }
-  }, 1000);
+  }, 1000 + i % jitter);
 }
 var start = new Date();
@@ -1,26 +1,69 @@
+// Startup time, with and without the shared native scripts (NODE_NATIVE_CACHE)
+//
+//   shell:   spawns the node/qnode binary (argv[2], default this one) to run
+//            an empty file, each process bootstraps a single node instance
+//   browser: node instances created and deleted in one process the way the
+//            browser does for every page, startup_bootstrap.js runs
+//            test.bootstrap() (qnode only runs module files, there is no -e)
+
 var spawn = require('child_process').spawn,
     path = require('path'),
     emptyJsFile = path.join(__dirname, '../test/fixtures/semicolon.js'),
+    bootstrapJsFile = path.join(__dirname, 'startup_bootstrap.js'),
+    execPath = process.argv[2] || process.execPath || process.argv[0],
     starts = 100,
-    i = 0,
-    start;
+    instances = 50;
+
+function env(nativeCache) {
+  var e = {};
+  for (var k in process.env) e[k] = process.env[k];
+  e.NODE_NATIVE_CACHE = nativeCache ? '1' : '0';
+  e.BOOTSTRAP_INSTANCES = String(instances);
+  return e;
+}
+
+function shell(nativeCache, cb) {
+  var i = 0, start = +new Date;
+
+  function startNode() {
+    var node = spawn(execPath, [emptyJsFile], { env: env(nativeCache) });
+    node.on('exit', function(exitCode) {
+      if (exitCode !== 0) {
+        throw new Error('Error during node startup');
+      }
 
-function startNode() {
-  var node = spawn(process.execPath || process.argv[0], [emptyJsFile]);
+      i++;
+      if (i < starts) {
+        startNode();
+      } else {
+        var duration = +new Date - start;
+        console.log('shell,   native cache %s: started node %d times in %s ms. %d ms / start.',
+                    nativeCache ? 'on ' : 'off', starts, duration, duration / starts);
+        cb();
+      }
+    });
+  }
+  startNode();
+}
+
+function browser(nativeCache, cb) {
+  var node = spawn(execPath, [bootstrapJsFile], { env: env(nativeCache) });
+  var out = '';
+  node.stdout.on('data', function(d) { out += d; });
   node.on('exit', function(exitCode) {
     if (exitCode !== 0) {
       throw new Error('Error during node startup');
     }
-
-    i++;
-    if (i < starts) {
-      startNode();
-    } else{
-      var duration = +new Date - start;
-      console.log('Started node %d times in %s ms. %d ms / start.', starts, duration, duration / starts);
-    }
+    console.log('browser, native cache %s: bootstrapped %d node instances, %s ms / instance.',
+                nativeCache ? 'on ' : 'off', instances, parseFloat(out).toFixed(2));
+    cb();
   });
 }
 
-start = +new Date;
-startNode();
+shell(false, function() {
+  shell(true, function() {
+    browser(false, function() {
+      browser(true, function() {});
+    });
+  });
+});
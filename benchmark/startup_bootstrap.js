@@ -0,0 +1,3 @@
+// Run by startup.js: prints the average time in ms to bootstrap a node
+// instance created and deleted in-process, BOOTSTRAP_INSTANCES times
+console.log(test.bootstrap(parseInt(process.env.BOOTSTRAP_INSTANCES, 10) || 50));
@@ -1,4 +1,9 @@
 var http = require("http");
+var fs = require("fs");
+
+// with a file argument the body is piped from it, which goes through
+// socket.sendFile() on sockets that have it
+var file = process.argv[2];
 
 var concurrency = 30;
 var port = 12346;
@@ -14,6 +19,11 @@ for (var i = 0; i < bytes; i++) {
 }
 
 var server = http.createServer(function (req, res) {
+  if (file) {
+    res.writeHead(200, { "Content-Type": "application/octet-stream" });
+    fs.createReadStream(file).pipe(res);
+    return;
+  }
   res.writeHead(200, {
     "Content-Type": "text/plain",
     "Content-Length": body.length
@@ -1,5 +1,8 @@
+// NODE_TIMERS=timers_uv runs it on the timer wheel
+var timers = require(process.env.NODE_TIMERS || 'timers');
+
 function next (i) {
   if (i <= 0) return;
-  setTimeout(function () { next(i-1); }, 1);
+  timers.setTimeout(function () { next(i-1); }, 1);
 }
 next(700);
@@ -42,9 +42,20 @@ else()
 endif()
 
 set(node_sources
-  src/node_main.cc
+  src/main.cc
   src/node.cc
   src/node_buffer.cc
+  src/node_slab.cc
+  src/node_read_pool.cc
+  src/node_base64.cc
+  src/node_base64_neon.cc
+  src/node_hex.cc
+  src/node_hex_neon.cc
+  src/node_utf8.cc
+  src/node_utf8_neon.cc
+  src/node_search.cc
+  src/node_search_neon.cc
+  src/node_cpu.cc
   src/node_javascript.cc
   src/node_extensions.cc
   src/node_http_parser.cc
@@ -59,8 +70,11 @@ set(node_sources
   src/node_stat_watcher.cc
   src/node_stdio.cc
   src/node_timer.cc
+  src/node_trace.cc
   src/node_script.cc
+  src/node_compile_cache.cc
   src/node_os.cc
+  src/node_string_decoder.cc
   src/node_dtrace.cc
   src/node_string.cc
   src/node_natives.h
@@ -83,6 +97,8 @@ configure_file(config.h.cmake ${PROJECT_BINARY_DIR}/config.h)
 
 include_directories(
   src
+  include
+  include/module
   deps/libeio
   deps/http_parser
   ${V8_INCLUDE_DIR}
@@ -47,13 +47,17 @@ typedef struct {
   ngx_queue_t queue; \
   uv_buf_t* bufs; \
   int bufcnt; \
-  uv_buf_t bufsml[UV_REQ_BUFSML_SIZE];
+  uv_buf_t bufsml[UV_REQ_BUFSML_SIZE]; \
+  int sendfile_fd; \
+  off_t sendfile_offset; \
+  size_t sendfile_length;
 
 
 /* TODO: union or classes please! */
 #define UV_HANDLE_PRIVATE_FIELDS \
   int fd; \
   int flags; \
+  struct ev_loop* loop; \
   ev_idle next_watcher;
 
 
@@ -71,6 +75,7 @@ typedef struct {
   uv_req_t *shutdown_req; \
   ev_io read_watcher; \
   ev_io write_watcher; \
+  ev_timer accept_timer; \
   ngx_queue_t write_queue; \
   ngx_queue_t write_completed_queue;
 
@@ -117,4 +122,24 @@ typedef struct {
   struct addrinfo* res; \
   int retcode;
 
+
+/* Connections shed at most per EMFILE, see uv_accept_shed() */
+#define UV_ACCEPT_SHED_MAX 64
+
+/*
+ * Accepts a connection on the non-blocking listening socket fd, with
+ * accept4() where the kernel has it. The new fd is non-blocking and
+ * close-on-exec. Returns -1 and sets errno like accept().
+ */
+int uv_accept_fd(int fd, struct sockaddr* addr, socklen_t* addrlen);
+
+/*
+ * Call when uv_accept_fd() fails with EMFILE or ENFILE. Frees the fd kept
+ * in reserve to accept and close up to UV_ACCEPT_SHED_MAX pending
+ * connections, so that the listener doesn't spin on them. Returns the
+ * number closed or -1 if there was no reserve fd; in both cases the
+ * listener should be paused if it may still have connections pending.
+ */
+int uv_accept_shed(int fd);
+
 #endif /* UV_UNIX_H */
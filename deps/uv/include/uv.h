@@ -266,6 +266,13 @@ int uv_read_stop(uv_stream_t*);
  */
 int uv_write(uv_req_t* req, uv_buf_t bufs[], int bufcnt);
 
+/* Queues length bytes of the file in_fd from offset to be written, in order
+ * with the writes before and after it. The data goes from the file to the
+ * socket with sendfile(2) where it can, otherwise through a small buffer.
+ * Completes like uv_write; in_fd must stay open until then.
+ */
+int uv_sendfile(uv_req_t* req, int in_fd, int64_t offset, size_t length);
+
 
 /*
  * A subclass of uv_stream_t representing a TCP stream or TCP server. In the
@@ -445,6 +452,16 @@ void uv_unref();
 void uv_update_time();
 int64_t uv_now();
 
+/*
+ * proteus: Handles are bound to the loop that is current when they are
+ * initialized; uv_ref/uv_unref/uv_now operate on the current loop. The
+ * callback lets the embedder pick the loop (e.g. one per script context),
+ * returning NULL selects the default loop.
+ */
+struct ev_loop;
+void uv_set_loop_cb(struct ev_loop* (*cb)(void));
+struct ev_loop* uv_current_loop();
+
 
 /* Utility */
 struct sockaddr_in uv_ip4_addr(const char* ip, int port);
@@ -491,6 +508,22 @@ typedef struct {
 
 uv_counters_t* uv_counters();
 
+/* Listener counters, for uv_tcp_listen() and node's legacy net. */
+typedef struct {
+  uint64_t wakeups;     /* listener readiness events */
+  uint64_t accepted;    /* connections accepted */
+  uint64_t batch[5];    /* wakeups by connections accepted: 0, 1, 2-3, 4-15, 16+ */
+  uint64_t max_batch;   /* most connections accepted in one wakeup */
+  uint64_t emfile;      /* accepts that ran out of file descriptors */
+  uint64_t rejected;    /* connections closed right away to get out of it */
+  uint64_t paused;      /* times the listener was paused instead */
+} uv_accept_stats_t;
+
+uv_accept_stats_t* uv_accept_stats();
+
+/* Counts a wakeup of a listener that accepted n connections. */
+void uv_accept_stats_add(int n);
+
 #ifdef __cplusplus
 }
 #endif
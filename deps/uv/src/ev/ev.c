@@ -2155,6 +2155,46 @@ ev_invoke_pending (EV_P)
       }
 }
 
+/* proteus: same as ev_invoke_pending, but checks expired_cb after every */
+/* callback and returns early, leaving the remaining watchers pending */
+void noinline
+ev_invoke_pending_until (EV_P_ int (*expired_cb)(EV_P))
+{
+  int pri;
+
+  for (pri = NUMPRI; pri--; )
+    while (pendingcnt [pri])
+      {
+        ANPENDING *p = pendings [pri] + --pendingcnt [pri];
+
+        p->w->pending = 0;
+        EV_CB_INVOKE (p->w, p->events);
+        EV_FREQUENT_CHECK;
+
+        if (expired_cb (EV_A))
+          return;
+      }
+}
+
+/* proteus: hands every pending watcher to collect_cb instead of invoking */
+/* it, in the same order ev_invoke_pending would. Used to run the callbacks */
+/* on a different thread than the one running the loop */
+void noinline
+ev_collect_pending (EV_P_ void (*collect_cb)(EV_P_ void *w, int revents))
+{
+  int pri;
+
+  for (pri = NUMPRI; pri--; )
+    while (pendingcnt [pri])
+      {
+        ANPENDING *p = pendings [pri] + --pendingcnt [pri];
+
+        p->w->pending = 0;
+        if (p->w != (W)&pending_w)
+          collect_cb (EV_A_ p->w, p->events);
+      }
+}
+
 #if EV_IDLE_ENABLE
 /* make idle watchers pending. this handles the "call-idle */
 /* only when higher priorities are idle" logic */
@@ -2620,6 +2660,9 @@ wlist_del (WL *head, WL elem)
 inline_speed void
 clear_pending (EV_P_ W w)
 {
+  // proteus:
+  on_ev_cancel(NODE_EV_LOOP, w);
+
   if (w->pending)
     {
       pendings [ABSPRI (w)][w->pending - 1].w = (W)&pending_w;
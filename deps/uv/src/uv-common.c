@@ -45,6 +45,24 @@ uv_counters_t* uv_counters() {
 }
 
 
+static uv_accept_stats_t accept_stats;
+
+
+uv_accept_stats_t* uv_accept_stats() {
+  return &accept_stats;
+}
+
+
+void uv_accept_stats_add(int n) {
+  accept_stats.wakeups++;
+  accept_stats.accepted += n;
+  accept_stats.batch[n == 0 ? 0 : n == 1 ? 1 : n < 4 ? 2 : n < 16 ? 3 : 4]++;
+  if ((uint64_t) n > accept_stats.max_batch) {
+    accept_stats.max_batch = n;
+  }
+}
+
+
 const char* uv_err_name(uv_err_t err) {
   switch (err.code) {
     case UV_UNKNOWN: return "UNKNOWN";
@@ -35,6 +35,11 @@
 #include <arpa/inet.h>
 #include <limits.h> /* PATH_MAX */
 
+#if defined(__linux__)
+#include <sys/syscall.h> /* __NR_accept4 */
+#include <sys/sendfile.h>
+#endif
+
 #if defined(__APPLE__)
 #include <mach-o/dyld.h> /* _NSGetExecutablePath */
 #endif
@@ -60,8 +65,23 @@ struct uv_ares_data_s {
 
 static struct uv_ares_data_s ares_data;
 
+/* proteus: handles are bound to the loop that was current when they were
+ * initialized, see uv_set_loop_cb(). */
+static struct ev_loop* (*uv__loop_cb)(void);
+
+#if EV_MULTIPLICITY
+# define UV_LOOP_(h) (h)->loop,
+# define UV_LOOP(h) (h)->loop
+# define UV_CURRENT_LOOP uv_current_loop()
+#else
+# define UV_LOOP_(h)
+# define UV_LOOP(h)
+# define UV_CURRENT_LOOP
+#endif
+
 
 void uv__tcp_io(EV_P_ ev_io* watcher, int revents);
+static void uv__server_resume(EV_P_ ev_timer* timer, int revents);
 void uv__next(EV_P_ ev_idle* watcher, int revents);
 static void uv__tcp_connect(uv_tcp_t*);
 int uv_tcp_open(uv_tcp_t*, int fd);
@@ -171,8 +191,8 @@ int uv_close(uv_handle_t* handle, uv_close_cb close_cb) {
   switch (handle->type) {
     case UV_TCP:
       tcp = (uv_tcp_t*) handle;
-      ev_io_stop(EV_DEFAULT_ &tcp->write_watcher);
-      ev_io_stop(EV_DEFAULT_ &tcp->read_watcher);
+      ev_io_stop(UV_LOOP_(handle) &tcp->write_watcher);
+      ev_io_stop(UV_LOOP_(handle) &tcp->read_watcher);
       break;
 
     case UV_PREPARE:
@@ -189,16 +209,16 @@ int uv_close(uv_handle_t* handle, uv_close_cb close_cb) {
 
     case UV_ASYNC:
       async = (uv_async_t*)handle;
-      ev_async_stop(EV_DEFAULT_ &async->async_watcher);
-      ev_ref(EV_DEFAULT_UC);
+      ev_async_stop(UV_LOOP_(handle) &async->async_watcher);
+      ev_ref(UV_LOOP(handle));
       break;
 
     case UV_TIMER:
       timer = (uv_timer_t*)handle;
       if (ev_is_active(&timer->timer_watcher)) {
-        ev_ref(EV_DEFAULT_UC);
+        ev_ref(UV_LOOP(handle));
       }
-      ev_timer_stop(EV_DEFAULT_ &timer->timer_watcher);
+      ev_timer_stop(UV_LOOP_(handle) &timer->timer_watcher);
       break;
 
     default:
@@ -209,8 +229,8 @@ int uv_close(uv_handle_t* handle, uv_close_cb close_cb) {
   uv_flag_set(handle, UV_CLOSING);
 
   /* This is used to call the on_close callback in the next loop. */
-  ev_idle_start(EV_DEFAULT_ &handle->next_watcher);
-  ev_feed_event(EV_DEFAULT_ &handle->next_watcher, EV_IDLE);
+  ev_idle_start(UV_LOOP_(handle) &handle->next_watcher);
+  ev_feed_event(UV_LOOP_(handle) &handle->next_watcher, EV_IDLE);
   assert(ev_is_pending(&handle->next_watcher));
 
   return 0;
@@ -233,17 +253,33 @@ int uv_run() {
 }
 
 
+void uv_set_loop_cb(struct ev_loop* (*cb)(void)) {
+  uv__loop_cb = cb;
+}
+
+
+struct ev_loop* uv_current_loop() {
+#if EV_MULTIPLICITY
+  struct ev_loop* loop = uv__loop_cb ? uv__loop_cb() : NULL;
+  return loop ? loop : ev_default_loop(0);
+#else
+  return NULL;
+#endif
+}
+
+
 static void uv__handle_init(uv_handle_t* handle, uv_handle_type type) {
   uv_counters()->handle_init++;
 
   handle->type = type;
   handle->flags = 0;
+  handle->loop = uv_current_loop();
 
   ev_init(&handle->next_watcher, uv__next);
   handle->next_watcher.data = handle;
 
   /* Ref the loop until this handle is closed. See uv__finish_close. */
-  ev_ref(EV_DEFAULT_UC);
+  ev_ref(UV_LOOP(handle));
 }
 
 
@@ -266,6 +302,9 @@ int uv_tcp_init(uv_tcp_t* tcp) {
   ev_init(&tcp->write_watcher, uv__tcp_io);
   tcp->write_watcher.data = tcp;
 
+  ev_init(&tcp->accept_timer, uv__server_resume);
+  tcp->accept_timer.data = tcp;
+
   assert(ngx_queue_empty(&tcp->write_queue));
   assert(ngx_queue_empty(&tcp->write_completed_queue));
   assert(tcp->write_queue_size == 0);
@@ -363,10 +402,115 @@ int uv_tcp_open(uv_tcp_t* tcp, int fd) {
 }
 
 
+/* An fd held so that there is one to free when we run out of them. */
+static int uv__reserve_fd = -1;
+
+/* Set when the kernel turns out not to have accept4(). */
+static int uv__no_accept4 = 0;
+
+
+static void uv__reserve() {
+  if (uv__reserve_fd < 0) {
+    uv__reserve_fd = open("/dev/null", O_RDONLY);
+    if (uv__reserve_fd >= 0) {
+      fcntl(uv__reserve_fd, F_SETFD, FD_CLOEXEC);
+    }
+  }
+}
+
+
+int uv_accept_fd(int fd, struct sockaddr* addr, socklen_t* addrlen) {
+  int peerfd;
+  int saved_errno;
+
+  /* Taken now, out of fds it is too late. */
+  uv__reserve();
+
+#if defined(__linux__) && defined(__NR_accept4) && defined(SOCK_CLOEXEC)
+  if (!uv__no_accept4) {
+    peerfd = syscall(__NR_accept4, fd, addr, addrlen,
+                     SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (peerfd >= 0 || errno != ENOSYS) {
+      return peerfd;
+    }
+    uv__no_accept4 = 1;
+  }
+#endif
+
+  peerfd = accept(fd, addr, addrlen);
+
+  if (peerfd >= 0) {
+    if (fcntl(peerfd, F_SETFD, FD_CLOEXEC) == -1 ||
+        fcntl(peerfd, F_SETFL, O_NONBLOCK) == -1) {
+      saved_errno = errno;
+      close(peerfd);
+      errno = saved_errno;
+      return -1;
+    }
+  }
+
+  return peerfd;
+}
+
+
+int uv_accept_shed(int fd) {
+  int peerfd;
+  int n = 0;
+
+  uv_accept_stats()->emfile++;
+
+  if (uv__reserve_fd < 0) {
+    return -1;
+  }
+
+  close(uv__reserve_fd);
+  uv__reserve_fd = -1;
+
+  while (n < UV_ACCEPT_SHED_MAX) {
+    peerfd = accept(fd, NULL, NULL);
+    if (peerfd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      break;
+    }
+    close(peerfd);
+    n++;
+  }
+
+  uv__reserve();
+  uv_accept_stats()->rejected += n;
+
+  return n;
+}
+
+
+static void uv__server_resume(EV_P_ ev_timer* timer, int revents) {
+  uv_tcp_t* tcp = timer->data;
+
+  assert(timer == &tcp->accept_timer);
+
+  if (!uv_flag_is_set((uv_handle_t*)tcp, UV_CLOSING) &&
+      tcp->accepted_fd < 0) {
+    ev_io_start(UV_LOOP_(tcp) &tcp->read_watcher);
+  }
+}
+
+
+/* Stops accepting for a while, when out of fds and unable to shed the
+ * pending connections. */
+static void uv__server_pause(uv_tcp_t* tcp) {
+  uv_accept_stats()->paused++;
+  ev_io_stop(UV_LOOP_(tcp) &tcp->read_watcher);
+  ev_timer_set(&tcp->accept_timer, 1., 0.);
+  ev_timer_start(UV_LOOP_(tcp) &tcp->accept_timer);
+}
+
+
 void uv__server_io(EV_P_ ev_io* watcher, int revents) {
   int fd;
+  int n;
+  int accepted = 0;
   struct sockaddr_storage addr;
-  socklen_t addrlen = sizeof(struct sockaddr_storage);
+  socklen_t addrlen;
   uv_tcp_t* tcp = watcher->data;
 
   assert(watcher == &tcp->read_watcher ||
@@ -376,36 +520,47 @@ void uv__server_io(EV_P_ ev_io* watcher, int revents) {
   assert(!uv_flag_is_set((uv_handle_t*)tcp, UV_CLOSING));
 
   if (tcp->accepted_fd >= 0) {
-    ev_io_stop(EV_DEFAULT_ &tcp->read_watcher);
+    ev_io_stop(UV_LOOP_(tcp) &tcp->read_watcher);
     return;
   }
 
-  while (1) {
+  /* Drain the backlog, handing each connection to the user in turn. */
+  while (!uv_flag_is_set((uv_handle_t*)tcp, UV_CLOSING)) {
     assert(tcp->accepted_fd < 0);
-    fd = accept(tcp->fd, (struct sockaddr*)&addr, &addrlen);
+    addrlen = sizeof(struct sockaddr_storage);
+    fd = uv_accept_fd(tcp->fd, (struct sockaddr*)&addr, &addrlen);
 
     if (fd < 0) {
-      if (errno == EAGAIN) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
         /* No problem. */
-        return;
-      } else if (errno == EMFILE) {
-        /* TODO special trick. unlock reserved socket, accept, close. */
-        return;
+        break;
+      } else if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      } else if (errno == EMFILE || errno == ENFILE) {
+        n = uv_accept_shed(tcp->fd);
+        if (n < 0 || n == UV_ACCEPT_SHED_MAX) {
+          uv__server_pause(tcp);
+        }
+        break;
       } else {
         uv_err_new((uv_handle_t*)tcp, errno);
         tcp->connection_cb((uv_handle_t*)tcp, -1);
+        break;
       }
 
     } else {
+      accepted++;
       tcp->accepted_fd = fd;
       tcp->connection_cb((uv_handle_t*)tcp, 0);
       if (tcp->accepted_fd >= 0) {
         /* The user hasn't yet accepted called uv_accept() */
-        ev_io_stop(EV_DEFAULT_ &tcp->read_watcher);
-        return;
+        ev_io_stop(UV_LOOP_(tcp) &tcp->read_watcher);
+        break;
       }
     }
   }
+
+  uv_accept_stats_add(accepted);
 }
 
 
@@ -420,12 +575,12 @@ int uv_accept(uv_handle_t* server, uv_stream_t* client) {
 
   if (uv_tcp_open(tcpClient, tcpServer->accepted_fd)) {
     /* Ignore error for now */
-    tcpServer->accepted_fd = -1;
     close(tcpServer->accepted_fd);
+    tcpServer->accepted_fd = -1;
     return -1;
   } else {
     tcpServer->accepted_fd = -1;
-    ev_io_start(EV_DEFAULT_ &tcpServer->read_watcher);
+    ev_io_start(UV_LOOP_(tcpServer) &tcpServer->read_watcher);
     return 0;
   }
 }
@@ -452,7 +607,7 @@ int uv_tcp_listen(uv_tcp_t* tcp, int backlog, uv_connection_cb cb) {
   /* Start listening for connections. */
   ev_io_set(&tcp->read_watcher, tcp->fd, EV_READ);
   ev_set_cb(&tcp->read_watcher, uv__server_io);
-  ev_io_start(EV_DEFAULT_ &tcp->read_watcher);
+  ev_io_start(UV_LOOP_(tcp) &tcp->read_watcher);
 
   return 0;
 }
@@ -471,8 +626,9 @@ void uv__finish_close(uv_handle_t* handle) {
        * supposed to be stopped in uv_close()?
        */
       tcp = (uv_tcp_t*)handle;
-      ev_io_stop(EV_DEFAULT_ &tcp->write_watcher);
-      ev_io_stop(EV_DEFAULT_ &tcp->read_watcher);
+      ev_io_stop(UV_LOOP_(tcp) &tcp->write_watcher);
+      ev_io_stop(UV_LOOP_(tcp) &tcp->read_watcher);
+      ev_timer_stop(UV_LOOP_(tcp) &tcp->accept_timer);
 
       assert(!ev_is_active(&tcp->read_watcher));
       assert(!ev_is_active(&tcp->write_watcher));
@@ -511,13 +667,13 @@ void uv__finish_close(uv_handle_t* handle) {
       break;
   }
 
-  ev_idle_stop(EV_DEFAULT_ &handle->next_watcher);
+  ev_idle_stop(UV_LOOP_(handle) &handle->next_watcher);
 
   if (handle->close_cb) {
     handle->close_cb(handle);
   }
 
-  ev_unref(EV_DEFAULT_UC);
+  ev_unref(UV_LOOP(handle));
 }
 
 
@@ -561,7 +717,7 @@ static void uv__drain(uv_tcp_t* tcp) {
   assert(!uv_write_queue_head(tcp));
   assert(tcp->write_queue_size == 0);
 
-  ev_io_stop(EV_DEFAULT_ &tcp->write_watcher);
+  ev_io_stop(UV_LOOP_(tcp) &tcp->write_watcher);
 
   /* Shutdown? */
   if (uv_flag_is_set((uv_handle_t*)tcp, UV_SHUTTING) &&
@@ -585,6 +741,101 @@ static void uv__drain(uv_tcp_t* tcp) {
 }
 
 
+/* Moves a finished request to write_completed_queue, where it will have
+ * its callback called in the near future.
+ */
+static void uv__write_done(uv_tcp_t* tcp, uv_req_t* req) {
+  /* Pop the req off tcp->write_queue. */
+  ngx_queue_remove(&req->queue);
+  if (req->bufs != req->bufsml) {
+    free(req->bufs);
+  }
+  req->bufs = NULL;
+
+  /* TODO: start trying to write the next request. */
+  ngx_queue_insert_tail(&tcp->write_completed_queue, &req->queue);
+  ev_feed_event(UV_LOOP_(tcp) &tcp->write_watcher, EV_WRITE);
+}
+
+
+/* Copies from the file of a uv_sendfile request to the socket. Returns what
+ * was written, 0 at the end of the file, or -1 with errno set.
+ */
+static ssize_t uv__sendfile(uv_tcp_t* tcp, uv_req_t* req) {
+  char buf[16 * 1024];
+  size_t len = req->sendfile_length;
+  ssize_t n;
+
+#if defined(__linux__)
+  off_t offset = req->sendfile_offset;
+
+  n = sendfile(tcp->fd, req->sendfile_fd, &offset, len);
+  if (n >= 0 || (errno != EINVAL && errno != ENOSYS)) {
+    return n;
+  }
+  /* Not a file sendfile can map, read and write it instead. */
+#endif
+
+  if (len > sizeof(buf)) {
+    len = sizeof(buf);
+  }
+
+  do {
+    n = pread(req->sendfile_fd, buf, len, req->sendfile_offset);
+  } while (n < 0 && errno == EINTR);
+
+  if (n <= 0) {
+    return n;
+  }
+
+  /* What the socket doesn't take is read again next time. */
+  return write(tcp->fd, buf, n);
+}
+
+
+static uv_req_t* uv__write_file(uv_tcp_t* tcp, uv_req_t* req) {
+  ssize_t n;
+
+  if (req->sendfile_length == 0) {
+    uv__write_done(tcp, req);
+    return NULL;
+  }
+
+  n = uv__sendfile(tcp, req);
+
+  if (n < 0) {
+    if (errno != EAGAIN && errno != EINTR) {
+      /* Error */
+      uv_err_new((uv_handle_t*)tcp, errno);
+      return req;
+    }
+  } else {
+    if (n == 0) {
+      /* The file ended before the range did, the peer was promised more
+       * than it will get (e.g. a Content-Length), fail the request.
+       */
+      uv_err_new_artificial((uv_handle_t*)tcp, UV_EOF);
+      return req;
+    }
+
+    req->sendfile_offset += n;
+    req->sendfile_length -= n;
+    assert(tcp->write_queue_size >= (size_t) n);
+    tcp->write_queue_size -= n;
+
+    if (req->sendfile_length == 0) {
+      uv__write_done(tcp, req);
+      return NULL;
+    }
+  }
+
+  /* We're not done. Wait for the socket to take more. */
+  ev_io_start(UV_LOOP_(tcp) &tcp->write_watcher);
+
+  return NULL;
+}
+
+
 /* On success returns NULL. On error returns a pointer to the write request
  * which had the error.
  */
@@ -607,6 +858,10 @@ static uv_req_t* uv__write(uv_tcp_t* tcp) {
 
   assert(req->handle == (uv_handle_t*)tcp);
 
+  if (req->sendfile_fd >= 0) {
+    return uv__write_file(tcp, req);
+  }
+
   /* Cast to iovec. We had to have our own uv_buf_t instead of iovec
    * because Windows's WSABUF is not an iovec.
    */
@@ -665,19 +920,7 @@ static uv_req_t* uv__write(uv_tcp_t* tcp) {
           /* Then we're done! */
           assert(n == 0);
 
-          /* Pop the req off tcp->write_queue. */
-          ngx_queue_remove(&req->queue);
-          if (req->bufs != req->bufsml) {
-            free(req->bufs);
-          }
-          req->bufs = NULL;
-
-          /* Add it to the write_completed_queue where it will have its
-           * callback called in the near future.
-           * TODO: start trying to write the next request.
-           */
-          ngx_queue_insert_tail(&tcp->write_completed_queue, &req->queue);
-          ev_feed_event(EV_DEFAULT_ &tcp->write_watcher, EV_WRITE);
+          uv__write_done(tcp, req);
           return NULL;
         }
       }
@@ -688,7 +931,7 @@ static uv_req_t* uv__write(uv_tcp_t* tcp) {
   assert(n == 0 || n == -1);
 
   /* We're not done. */
-  ev_io_start(EV_DEFAULT_ &tcp->write_watcher);
+  ev_io_start(UV_LOOP_(tcp) &tcp->write_watcher);
 
   return NULL;
 }
@@ -750,7 +993,7 @@ void uv__read(uv_tcp_t* tcp) {
       if (errno == EAGAIN) {
         /* Wait for the next one. */
         if (uv_flag_is_set((uv_handle_t*)tcp, UV_READING)) {
-          ev_io_start(EV_DEFAULT_UC_ &tcp->read_watcher);
+          ev_io_start(UV_LOOP_(tcp) &tcp->read_watcher);
         }
         uv_err_new((uv_handle_t*)tcp, EAGAIN);
         tcp->read_cb((uv_stream_t*)tcp, 0, buf);
@@ -765,7 +1008,7 @@ void uv__read(uv_tcp_t* tcp) {
     } else if (nread == 0) {
       /* EOF */
       uv_err_new_artificial((uv_handle_t*)tcp, UV_EOF);
-      ev_io_stop(EV_DEFAULT_UC_ &tcp->read_watcher);
+      ev_io_stop(UV_LOOP_(tcp) &tcp->read_watcher);
       tcp->read_cb((uv_stream_t*)tcp, -1, buf);
       return;
     } else {
@@ -792,7 +1035,7 @@ int uv_shutdown(uv_req_t* req) {
 
   uv_flag_set((uv_handle_t*)tcp, UV_SHUTTING);
 
-  ev_io_start(EV_DEFAULT_UC_ &tcp->write_watcher);
+  ev_io_start(UV_LOOP_(tcp) &tcp->write_watcher);
 
   return 0;
 }
@@ -860,7 +1103,7 @@ static void uv__tcp_connect(uv_tcp_t* tcp) {
   }
 
   if (!error) {
-    ev_io_start(EV_DEFAULT_ &tcp->read_watcher);
+    ev_io_start(UV_LOOP_(tcp) &tcp->read_watcher);
 
     /* Successful connection */
     tcp->connect_req = NULL;
@@ -941,10 +1184,10 @@ static int uv__connect(uv_req_t* req, struct sockaddr* addr,
   }
 
   assert(tcp->write_watcher.data == tcp);
-  ev_io_start(EV_DEFAULT_ &tcp->write_watcher);
+  ev_io_start(UV_LOOP_(tcp) &tcp->write_watcher);
 
   if (tcp->delayed_error) {
-    ev_feed_event(EV_DEFAULT_ &tcp->write_watcher, EV_WRITE);
+    ev_feed_event(UV_LOOP_(tcp) &tcp->write_watcher, EV_WRITE);
   }
 
   return 0;
@@ -977,6 +1220,41 @@ static size_t uv__buf_count(uv_buf_t bufs[], int bufcnt) {
 }
 
 
+/* Starts on a request just added to the write queue. */
+static int uv__write_start(uv_tcp_t* tcp, int empty_queue) {
+  assert(!ngx_queue_empty(&tcp->write_queue));
+  assert(tcp->write_watcher.cb == uv__tcp_io);
+  assert(tcp->write_watcher.data == tcp);
+  assert(tcp->write_watcher.fd == tcp->fd);
+
+  /* If the queue was empty when this function began, we should attempt to
+   * do the write immediately. Otherwise start the write_watcher and wait
+   * for the fd to become writable.
+   */
+  if (empty_queue) {
+    if (uv__write(tcp)) {
+      /* Error. uv_last_error has been set. */
+      return -1;
+    }
+  }
+
+  /* If the queue is now empty - we've flushed the request already. That
+   * means we need to make the callback. The callback can only be done on a
+   * fresh stack so we feed the event loop in order to service it.
+   */
+  if (ngx_queue_empty(&tcp->write_queue)) {
+    ev_feed_event(UV_LOOP_(tcp) &tcp->write_watcher, EV_WRITE);
+  } else {
+    /* Otherwise there is data to write - so we should wait for the file
+     * descriptor to become writable.
+     */
+    ev_io_start(UV_LOOP_(tcp) &tcp->write_watcher);
+  }
+
+  return 0;
+}
+
+
 /* The buffers to be written must remain valid until the callback is called.
  * This is not required for the uv_buf_t array.
  */
@@ -998,6 +1276,7 @@ int uv_write(uv_req_t* req, uv_buf_t bufs[], int bufcnt) {
 
   memcpy(req->bufs, bufs, bufcnt * sizeof(uv_buf_t));
   req->bufcnt = bufcnt;
+  req->sendfile_fd = -1;
 
   // fprintf(stderr, "cnt: %d bufs: %p bufsml: %p\n", bufcnt, req->bufs, req->bufsml);
 
@@ -1007,56 +1286,51 @@ int uv_write(uv_req_t* req, uv_buf_t bufs[], int bufcnt) {
   /* Append the request to write_queue. */
   ngx_queue_insert_tail(&tcp->write_queue, &req->queue);
 
-  assert(!ngx_queue_empty(&tcp->write_queue));
-  assert(tcp->write_watcher.cb == uv__tcp_io);
-  assert(tcp->write_watcher.data == tcp);
-  assert(tcp->write_watcher.fd == tcp->fd);
+  return uv__write_start(tcp, empty_queue);
+}
 
-  /* If the queue was empty when this function began, we should attempt to
-   * do the write immediately. Otherwise start the write_watcher and wait
-   * for the fd to become writable.
-   */
-  if (empty_queue) {
-    if (uv__write(tcp)) {
-      /* Error. uv_last_error has been set. */
-      return -1;
-    }
-  }
 
-  /* If the queue is now empty - we've flushed the request already. That
-   * means we need to make the callback. The callback can only be done on a
-   * fresh stack so we feed the event loop in order to service it.
-   */
-  if (ngx_queue_empty(&tcp->write_queue)) {
-    ev_feed_event(EV_DEFAULT_ &tcp->write_watcher, EV_WRITE);
-  } else {
-    /* Otherwise there is data to write - so we should wait for the file
-     * descriptor to become writable.
-     */
-    ev_io_start(EV_DEFAULT_ &tcp->write_watcher);
-  }
+int uv_sendfile(uv_req_t* req, int in_fd, int64_t offset, size_t length) {
+  uv_tcp_t* tcp = (uv_tcp_t*)req->handle;
+  int empty_queue = (tcp->write_queue_size == 0);
+  assert(tcp->fd >= 0);
+  assert(in_fd >= 0);
 
-  return 0;
+  ngx_queue_init(&req->queue);
+  req->type = UV_WRITE;
+
+  req->bufs = req->bufsml;
+  req->bufcnt = 0;
+  req->write_index = 0;
+  req->sendfile_fd = in_fd;
+  req->sendfile_offset = offset;
+  req->sendfile_length = length;
+  tcp->write_queue_size += length;
+
+  /* Append the request to write_queue. */
+  ngx_queue_insert_tail(&tcp->write_queue, &req->queue);
+
+  return uv__write_start(tcp, empty_queue);
 }
 
 
 void uv_ref() {
-  ev_ref(EV_DEFAULT_UC);
+  ev_ref(UV_CURRENT_LOOP);
 }
 
 
 void uv_unref() {
-  ev_unref(EV_DEFAULT_UC);
+  ev_unref(UV_CURRENT_LOOP);
 }
 
 
 void uv_update_time() {
-  ev_now_update(EV_DEFAULT_UC);
+  ev_now_update(UV_CURRENT_LOOP);
 }
 
 
 int64_t uv_now() {
-  return (int64_t)(ev_now(EV_DEFAULT_UC) * 1000);
+  return (int64_t)(ev_now(UV_CURRENT_LOOP) * 1000);
 }
 
 
@@ -1082,7 +1356,7 @@ int uv_read_start(uv_stream_t* stream, uv_alloc_cb alloc_cb, uv_read_cb read_cb)
   assert(tcp->read_watcher.data == tcp);
   assert(tcp->read_watcher.cb == uv__tcp_io);
 
-  ev_io_start(EV_DEFAULT_UC_ &tcp->read_watcher);
+  ev_io_start(UV_LOOP_(tcp) &tcp->read_watcher);
   return 0;
 }
 
@@ -1092,7 +1366,7 @@ int uv_read_stop(uv_stream_t* stream) {
 
   uv_flag_unset((uv_handle_t*)tcp, UV_READING);
 
-  ev_io_stop(EV_DEFAULT_UC_ &tcp->read_watcher);
+  ev_io_stop(UV_LOOP_(tcp) &tcp->read_watcher);
   tcp->read_cb = NULL;
   tcp->alloc_cb = NULL;
   return 0;
@@ -1136,10 +1410,10 @@ int uv_prepare_start(uv_prepare_t* prepare, uv_prepare_cb cb) {
 
   prepare->prepare_cb = cb;
 
-  ev_prepare_start(EV_DEFAULT_UC_ &prepare->prepare_watcher);
+  ev_prepare_start(UV_LOOP_(prepare) &prepare->prepare_watcher);
 
   if (!was_active) {
-    ev_unref(EV_DEFAULT_UC);
+    ev_unref(UV_LOOP(prepare));
   }
 
   return 0;
@@ -1149,10 +1423,10 @@ int uv_prepare_start(uv_prepare_t* prepare, uv_prepare_cb cb) {
 int uv_prepare_stop(uv_prepare_t* prepare) {
   int was_active = ev_is_active(&prepare->prepare_watcher);
 
-  ev_prepare_stop(EV_DEFAULT_UC_ &prepare->prepare_watcher);
+  ev_prepare_stop(UV_LOOP_(prepare) &prepare->prepare_watcher);
 
   if (was_active) {
-    ev_ref(EV_DEFAULT_UC);
+    ev_ref(UV_LOOP(prepare));
   }
   return 0;
 }
@@ -1186,10 +1460,10 @@ int uv_check_start(uv_check_t* check, uv_check_cb cb) {
 
   check->check_cb = cb;
 
-  ev_check_start(EV_DEFAULT_UC_ &check->check_watcher);
+  ev_check_start(UV_LOOP_(check) &check->check_watcher);
 
   if (!was_active) {
-    ev_unref(EV_DEFAULT_UC);
+    ev_unref(UV_LOOP(check));
   }
 
   return 0;
@@ -1199,10 +1473,10 @@ int uv_check_start(uv_check_t* check, uv_check_cb cb) {
 int uv_check_stop(uv_check_t* check) {
   int was_active = ev_is_active(&check->check_watcher);
 
-  ev_check_stop(EV_DEFAULT_UC_ &check->check_watcher);
+  ev_check_stop(UV_LOOP_(check) &check->check_watcher);
 
   if (was_active) {
-    ev_ref(EV_DEFAULT_UC);
+    ev_ref(UV_LOOP(check));
   }
 
   return 0;
@@ -1236,10 +1510,10 @@ int uv_idle_start(uv_idle_t* idle, uv_idle_cb cb) {
   int was_active = ev_is_active(&idle->idle_watcher);
 
   idle->idle_cb = cb;
-  ev_idle_start(EV_DEFAULT_UC_ &idle->idle_watcher);
+  ev_idle_start(UV_LOOP_(idle) &idle->idle_watcher);
 
   if (!was_active) {
-    ev_unref(EV_DEFAULT_UC);
+    ev_unref(UV_LOOP(idle));
   }
 
   return 0;
@@ -1249,10 +1523,10 @@ int uv_idle_start(uv_idle_t* idle, uv_idle_cb cb) {
 int uv_idle_stop(uv_idle_t* idle) {
   int was_active = ev_is_active(&idle->idle_watcher);
 
-  ev_idle_stop(EV_DEFAULT_UC_ &idle->idle_watcher);
+  ev_idle_stop(UV_LOOP_(idle) &idle->idle_watcher);
 
   if (was_active) {
-    ev_ref(EV_DEFAULT_UC);
+    ev_ref(UV_LOOP(idle));
   }
 
   return 0;
@@ -1298,15 +1572,15 @@ int uv_async_init(uv_async_t* async, uv_async_cb async_cb) {
   async->async_cb = async_cb;
 
   /* Note: This does not have symmetry with the other libev wrappers. */
-  ev_async_start(EV_DEFAULT_UC_ &async->async_watcher);
-  ev_unref(EV_DEFAULT_UC);
+  ev_async_start(UV_LOOP_(async) &async->async_watcher);
+  ev_unref(UV_LOOP(async));
 
   return 0;
 }
 
 
 int uv_async_send(uv_async_t* async) {
-  ev_async_send(EV_DEFAULT_UC_ &async->async_watcher);
+  ev_async_send(UV_LOOP_(async) &async->async_watcher);
   return 0;
 }
 
@@ -1315,7 +1589,7 @@ void uv__timer_cb(EV_P_ ev_timer* w, int revents) {
   uv_timer_t* timer = w->data;
 
   if (!ev_is_active(w)) {
-    ev_ref(EV_DEFAULT_UC);
+    ev_ref(UV_LOOP(timer));
   }
 
   if (timer->timer_cb) {
@@ -1343,18 +1617,18 @@ int uv_timer_start(uv_timer_t* timer, uv_timer_cb cb, int64_t timeout,
 
   timer->timer_cb = cb;
   ev_timer_set(&timer->timer_watcher, timeout / 1000.0, repeat / 1000.0);
-  ev_timer_start(EV_DEFAULT_UC_ &timer->timer_watcher);
-  ev_unref(EV_DEFAULT_UC);
+  ev_timer_start(UV_LOOP_(timer) &timer->timer_watcher);
+  ev_unref(UV_LOOP(timer));
   return 0;
 }
 
 
 int uv_timer_stop(uv_timer_t* timer) {
   if (ev_is_active(&timer->timer_watcher)) {
-    ev_ref(EV_DEFAULT_UC);
+    ev_ref(UV_LOOP(timer));
   }
 
-  ev_timer_stop(EV_DEFAULT_UC_ &timer->timer_watcher);
+  ev_timer_stop(UV_LOOP_(timer) &timer->timer_watcher);
   return 0;
 }
 
@@ -1365,7 +1639,7 @@ int uv_timer_again(uv_timer_t* timer) {
     return -1;
   }
 
-  ev_timer_again(EV_DEFAULT_UC_ &timer->timer_watcher);
+  ev_timer_again(UV_LOOP_(timer) &timer->timer_watcher);
   return 0;
 }
 
@@ -1168,6 +1168,12 @@ static size_t uv_count_bufs(uv_buf_t bufs[], int count) {
 }
 
 
+int uv_sendfile(uv_req_t* req, int in_fd, int64_t offset, size_t length) {
+  uv_set_sys_error(WSAEOPNOTSUPP);
+  return -1;
+}
+
+
 int uv_write(uv_req_t* req, uv_buf_t bufs[], int bufcnt) {
   int result;
   DWORD bytes, err;
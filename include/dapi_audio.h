@@ -48,7 +48,9 @@ class INodeClientAudio {
 
     /**
      * Creates a ArrayBuffer from the raw image data. We use webkit api
-     * currently since node does not have a ArrayBuffer implementation
+     * currently since node does not have a ArrayBuffer implementation.
+     * INodeCore::createSharedBuffer() exposes the result to node as a
+     * Buffer on the same memory
      */
     virtual v8::Handle<v8::Value> createArrayBuffer(void *buf, int size) = 0;
 };
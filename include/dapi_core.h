@@ -30,8 +30,38 @@
 #ifndef DAPI_CORE_H
 #define DAPI_CORE_H
 
+#include <stddef.h>
+
 namespace dapi {
 
+/**
+ * Histogram of event loop samples. Bucket 0 counts samples of 0, bucket i
+ * counts samples in [2^(i-1), 2^i), the last bucket everything above.
+ * Times are in microseconds.
+ */
+struct LoopHistogram {
+  enum { BUCKETS = 16 };
+  unsigned long long count;
+  unsigned long long sum;
+  unsigned long long max;
+  unsigned int buckets[BUCKETS];
+};
+
+/**
+ * Event loop telemetry, aggregated over all the event loops
+ */
+struct LoopStats {
+  // order of LockContext: EV_START, EV_POLL, EV_PENDING, EV_WATCHER
+  enum { LOCK_CONTEXTS = 4 };
+
+  unsigned int loops;                     // loops with a running libev thread
+  LoopHistogram poll;                     // libev thread blocked in the backend poll
+  LoopHistogram lockWait[LOCK_CONTEXTS];  // waiting for a loop mutex (uncontended is 0)
+  LoopHistogram invokePending;            // duration of InvokePending
+  LoopHistogram pendingCallbacks;         // callbacks invoked per InvokePending (a count)
+  LoopHistogram tick;                     // duration of the nextTick callbacks
+};
+
 /**
  * Interface to the node core api
  */
@@ -70,6 +100,37 @@ class INodeCore {
 
     virtual void addWatcherWrap(void* watcherWrap) = 0;
     virtual void removeWatcherWrap(void* watcherWrap) = 0;
+
+    /**
+     * Snapshot of the event loop counters and histograms, same as
+     * process.loopStats() in javascript. These are shared by all the
+     * node instances.
+     */
+    virtual void loopStats(LoopStats* stats) = 0;
+
+    /**
+     * Releases the memory handed to createBuffer(), called on the main
+     * thread once the buffer is collected
+     */
+    typedef void (*FreeCallback)(char* data, void* hint);
+
+    /**
+     * Creates a Buffer (a SlowBuffer in javascript) on data without copying
+     * it. The buffer owns data from now on and releases it through cb, NULL
+     * for memory that outlives the node instance. Use this instead of
+     * copying decoded files or frames into a new buffer.
+     */
+    virtual v8::Handle<v8::Object> createBuffer(char* data, size_t length,
+        FreeCallback cb, void* hint) = 0;
+
+    /**
+     * Creates a Buffer on the backing store of an object with external
+     * array data, e.g. the ArrayBuffer views created by the client
+     * (createArrayBuffer()). The object is kept alive as long as the
+     * buffer, writes through either are seen by the other. Returns an empty
+     * handle if the object has no external array data.
+     */
+    virtual v8::Handle<v8::Object> createSharedBuffer(v8::Handle<v8::Object> backing) = 0;
 };
 
 }
@@ -112,6 +112,42 @@ class DAPIEXPORT INode {
      */
     static void invokePending();
 
+    /**
+     * Same as invokePending, but returns once budgetUs microseconds are spent
+     * in callbacks. Events left over are signalled again through the
+     * InvokePending callback passed to initialize. 0 means no limit.
+     */
+    static void invokePending(unsigned int budgetUs);
+
+    /**
+     * Sets the budget used by invokePending() without arguments, so that an
+     * embedder can bound the time spent per call (e.g. to a frame). Default
+     * is 0, i.e. all pending events are processed.
+     */
+    static void setInvokePendingBudget(unsigned int budgetUs);
+
+    /**
+     * Same as new INode(client), but hands out a spare instance that is
+     * already bootstrapped when one is ready, so the page does not wait for
+     * node to load. Needs to be called in the client context, like the
+     * constructor
+     */
+    static INode* create(INodeClient *client);
+
+    /**
+     * Number of spare instances to keep ready for create(). Spares are built
+     * on the main thread when the event loops are idle, one per
+     * invokePending() call. Default is 0 (no spares) or NODE_SPARE_POOL
+     */
+    static void setSparePoolSize(unsigned int size);
+
+    /**
+     * Invoked by the client under memory pressure (e.g. onTrimMemory),
+     * releases the spare instances. The pool is refilled once idle again,
+     * setSparePoolSize(0) to keep it empty
+     */
+    static void trimMemory();
+
     /**
      * Returns the inode reference stores from the active v8 context/global object
      */
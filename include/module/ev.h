@@ -649,6 +649,10 @@ void ev_set_loop_release_cb (EV_P_ void (*release)(EV_P), void (*acquire)(EV_P))
 
 unsigned int ev_pending_count (EV_P); /* number of pending events, if any */
 DAPIEXPORT void ev_invoke_pending (EV_P); /* invoke all pending watchers */
+/* proteus: invoke pending watchers until expired_cb returns true */
+void ev_invoke_pending_until (EV_P_ int (*expired_cb)(EV_P));
+/* proteus: hand all pending watchers to collect_cb instead of invoking them */
+void ev_collect_pending (EV_P_ void (*collect_cb)(EV_P_ void *w, int revents));
 
 /*
  * stop/start the timer handling.
@@ -20,7 +20,6 @@
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 var SlowBuffer = process.binding('buffer').SlowBuffer;
-var IEEE754 = require('buffer_ieee754');
 var assert = require('assert');
 
 
@@ -40,21 +39,6 @@ SlowBuffer.prototype.inspect = function() {
 };
 
 
-SlowBuffer.prototype.hexSlice = function(start, end) {
-  var len = this.length;
-
-  if (!start || start < 0) start = 0;
-  if (!end || end < 0 || end > len) end = len;
-
-  var out = '';
-  for (var i = start; i < end; i++) {
-    out += toHex(this[i]);
-  }
-  return out;
-};
-
-
-
 SlowBuffer.prototype.toString = function(encoding, start, end) {
   encoding = String(encoding || 'utf8').toLowerCase();
   start = +start || 0;
@@ -92,23 +76,6 @@ SlowBuffer.prototype.toString = function(encoding, start, end) {
 };
 
 
-SlowBuffer.prototype.hexWrite = function(string, offset) {
-  var len = string.length;
-  offset = +offset || 0;
-
-  // must be an even number of digits
-  if (len % 2) {
-    throw new Error('Invalid hex string');
-  }
-  for (var i = 0; i < len / 2; i++) {
-    var byte = parseInt(string.substr(i * 2, 2), 16);
-    if (isNaN(byte)) throw new Error('Invalid hex string');
-    this[offset + i] = byte;
-  }
-  return i;
-};
-
-
 SlowBuffer.prototype.write = function(string, offset, encoding) {
   // Support both (string, offset, encoding)
   // and the legacy (string, encoding, offset)
@@ -241,6 +208,11 @@ function allocPool() {
   pool.used = 0;
 }
 
+// the page went to the background, slices keep the old pool alive
+process.on('pause', function() {
+  pool = null;
+});
+
 
 // Static methods
 Buffer.isBuffer = function isBuffer(b) {
@@ -448,6 +420,50 @@ Buffer.prototype.copy = function(target, target_start, start, end) {
 };
 
 
+// indexOf(value, byteOffset=0, encoding='utf8'), value is a byte, a string
+// or a Buffer
+Buffer.prototype.indexOf = function(value, byteOffset, encoding) {
+  if (typeof byteOffset === 'string') {
+    encoding = byteOffset;
+    byteOffset = 0;
+  }
+  byteOffset = +byteOffset || 0;
+  if (byteOffset < 0) byteOffset = Math.max(this.length + byteOffset, 0);
+  if (byteOffset > this.length) return -1;
+
+  var i = this.parent.indexOf(value,
+                              byteOffset + this.offset,
+                              this.length + this.offset,
+                              encoding);
+  return i < 0 ? -1 : i - this.offset;
+};
+
+
+// lastIndexOf(value, byteOffset=buffer.length, encoding='utf8'), searches
+// backwards from byteOffset
+Buffer.prototype.lastIndexOf = function(value, byteOffset, encoding) {
+  if (typeof byteOffset === 'string') {
+    encoding = byteOffset;
+    byteOffset = undefined;
+  }
+  byteOffset = byteOffset === undefined ? this.length : +byteOffset || 0;
+  if (byteOffset < 0) byteOffset = this.length + byteOffset;
+  if (byteOffset < 0) return -1;
+
+  // a match may start at byteOffset
+  var length = typeof value === 'number' ? 1 :
+               typeof value === 'string' ? Buffer.byteLength(value, encoding) :
+               (value && value.length) || 0;
+  var end = Math.min(this.length, byteOffset + length);
+
+  var i = this.parent.lastIndexOf(value,
+                                  this.offset,
+                                  end + this.offset,
+                                  encoding);
+  return i < 0 ? -1 : i - this.offset;
+};
+
+
 // slice(start, end)
 Buffer.prototype.slice = function(start, end) {
   if (end === undefined) end = this.length;
@@ -484,9 +500,12 @@ Buffer.prototype.asciiWrite = function(string, offset) {
   return this.write(string, offset, 'ascii');
 };
 
-Buffer.prototype.readUInt8 = function(offset, endian) {
-  var buffer = this;
-
+/*
+ * The fixed width accessors check their arguments here and leave the byte
+ * shuffling to the SlowBuffer, which does it natively in the byte order asked
+ * for. Returns true for big endian.
+ */
+function checkAccess(buffer, offset, size, endian) {
   assert.ok(endian !== undefined && endian !== null,
     'missing endian');
 
@@ -496,229 +515,60 @@ Buffer.prototype.readUInt8 = function(offset, endian) {
   assert.ok(offset !== undefined && offset !== null,
     'missing offset');
 
-  assert.ok(offset < buffer.length,
-    'Trying to read beyond buffer length');
-
-  return buffer[offset];
-};
+  assert.ok(offset >= 0, 'offset is negative');
 
+  assert.ok(offset + size - 1 < buffer.length,
+    'Trying to read beyond buffer length');
 
-Buffer.prototype.readUInt16 = function(offset, endian) {
-  var val = 0;
-  var buffer = this;
-
-  assert.ok(endian !== undefined && endian !== null,
-    'missing endian');
-
-  assert.ok(endian == 'big' || endian == 'little',
-    'bad endian value');
+  return endian == 'big';
+}
 
-  assert.ok(offset !== undefined && offset !== null,
-    'missing offset');
 
-  assert.ok(offset + 1 < buffer.length,
-    'Trying to read beyond buffer length');
+Buffer.prototype.readUInt8 = function(offset, endian) {
+  var big = checkAccess(this, offset, 1, endian);
+  return this.parent._readUInt8(this.offset + offset, big);
+};
 
-  if (endian == 'big') {
-    val = buffer[offset] << 8;
-    val |= buffer[offset + 1];
-  } else {
-    val = buffer[offset];
-    val |= buffer[offset + 1] << 8;
-  }
 
-  return val;
+Buffer.prototype.readUInt16 = function(offset, endian) {
+  var big = checkAccess(this, offset, 2, endian);
+  return this.parent._readUInt16(this.offset + offset, big);
 };
 
 
 Buffer.prototype.readUInt32 = function(offset, endian) {
-  var val = 0;
-  var buffer = this;
-
-  assert.ok(endian !== undefined && endian !== null,
-    'missing endian');
-
-  assert.ok(endian == 'big' || endian == 'little',
-    'bad endian value');
-
-  assert.ok(offset !== undefined && offset !== null,
-    'missing offset');
-
-  assert.ok(offset + 3 < buffer.length,
-    'Trying to read beyond buffer length');
-
-  if (endian == 'big') {
-    val = buffer[offset + 1] << 16;
-    val |= buffer[offset + 2] << 8;
-    val |= buffer[offset + 3];
-    val = val + (buffer[offset] << 24 >>> 0);
-  } else {
-    val = buffer[offset + 2] << 16;
-    val |= buffer[offset + 1] << 8;
-    val |= buffer[offset];
-    val = val + (buffer[offset + 3] << 24 >>> 0);
-  }
-
-  return val;
+  var big = checkAccess(this, offset, 4, endian);
+  return this.parent._readUInt32(this.offset + offset, big);
 };
 
 
-/*
- * Signed integer types, yay team! A reminder on how two's complement actually
- * works. The first bit is the signed bit, i.e. tells us whether or not the
- * number should be positive or negative. If the two's complement value is
- * positive, then we're done, as it's equivalent to the unsigned representation.
- *
- * Now if the number is positive, you're pretty much done, you can just leverage
- * the unsigned translations and return those. Unfortunately, negative numbers
- * aren't quite that straightforward.
- *
- * At first glance, one might be inclined to use the traditional formula to
- * translate binary numbers between the positive and negative values in two's
- * complement. (Though it doesn't quite work for the most negative value)
- * Mainly:
- *  - invert all the bits
- *  - add one to the result
- *
- * Of course, this doesn't quite work in Javascript. Take for example the value
- * of -128. This could be represented in 16 bits (big-endian) as 0xff80. But of
- * course, Javascript will do the following:
- *
- * > ~0xff80
- * -65409
- *
- * Whoh there, Javascript, that's not quite right. But wait, according to
- * Javascript that's perfectly correct. When Javascript ends up seeing the
- * constant 0xff80, it has no notion that it is actually a signed number. It
- * assumes that we've input the unsigned value 0xff80. Thus, when it does the
- * binary negation, it casts it into a signed value, (positive 0xff80). Then
- * when you perform binary negation on that, it turns it into a negative number.
- *
- * Instead, we're going to have to use the following general formula, that works
- * in a rather Javascript friendly way. I'm glad we don't support this kind of
- * weird numbering scheme in the kernel.
- *
- * (BIT-MAX - (unsigned)val + 1) * -1
- *
- * The astute observer, may think that this doesn't make sense for 8-bit numbers
- * (really it isn't necessary for them). However, when you get 16-bit numbers,
- * you do. Let's go back to our prior example and see how this will look:
- *
- * (0xffff - 0xff80 + 1) * -1
- * (0x007f + 1) * -1
- * (0x0080) * -1
- */
 Buffer.prototype.readInt8 = function(offset, endian) {
-  var buffer = this;
-  var neg;
-
-  assert.ok(endian !== undefined && endian !== null,
-    'missing endian');
-
-  assert.ok(endian == 'big' || endian == 'little',
-    'bad endian value');
-
-  assert.ok(offset !== undefined && offset !== null,
-    'missing offset');
-
-  assert.ok(offset < buffer.length,
-    'Trying to read beyond buffer length');
-
-  neg = buffer[offset] & 0x80;
-  if (!neg) {
-    return (buffer[offset]);
-  }
-
-  return ((0xff - buffer[offset] + 1) * -1);
+  var big = checkAccess(this, offset, 1, endian);
+  return this.parent._readInt8(this.offset + offset, big);
 };
 
 
 Buffer.prototype.readInt16 = function(offset, endian) {
-  var buffer = this;
-  var neg;
-
-  assert.ok(endian !== undefined && endian !== null,
-    'missing endian');
-
-  assert.ok(endian == 'big' || endian == 'little',
-    'bad endian value');
-
-  assert.ok(offset !== undefined && offset !== null,
-    'missing offset');
-
-  assert.ok(offset + 1 < buffer.length,
-    'Trying to read beyond buffer length');
-
-  val = buffer.readUInt16(offset, endian);
-  neg = val & 0x8000;
-  if (!neg) {
-    return val;
-  }
-
-  return (0xffff - val + 1) * -1;
+  var big = checkAccess(this, offset, 2, endian);
+  return this.parent._readInt16(this.offset + offset, big);
 };
 
 
 Buffer.prototype.readInt32 = function(offset, endian) {
-  var buffer = this;
-  var neg;
-
-  assert.ok(endian !== undefined && endian !== null,
-    'missing endian');
-
-  assert.ok(endian == 'big' || endian == 'little',
-    'bad endian value');
-
-  assert.ok(offset !== undefined && offset !== null,
-    'missing offset');
-
-  assert.ok(offset + 3 < buffer.length,
-    'Trying to read beyond buffer length');
-
-  val = buffer.readUInt32(offset, endian);
-  neg = val & 0x80000000;
-  if (!neg) {
-    return (val);
-  }
-
-  return (0xffffffff - val + 1) * -1;
+  var big = checkAccess(this, offset, 4, endian);
+  return this.parent._readInt32(this.offset + offset, big);
 };
 
 
 Buffer.prototype.readFloat = function(offset, endian) {
-  var buffer = this;
-
-  assert.ok(endian !== undefined && endian !== null,
-    'missing endian');
-
-  assert.ok(endian == 'big' || endian == 'little',
-    'bad endian value');
-
-  assert.ok(offset !== undefined && offset !== null,
-    'missing offset');
-
-  assert.ok(offset + 3 < buffer.length,
-    'Trying to read beyond buffer length');
-
-  return IEEE754.readIEEE754(buffer, offset, endian, 23, 4);
+  var big = checkAccess(this, offset, 4, endian);
+  return this.parent._readFloat(this.offset + offset, big);
 };
 
-Buffer.prototype.readDouble = function(offset, endian) {
-  var buffer = this;
-
-  assert.ok(endian !== undefined && endian !== null,
-    'missing endian');
-
-  assert.ok(endian == 'big' || endian == 'little',
-    'bad endian value');
-
-  assert.ok(offset !== undefined && offset !== null,
-    'missing offset');
 
-  assert.ok(offset + 7 < buffer.length,
-    'Trying to read beyond buffer length');
-
-  return IEEE754.readIEEE754(buffer, offset, endian, 52, 8);
+Buffer.prototype.readDouble = function(offset, endian) {
+  var big = checkAccess(this, offset, 8, endian);
+  return this.parent._readDouble(this.offset + offset, big);
 };
 
 
@@ -744,129 +594,6 @@ function verifuint(value, max) {
 }
 
 
-Buffer.prototype.writeUInt8 = function(value, offset, endian) {
-  var buffer = this;
-
-  assert.ok(value !== undefined && value !== null,
-    'missing value');
-
-  assert.ok(endian !== undefined && endian !== null,
-    'missing endian');
-
-  assert.ok(endian == 'big' || endian == 'little',
-    'bad endian value');
-
-  assert.ok(offset !== undefined && offset !== null,
-    'missing offset');
-
-  assert.ok(offset < buffer.length,
-    'trying to read beyond buffer length');
-
-  verifuint(value, 0xff);
-  buffer[offset] = value;
-};
-
-
-Buffer.prototype.writeUInt16 = function(value, offset, endian) {
-  var buffer = this;
-
-  assert.ok(value !== undefined && value !== null,
-    'missing value');
-
-  assert.ok(endian !== undefined && endian !== null,
-    'missing endian');
-
-  assert.ok(endian == 'big' || endian == 'little',
-    'bad endian value');
-
-  assert.ok(offset !== undefined && offset !== null,
-    'missing offset');
-
-  assert.ok(offset + 1 < buffer.length,
-    'trying to read beyond buffer length');
-
-  verifuint(value, 0xffff);
-
-  if (endian == 'big') {
-    buffer[offset] = (value & 0xff00) >>> 8;
-    buffer[offset + 1] = value & 0x00ff;
-  } else {
-    buffer[offset + 1] = (value & 0xff00) >>> 8;
-    buffer[offset] = value & 0x00ff;
-  }
-};
-
-
-Buffer.prototype.writeUInt32 = function(value, offset, endian) {
-  var buffer = this;
-
-  assert.ok(value !== undefined && value !== null,
-    'missing value');
-
-  assert.ok(endian !== undefined && endian !== null,
-    'missing endian');
-
-  assert.ok(endian == 'big' || endian == 'little',
-    'bad endian value');
-
-  assert.ok(offset !== undefined && offset !== null,
-    'missing offset');
-
-  assert.ok(offset + 3 < buffer.length,
-    'trying to read beyond buffer length');
-
-  verifuint(value, 0xffffffff);
-  if (endian == 'big') {
-    buffer[offset] = (value >>> 24) & 0xff;
-    buffer[offset + 1] = (value >>> 16) & 0xff;
-    buffer[offset + 2] = (value >>> 8) & 0xff;
-    buffer[offset + 3] = value & 0xff;
-  } else {
-    buffer[offset + 3] = (value >>> 24) & 0xff;
-    buffer[offset + 2] = (value >>> 16) & 0xff;
-    buffer[offset + 1] = (value >>> 8) & 0xff;
-    buffer[offset] = value & 0xff;
-  }
-};
-
-
-/*
- * We now move onto our friends in the signed number category. Unlike unsigned
- * numbers, we're going to have to worry a bit more about how we put values into
- * arrays. Since we are only worrying about signed 32-bit values, we're in
- * slightly better shape. Unfortunately, we really can't do our favorite binary
- * & in this system. It really seems to do the wrong thing. For example:
- *
- * > -32 & 0xff
- * 224
- *
- * What's happening above is really: 0xe0 & 0xff = 0xe0. However, the results of
- * this aren't treated as a signed number. Ultimately a bad thing.
- *
- * What we're going to want to do is basically create the unsigned equivalent of
- * our representation and pass that off to the wuint* functions. To do that
- * we're going to do the following:
- *
- *  - if the value is positive
- *      we can pass it directly off to the equivalent wuint
- *  - if the value is negative
- *      we do the following computation:
- *         mb + val + 1, where
- *         mb   is the maximum unsigned value in that byte size
- *         val  is the Javascript negative integer
- *
- *
- * As a concrete value, take -128. In signed 16 bits this would be 0xff80. If
- * you do out the computations:
- *
- * 0xffff - 128 + 1
- * 0xffff - 127
- * 0xff80
- *
- * You can then encode this value as the signed version. This is really rather
- * hacky, but it should work and get the job done which is our goal here.
- */
-
 /*
  * A series of checks to make sure we actually have a signed 32-bit number
  */
@@ -892,120 +619,89 @@ function verifIEEE754(value, max, min) {
 }
 
 
-Buffer.prototype.writeInt8 = function(value, offset, endian) {
-  var buffer = this;
-
+Buffer.prototype.writeUInt8 = function(value, offset, endian) {
   assert.ok(value !== undefined && value !== null,
     'missing value');
+  var big = checkAccess(this, offset, 1, endian);
+  verifuint(value, 0xff);
+  this.parent._writeUInt8(value, this.offset + offset, big);
+};
 
-  assert.ok(endian !== undefined && endian !== null,
-    'missing endian');
 
-  assert.ok(endian == 'big' || endian == 'little',
-    'bad endian value');
+Buffer.prototype.writeUInt16 = function(value, offset, endian) {
+  assert.ok(value !== undefined && value !== null,
+    'missing value');
+  var big = checkAccess(this, offset, 2, endian);
+  verifuint(value, 0xffff);
+  this.parent._writeUInt16(value, this.offset + offset, big);
+};
 
-  assert.ok(offset !== undefined && offset !== null,
-    'missing offset');
 
-  assert.ok(offset < buffer.length,
-    'Trying to read beyond buffer length');
+Buffer.prototype.writeUInt32 = function(value, offset, endian) {
+  assert.ok(value !== undefined && value !== null,
+    'missing value');
+  var big = checkAccess(this, offset, 4, endian);
+  verifuint(value, 0xffffffff);
+  this.parent._writeUInt32(value, this.offset + offset, big);
+};
 
-  verifsint(value, 0x7f, -0xf0);
 
-  if (value >= 0) {
-    buffer.writeUInt8(value, offset, endian);
-  } else {
-    buffer.writeUInt8(0xff + value + 1, offset, endian);
-  }
+Buffer.prototype.writeInt8 = function(value, offset, endian) {
+  assert.ok(value !== undefined && value !== null,
+    'missing value');
+  var big = checkAccess(this, offset, 1, endian);
+  verifsint(value, 0x7f, -0xf0);
+  this.parent._writeInt8(value, this.offset + offset, big);
 };
 
 
 Buffer.prototype.writeInt16 = function(value, offset, endian) {
-  var buffer = this;
-
   assert.ok(value !== undefined && value !== null,
     'missing value');
-
-  assert.ok(endian !== undefined && endian !== null,
-    'missing endian');
-
-  assert.ok(endian == 'big' || endian == 'little',
-    'bad endian value');
-
-  assert.ok(offset !== undefined && offset !== null,
-    'missing offset');
-
-  assert.ok(offset + 1 < buffer.length,
-    'Trying to read beyond buffer length');
-
+  var big = checkAccess(this, offset, 2, endian);
   verifsint(value, 0x7fff, -0xf000);
-
-  if (value >= 0) {
-    buffer.writeUInt16(value, offset, endian);
-  } else {
-    buffer.writeUInt16(0xffff + value + 1, offset, endian);
-  }
+  this.parent._writeInt16(value, this.offset + offset, big);
 };
 
 
 Buffer.prototype.writeInt32 = function(value, offset, endian) {
-  var buffer = this;
-
   assert.ok(value !== undefined && value !== null,
     'missing value');
-
-  assert.ok(endian !== undefined && endian !== null,
-    'missing endian');
-
-  assert.ok(endian == 'big' || endian == 'little',
-    'bad endian value');
-
-  assert.ok(offset !== undefined && offset !== null,
-    'missing offset');
-
-  assert.ok(offset + 3 < buffer.length,
-    'Trying to read beyond buffer length');
-
+  var big = checkAccess(this, offset, 4, endian);
   verifsint(value, 0x7fffffff, -0xf0000000);
-  if (value >= 0) {
-    buffer.writeUInt32(value, offset, endian);
-  } else {
-    buffer.writeUInt32(0xffffffff + value + 1, offset, endian);
-  }
+  this.parent._writeInt32(value, this.offset + offset, big);
 };
 
 
 Buffer.prototype.writeFloat = function(value, offset, endian) {
-  var buffer = this;
-
   assert.ok(value !== undefined && value !== null,
     'missing value');
-
-  assert.ok(endian !== undefined && endian !== null,
-    'missing endian');
-
-  assert.ok(endian == 'big' || endian == 'little',
-    'bad endian value');
-
-  assert.ok(offset !== undefined && offset !== null,
-    'missing offset');
-
-  assert.ok(offset + 3 < buffer.length,
-    'Trying to read beyond buffer length');
-
+  var big = checkAccess(this, offset, 4, endian);
   verifIEEE754(value, 3.4028234663852886e+38, -3.4028234663852886e+38);
-  IEEE754.writeIEEE754(buffer, value, offset, endian, 23, 4);
+  this.parent._writeFloat(value, this.offset + offset, big);
 };
 
 
 Buffer.prototype.writeDouble = function(value, offset, endian) {
-  var buffer = this;
-
   assert.ok(value !== undefined && value !== null,
     'missing value');
+  var big = checkAccess(this, offset, 8, endian);
+  verifIEEE754(value, 1.7976931348623157E+308, -1.7976931348623157E+308);
+  this.parent._writeDouble(value, this.offset + offset, big);
+};
 
-  assert.ok(endian !== undefined && endian !== null,
-    'missing endian');
+
+/*
+ * Bulk versions for tables of numbers: one call into the SlowBuffer converts
+ * the whole run.
+ */
+var valueSizes = {
+  uint8: 1, int8: 1, uint16: 2, int16: 2,
+  uint32: 4, int32: 4, float: 4, 'double': 8
+};
+
+function checkValues(buffer, type, offset, count, endian) {
+  assert.ok(valueSizes.hasOwnProperty(type), 'unknown type');
 
   assert.ok(endian == 'big' || endian == 'little',
     'bad endian value');
@@ -1013,9 +709,22 @@ Buffer.prototype.writeDouble = function(value, offset, endian) {
   assert.ok(offset !== undefined && offset !== null,
     'missing offset');
 
-  assert.ok(offset + 7 < buffer.length,
-    'Trying to read beyond buffer length');
+  assert.ok(offset >= 0 && offset + count * valueSizes[type] <= buffer.length,
+    'Trying to access beyond buffer length');
 
-  verifIEEE754(value, 1.7976931348623157E+308, -1.7976931348623157E+308);
-  IEEE754.writeIEEE754(buffer, value, offset, endian, 52, 8);
+  return endian == 'big';
+}
+
+
+Buffer.prototype.readValues = function(type, offset, count, endian) {
+  count = count >>> 0;
+  var big = checkValues(this, type, offset, count, endian);
+  return this.parent._readValues(type, this.offset + offset, count, big);
+};
+
+
+Buffer.prototype.writeValues = function(type, values, offset, endian) {
+  assert.ok(Array.isArray(values), 'values must be an array');
+  var big = checkValues(this, type, offset, values.length, endian);
+  return this.parent._writeValues(type, values, this.offset + offset, big);
 };
@@ -30,18 +30,25 @@ var constants = process.binding('constants');
 
 var socket = binding.socket;
 var recvfrom = binding.recvfrom;
+var recvmmsg = binding.recvmmsg;
+var sendmmsg = binding.sendmmsg;
 var close = binding.close;
 
 var ENOENT = constants.ENOENT;
 
+// Most datagrams moved by one recvmmsg/sendmmsg, see src/node_net.cc
+var MAX_BATCH = 64;
+
 function isPort(x) { return parseInt(x) >= 0; }
 var pool = null;
 
-function getPool() {
-  /* TODO: this effectively limits you to 8kb maximum packet sizes */
-  var minPoolAvail = 1024 * 8;
+/* TODO: this effectively limits you to 8kb maximum packet sizes */
+var maxPacketSize = 1024 * 8;
+
+function getPool(minPoolAvail) {
+  if (!minPoolAvail) minPoolAvail = maxPacketSize;
 
-  var poolSize = 1024 * 64;
+  var poolSize = Math.max(1024 * 64, minPoolAvail);
 
   if (pool === null || (pool.used + minPoolAvail > pool.length)) {
     pool = new Buffer(poolSize);
@@ -81,6 +88,11 @@ function Socket(type, listener) {
   self.watcher = new IOWatcher();
   self.watcher.host = self;
   self.watcher.callback = function() {
+    if (self._batchSize > 1 && recvmmsg) {
+      self._readBatch();
+      return;
+    }
+
     while (self.fd) {
       var p = getPool();
       var rinfo = recvfrom(self.fd, p, p.used, p.length - p.used, 0);
@@ -105,6 +117,46 @@ exports.createSocket = function(type, listener) {
   return new Socket(type, listener);
 };
 
+// Receives up to _batchSize datagrams per syscall, and calls back with all of
+// them at once.
+Socket.prototype._readBatch = function() {
+  var count = this._batchSize;
+
+  while (this.fd) {
+    var p = getPool(count * maxPacketSize);
+    var rinfos = recvmmsg(this.fd, p, p.used, count * maxPacketSize, count, 0);
+
+    if (!rinfos) return;
+
+    var msgs = new Array(rinfos.length);
+    for (var i = 0; i < rinfos.length; i++) {
+      msgs[i] = p.slice(p.used, p.used + rinfos[i].size);
+      p.used += rinfos[i].size;
+    }
+
+    if (this.listeners('messages').length) {
+      this.emit('messages', msgs, rinfos);
+    } else {
+      for (i = 0; i < msgs.length; i++) {
+        this.emit('message', msgs[i], rinfos[i]);
+      }
+    }
+
+    // a short batch means the socket has been drained
+    if (rinfos.length < count) return;
+  }
+};
+
+Socket.prototype.setBatchSize = function(size) {
+  var n = parseInt(size);
+
+  if (n >= 1 && n <= MAX_BATCH) {
+    this._batchSize = n;
+  } else {
+    throw new Error('Batch size must be between 1 and ' + MAX_BATCH);
+  }
+};
+
 Socket.prototype.bind = function() {
   var self = this;
 
@@ -290,6 +342,76 @@ Socket.prototype.sendto = function(buffer,
   }
 };
 
+// translate arguments from JS API into C++ API, possibly after DNS lookup
+Socket.prototype.sendBatch = function(buffers) {
+  var self = this;
+
+  if (!Array.isArray(buffers)) {
+    throw new Error('sendBatch takes an array of buffers as arg 1');
+  }
+
+  if (this.type === 'unix_dgram') {
+    // sendBatch(buffers, path [, callback])
+    if (typeof arguments[1] !== 'string') {
+      throw new Error('unix_dgram sockets must send to a path ' +
+                      'in the filesystem');
+    }
+
+    self._sendBatch(buffers, arguments[1], null, arguments[2]);
+  } else if (this.type === 'udp4' || this.type === 'udp6') {
+    // sendBatch(buffers, port, address [, callback])
+    if (typeof arguments[2] !== 'string') {
+      throw new Error(this.type + ' sockets must send to port, address');
+    }
+
+    var port = arguments[1],
+        callback = arguments[3];
+    if (binding.isIP(arguments[2])) {
+      self._sendBatch(buffers, port, arguments[2], callback);
+    } else {
+      dnsLookup(this.type, arguments[2], function(err, ip, addressFamily) {
+        if (err) {  // DNS error
+          if (callback) {
+            callback(err, 0);
+          }
+          self.emit('error', err);
+          return;
+        }
+        self._sendBatch(buffers, port, ip, callback);
+      });
+    }
+  }
+};
+
+Socket.prototype._sendBatch = function(buffers, port, addr, callback) {
+  var sent = 0;
+
+  try {
+    while (sent < buffers.length) {
+      var n;
+      if (sendmmsg) {
+        n = sendmmsg(this.fd,
+                     sent ? buffers.slice(sent, sent + MAX_BATCH) : buffers,
+                     0, port, addr);
+      } else {
+        n = binding.sendto(this.fd, buffers[sent], 0, buffers[sent].length,
+                           0, port, addr) === null ? 0 : 1;
+      }
+      if (!n) break; // EAGAIN, the rest is dropped like any datagram
+      sent += n;
+    }
+  } catch (err) {
+    if (callback) {
+      callback(err, sent);
+    }
+    return;
+  }
+
+  if (callback) {
+    callback(null, sent);
+  }
+};
+
 Socket.prototype.close = function() {
   var self = this;
 
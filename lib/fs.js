@@ -36,6 +36,22 @@ fs.release = function() {
   binding.release();
 }
 
+// proteus: the async requests issued while fn runs are tagged with
+// priority, background work (e.g. module updates) runs at
+// PRIORITY_BACKGROUND so the requests the user is waiting on are picked up
+// by the thread pool first. Requests issued later, callbacks of these ones
+// included, are back at the default
+fs.PRIORITY_DEFAULT = 0;
+fs.PRIORITY_BACKGROUND = -2;
+fs.withPriority = function(priority, fn) {
+  var previous = binding.setPriority(priority);
+  try {
+    return fn();
+  } finally {
+    binding.setPriority(previous);
+  }
+};
+
 fs.Stats = binding.Stats;
 
 fs.Stats.prototype._checkModeProperty = function(property) {
@@ -892,6 +908,10 @@ function allocNewPool() {
   pool.used = 0;
 }
 
+process.on('pause', function() {
+  pool = null;
+});
+
 
 
 fs.createReadStream = function(path, options) {
@@ -1025,6 +1045,7 @@ ReadStream.prototype._read = function() {
     self._read();
   }
 
+  self._readStarted = true;
   fs.read(self.fd, pool, pool.used, toRead, self.pos, afterRead);
 
   if (self.pos !== undefined) {
@@ -1034,6 +1055,17 @@ ReadStream.prototype._read = function() {
 };
 
 
+// Destinations that can take the file from its descriptor, such as
+// http.ServerResponse, do so instead of getting it as 'data'.
+ReadStream.prototype.pipe = function(dest, options) {
+  if (dest._pipeFile && !this._decoder && !this._readStarted &&
+      dest._pipeFile(this, options)) {
+    return dest;
+  }
+  return Stream.prototype.pipe.call(this, dest, options);
+};
+
+
 ReadStream.prototype._emitData = function(d) {
   if (this._decoder) {
     var string = this._decoder.write(d);
@@ -22,6 +22,7 @@
 var util = require('util');
 var net = require('net');
 var stream = require('stream');
+var fs = require('fs');
 var EventEmitter = require('events').EventEmitter;
 var FreeList = require('freelist').FreeList;
 var HTTPParser = process.binding('http_parser').HTTPParser;
@@ -39,52 +40,48 @@ var debug = function(x) { console.verbose('HTTP: %s', x); };
 var parsers = new FreeList('parsers', 1000, function() {
   var parser = new HTTPParser('request');
 
-  parser.onMessageBegin = function() {
-    parser.incoming = new IncomingMessage(parser.socket);
-    parser.field = null;
-    parser.value = null;
+  // Headers and the URL are collected natively and arrive in one piece with
+  // onHeadersComplete; onHeaders only sees the overflow of very long header
+  // blocks and the trailers.
+  parser._headers = [];
+  parser._url = '';
+  parser._headersDone = false;
+
+  // parsers come back from the freelist, possibly cut off mid message
+  var reinitialize = parser.reinitialize;
+  parser.reinitialize = function(type) {
+    parser._headers = [];
+    parser._url = '';
+    parser._headersDone = false;
+    reinitialize.call(parser, type);
   };
 
-  // Only servers will get URL events.
-  parser.onURL = function(b, start, len) {
-    var slice = b.toString('ascii', start, start + len);
-    if (parser.incoming.url) {
-      parser.incoming.url += slice;
-    } else {
-      // Almost always will branch here.
-      parser.incoming.url = slice;
+  parser.onHeaders = function(headers, url) {
+    if (parser._headersDone) {
+      // trailers
+      addHeaderLines(parser.incoming, headers);
+      return;
     }
+    parser._headers = parser._headers.concat(headers);
+    parser._url += url;
   };
 
-  parser.onHeaderField = function(b, start, len) {
-    var slice = b.toString('ascii', start, start + len).toLowerCase();
-    if (parser.value != undefined) {
-      parser.incoming._addHeaderLine(parser.field, parser.value);
-      parser.field = null;
-      parser.value = null;
+  parser.onHeadersComplete = function(info) {
+    var headers = info.headers;
+    var url = info.url;
+    if (parser._headers.length) {
+      headers = parser._headers.concat(headers);
+      parser._headers = [];
     }
-    if (parser.field) {
-      parser.field += slice;
-    } else {
-      parser.field = slice;
+    if (parser._url) {
+      url = parser._url + (url || '');
+      parser._url = '';
     }
-  };
 
-  parser.onHeaderValue = function(b, start, len) {
-    var slice = b.toString('ascii', start, start + len);
-    if (parser.value) {
-      parser.value += slice;
-    } else {
-      parser.value = slice;
-    }
-  };
-
-  parser.onHeadersComplete = function(info) {
-    if (parser.field && (parser.value != undefined)) {
-      parser.incoming._addHeaderLine(parser.field, parser.value);
-      parser.field = null;
-      parser.value = null;
-    }
+    parser.incoming = new IncomingMessage(parser.socket);
+    parser._headersDone = true;
+    if (url) parser.incoming.url = url;
+    addHeaderLines(parser.incoming, headers);
 
     parser.incoming.httpVersionMajor = info.versionMajor;
     parser.incoming.httpVersionMinor = info.versionMinor;
@@ -124,9 +121,7 @@ var parsers = new FreeList('parsers', 1000, function() {
 
   parser.onMessageComplete = function() {
     this.incoming.complete = true;
-    if (parser.field && (parser.value != undefined)) {
-      parser.incoming._addHeaderLine(parser.field, parser.value);
-    }
+    parser._headersDone = false;
     if (!parser.incoming.upgrade) {
       // For upgraded connections, also emit this after parser.execute
       parser.incoming.readable = false;
@@ -139,6 +134,13 @@ var parsers = new FreeList('parsers', 1000, function() {
 exports.parsers = parsers;
 
 
+function addHeaderLines(incoming, headers) {
+  for (var i = 0, l = headers.length; i < l; i += 2) {
+    incoming._addHeaderLine(headers[i], headers[i + 1]);
+  }
+}
+
+
 var CRLF = '\r\n';
 var STATUS_CODES = exports.STATUS_CODES = {
   100 : 'Continue',
@@ -377,7 +379,17 @@ OutgoingMessage.prototype._writeRaw = function(data, encoding) {
   if (this.connection &&
       this.connection._httpMessage === this &&
       this.connection.writable) {
-    // There might be pending data in the this.output buffer.
+    // There might be pending data in the this.output buffer. Sockets that
+    // can gather hand it over together with data as one request.
+    if (this.output.length && this.connection.writev) {
+      var chunks = this.output, encodings = this.outputEncodings;
+      this.output = [];
+      this.outputEncodings = [];
+      chunks.push(data);
+      encodings.push(encoding);
+      return this.connection.writev(chunks, encodings);
+    }
+
     while (this.output.length) {
       if (!this.connection.writable) {
         this._buffer(data, encoding);
@@ -614,9 +626,19 @@ OutgoingMessage.prototype.write = function(chunk, encoding) {
     } else {
       // buffer
       len = chunk.length;
-      this._send(len.toString(16) + CRLF);
-      this._send(chunk);
-      ret = this._send(CRLF);
+      var conn = this.connection;
+      if (conn && conn.cork && conn._httpMessage === this && conn.writable) {
+        // size, data and CRLF leave as one request
+        conn.cork();
+        this._send(len.toString(16) + CRLF);
+        this._send(chunk);
+        this._send(CRLF);
+        ret = conn.uncork();
+      } else {
+        this._send(len.toString(16) + CRLF);
+        this._send(chunk);
+        ret = this._send(CRLF);
+      }
     }
   } else {
     ret = this._send(chunk, encoding);
@@ -627,6 +649,34 @@ OutgoingMessage.prototype.write = function(chunk, encoding) {
 };
 
 
+// Writes length bytes of the open file fd from offset as body, from the
+// file straight to the socket. Only for a connection with sendFile() that
+// this message is writing to.
+OutgoingMessage.prototype._sendFile = function(fd, offset, length, cb) {
+  if (!this._header) {
+    this._implicitHeader();
+  }
+
+  var conn = this.connection;
+  assert(conn && conn.sendFile && conn._httpMessage === this);
+
+  if (length === 0) {
+    if (!this._headerSent) this._send('');
+    process.nextTick(cb);
+    return true;
+  }
+
+  if (this.chunkedEncoding) {
+    this._send(length.toString(16) + CRLF);
+    conn.sendFile(fd, offset, length, cb);
+    return this._send(CRLF);
+  }
+
+  if (!this._headerSent) this._send('');
+  return conn.sendFile(fd, offset, length, cb);
+};
+
+
 OutgoingMessage.prototype.addTrailers = function(headers) {
   this._trailer = '';
   var keys = Object.keys(headers);
@@ -779,6 +829,74 @@ exports.ServerResponse = ServerResponse;
 
 ServerResponse.prototype.statusCode = 200;
 
+// Sends an fs.ReadStream that has not been read from yet with
+// socket.sendFile(), see ReadStream.prototype.pipe. Returns false when this
+// response can't, the stream is then piped as usual.
+ServerResponse.prototype._pipeFile = function(src, options) {
+  var self = this;
+
+  function canSendFile() {
+    var conn = self.connection;
+    return conn && conn.sendFile && conn._httpMessage === self &&
+           conn.writable && self._hasBody && !self.finished &&
+           self.output.length === 0;
+  }
+
+  if (!canSendFile()) return false;
+
+  var end = !options || options.end !== false;
+
+  // The data is taken from the descriptor from now on.
+  src.pause();
+
+  function send(fd) {
+    fs.fstat(fd, function(err, stat) {
+      if (err) {
+        src.emit('error', err);
+        return;
+      }
+
+      if (!stat.isFile() || !canSendFile()) {
+        // Read it after all.
+        stream.Stream.prototype.pipe.call(src, self, options);
+        src.resume();
+        return;
+      }
+
+      var start = src.start || 0;
+      var stop = src.end === undefined ? stat.size :
+                                         Math.min(src.end + 1, stat.size);
+      var length = Math.max(0, stop - start);
+
+      if (end && !self._header &&
+          self.getHeader('content-length') === undefined &&
+          self.getHeader('transfer-encoding') === undefined) {
+        self.setHeader('Content-Length', length);
+      }
+
+      self._sendFile(fd, start, length, function(err) {
+        src.readable = false;
+        if (err) {
+          src.destroy();
+          self.destroy(err);
+          return;
+        }
+        src.emit('end');
+        src.destroy();
+        if (end) self.end();
+      });
+    });
+  }
+
+  if (typeof src.fd === 'number') {
+    send(src.fd);
+  } else {
+    src.once('open', send);
+  }
+  return true;
+};
+
+
 ServerResponse.prototype.writeContinue = function() {
   this._writeRaw('HTTP/1.1 100 Continue' + CRLF + CRLF, 'ascii');
   this._sent100 = true;
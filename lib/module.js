@@ -22,7 +22,7 @@
 
 var NativeModule = require('native_module');
 var Script = process.binding('evals').NodeScript;
-var runInThisContext = Script.runInThisContext;
+var runInThisContextCached = Script.runInThisContextCached;
 var runInNewContext = Script.runInNewContext;
 var assert = require('assert').ok;
 
@@ -328,7 +328,7 @@ Module.prototype._compile = function(content, filename) {
   // create wrapper function
   var dirname = path.dirname(filename);
   var wrapper = Module.wrap(content);
-  var compiledWrapper = runInThisContext(wrapper, filename, true);
+  var compiledWrapper = runInThisContextCached(wrapper, filename, true);
   var args = [process, self.exports, require, self, filename, dirname, process.Buffer];
   return compiledWrapper.apply(self.exports, args);
 };
@@ -57,6 +57,7 @@ var bind = binding.bind;
 var connect = binding.connect;
 var listen = binding.listen;
 var accept = binding.accept;
+var acceptMany = binding.acceptMany;
 var close = binding.close;
 var shutdown = binding.shutdown;
 var read = binding.read;
@@ -76,6 +77,9 @@ var EMFILE = constants.EMFILE;
 
 var END_OF_FILE = 42;
 
+// Most connections taken from the backlog per wakeup of a server.
+var ACCEPT_BATCH = 32;
+
 
 var ioWatchers = new FreeList('iowatcher', 100, function() {
   return new IOWatcher();
@@ -104,6 +108,10 @@ function allocNewPool() {
   pool.used = 0;
 }
 
+process.on('pause', function() {
+  pool = null;
+});
+
 var emptyBuffer = null;
 function allocEmptyBuffer() {
   emptyBuffer = new process.Buffer(1);
@@ -910,15 +918,20 @@ function Server(/* [ options, ] listener */) {
   self.watcher = new IOWatcher();
   self.watcher.host = self;
   self.watcher.callback = function() {
-    // Just in case we don't have a dummy fd.
-    getDummyFD();
-
     if (self._pauseTimer) {
       // Somehow the watcher got started again. Need to wait until
       // the timer finishes.
       self.watcher.stop();
     }
 
+    if (acceptMany) {
+      self._acceptMany();
+      return;
+    }
+
+    // Just in case we don't have a dummy fd.
+    getDummyFD();
+
     while (typeof self.fd === 'number') {
       try {
         var peerInfo = accept(self.fd);
@@ -934,37 +947,7 @@ function Server(/* [ options, ] listener */) {
       }
       if (!peerInfo) return;
 
-      if (self.maxConnections && self.connections >= self.maxConnections) {
-        // Close the connection we just had
-        close(peerInfo.fd);
-        // Reject all other pending connectins.
-        self._rejectPending();
-        return;
-      }
-
-      self.connections++;
-
-      var options = { fd: peerInfo.fd,
-                      type: self.type,
-                      allowHalfOpen: self.allowHalfOpen };
-      var s = new Socket(options);
-      s.remoteAddress = peerInfo.address;
-      s.remotePort = peerInfo.port;
-      s.type = self.type;
-      s.server = self;
-      s.resume();
-
-      DTRACE_NET_SERVER_CONNECTION(s);
-      self.emit('connection', s);
-
-      // The 'connect' event  probably should be removed for server-side
-      // sockets. It's redundant.
-      try {
-        s.emit('connect');
-      } catch (e) {
-        s.destroy(e);
-        return;
-      }
+      if (!self._onPeer(peerInfo)) return;
     }
   };
 }
@@ -977,6 +960,76 @@ exports.createServer = function() {
 };
 
 
+// Accepts the pending connections in batches. Running out of file
+// descriptors is dealt with natively, see uv_accept_shed().
+Server.prototype._acceptMany = function() {
+  while (typeof this.fd === 'number') {
+    var peers = acceptMany(this.fd, ACCEPT_BATCH);
+    var next = 0, accepting = true;
+
+    try {
+      // A 'connection' listener can close the server or make it stop
+      // accepting, check again before every peer
+      while (accepting && next < peers.length && typeof this.fd === 'number') {
+        accepting = this._onPeer(peers[next++]);
+      }
+    } finally {
+      // _onPeer owns the peers it was given, close the ones it never saw
+      while (next < peers.length) close(peers[next++].fd);
+    }
+
+    if (!accepting || typeof this.fd !== 'number') return;
+
+    if (peers.emfile) {
+      warnEMFILE();
+      if (peers.pause) this.pause();
+      return;
+    }
+
+    if (peers.length < ACCEPT_BATCH) return;
+  }
+};
+
+
+// Wraps an accepted connection in a Socket and emits it, returns false once
+// the server stops accepting.
+Server.prototype._onPeer = function(peerInfo) {
+  var self = this;
+
+  if (self.maxConnections && self.connections >= self.maxConnections) {
+    // Close the connection we just had
+    close(peerInfo.fd);
+    // Reject all other pending connectins.
+    self._rejectPending();
+    return false;
+  }
+
+  self.connections++;
+
+  var options = { fd: peerInfo.fd,
+                  type: self.type,
+                  allowHalfOpen: self.allowHalfOpen };
+  var s = new Socket(options);
+  s.remoteAddress = peerInfo.address;
+  s.remotePort = peerInfo.port;
+  s.type = self.type;
+  s.server = self;
+  s.resume();
+
+  DTRACE_NET_SERVER_CONNECTION(s);
+  self.emit('connection', s);
+
+  // The 'connect' event  probably should be removed for server-side
+  // sockets. It's redundant.
+  try {
+    s.emit('connect');
+  } catch (e) {
+    s.destroy(e);
+  }
+  return true;
+};
+
+
 // Just stop trying to accepting connections for a while.
 // Useful for throttling against DoS attacks.
 Server.prototype.pause = function(msecs) {
@@ -1102,7 +1155,7 @@ Server.prototype._doListen = function() {
   var self = this;
 
   // Ensure we have a dummy fd for EMFILE conditions.
-  getDummyFD();
+  if (!acceptMany) getDummyFD();
 
   try {
     bind(self.fd, arguments[0], arguments[1]);
@@ -1167,12 +1220,7 @@ var lastEMFILEWarning = 0;
 // Ensures to have at least on free file-descriptor free.
 // callback should only use 1 file descriptor and close it before end of call
 function rescueEMFILE(callback) {
-  // Output a warning, but only at most every 5 seconds.
-  var now = new Date();
-  if (now - lastEMFILEWarning > 5000) {
-    console.error('(node) Hit max file limit. Increase "ulimit - n"');
-    lastEMFILEWarning = now;
-  }
+  warnEMFILE();
 
   if (dummyFD) {
     close(dummyFD);
@@ -1182,6 +1230,15 @@ function rescueEMFILE(callback) {
   }
 }
 
+function warnEMFILE() {
+  // Output a warning, but only at most every 5 seconds.
+  var now = new Date();
+  if (now - lastEMFILEWarning > 5000) {
+    console.error('(node) Hit max file limit. Increase "ulimit - n"');
+    lastEMFILEWarning = now;
+  }
+}
+
 function getDummyFD() {
   if (!dummyFD) {
     try {
@@ -1,6 +1,6 @@
 var events = require('events');
 var stream = require('stream');
-var timers = require('timers');
+var timers = require('timers_uv');
 var util = require('util');
 var assert = require('assert');
 var TCP = process.binding('tcp_wrap').TCP;
@@ -39,6 +39,8 @@ function initSocketHandle(self) {
 
   self._flags = 0;
   self._connectQueueSize = 0;
+  self._corked = 0;
+  self._corkedChunks = null;
   self.destroyed = false;
 }
 
@@ -131,6 +133,10 @@ Socket.prototype.end = function(data, encoding) {
   this.writable = false;
 
   if (data) this.write(data, encoding);
+  if (this._corked) {
+    this._corked = 1;
+    this.uncork();
+  }
   DTRACE_NET_STREAM_END(this);
 
   if (this._flags & FLAG_GOT_EOF) {
@@ -176,6 +182,8 @@ Socket.prototype.destroy = function(exception) {
   var self = this;
 
   self._connectQueueCleanUp();
+  self._corked = 0;
+  self._corkedChunks = null;
 
   debug('destroy ' + this.fd);
 
@@ -275,6 +283,19 @@ Socket.prototype.write = function(data /* [encoding], [fd], [cb] */) {
     cb = arguments[1];
   }
 
+  // While corked the data only joins the batch handed to writev.
+  if (this._corked) {
+    if (!this._corkedChunks) {
+      this._corkedChunks = [];
+      this._corkedEncodings = [];
+      this._corkedCallbacks = [];
+    }
+    this._corkedChunks.push(data);
+    this._corkedEncodings.push(encoding);
+    if (cb) this._corkedCallbacks.push(cb);
+    return false;
+  }
+
   // Change strings to buffers. SLOW
   if (typeof data == 'string') {
     data = new Buffer(data, encoding);
@@ -301,6 +322,142 @@ Socket.prototype.write = function(data /* [encoding], [fd], [cb] */) {
 };
 
 
+// The handle encodes utf8, ascii, binary and hex strings itself, others go
+// through Buffer first.
+function writevChunk(chunk, encoding) {
+  if (typeof chunk == 'string') {
+    switch (encoding) {
+      case 'ucs2':
+      case 'ucs-2':
+      case 'utf16le':
+      case 'utf-16le':
+      case 'base64':
+        return new Buffer(chunk, encoding);
+    }
+  }
+  return chunk;
+}
+
+
+// Writes an array of Buffers and strings as one request. encodings is one
+// encoding for all the strings or an array in step with chunks.
+Socket.prototype.writev = function(chunks, encodings, cb) {
+  if (typeof encodings == 'function') {
+    cb = encodings;
+    encodings = undefined;
+  }
+
+  if (this._corked) {
+    for (var i = 0; i < chunks.length; i++) {
+      this.write(chunks[i], Array.isArray(encodings) ? encodings[i] : encodings,
+                 i == chunks.length - 1 ? cb : undefined);
+    }
+    return false;
+  }
+
+  var list = [], listEncodings = [];
+  var size = 0;
+  for (var i = 0; i < chunks.length; i++) {
+    var encoding = Array.isArray(encodings) ? encodings[i] : encodings;
+    var chunk = writevChunk(chunks[i], encoding);
+    if (chunk.length === 0) continue;
+    list.push(chunk);
+    listEncodings.push(encoding);
+    size += typeof chunk == 'string' ?
+        Buffer.byteLength(chunk, encoding) : chunk.length;
+  }
+
+  if (list.length == 0) {
+    if (cb) process.nextTick(cb);
+    return this._handle.writeQueueSize == 0;
+  }
+
+  // If we are still connecting, then buffer this for later.
+  if (this._connecting) {
+    this._connectQueueSize += size;
+    if (this._connectQueue) {
+      this._connectQueue.push([list, listEncodings, cb]);
+    } else {
+      this._connectQueue = [ [list, listEncodings, cb] ];
+    }
+    return false;
+  }
+
+  var writeReq = this._handle.writev(list, listEncodings);
+  if (!writeReq) {
+    this.destroy(errnoException(errno, 'writev'));
+    return false;
+  }
+  writeReq.oncomplete = afterWrite;
+  writeReq.cb = cb;
+  this._writeRequests.push(writeReq);
+
+  return this._handle.writeQueueSize == 0;
+};
+
+
+// Writes length bytes of the open file fd from offset, straight from the
+// file to the socket. It is queued in order with the writes around it and
+// cb(err) is called once it has been sent. Leave fd open until then.
+Socket.prototype.sendFile = function(fd, offset, length, cb) {
+  // What cork() held back goes first.
+  if (this._corkedChunks) {
+    var corked = this._corked;
+    this._corked = 1;
+    this.uncork();
+    this._corked = corked;
+  }
+
+  // If we are still connecting, then buffer this for later.
+  if (this._connecting) {
+    this._connectQueueSize += length;
+    var entry = { fd: fd, offset: offset, length: length, cb: cb };
+    if (this._connectQueue) {
+      this._connectQueue.push(entry);
+    } else {
+      this._connectQueue = [entry];
+    }
+    return false;
+  }
+
+  var writeReq = this._handle.sendFile(fd, offset, length);
+  if (!writeReq) {
+    var err = errnoException(errno, 'sendfile');
+    if (cb) cb(err);
+    this.destroy(err);
+    return false;
+  }
+  writeReq.oncomplete = afterWrite;
+  writeReq.cb = cb;
+  this._writeRequests.push(writeReq);
+
+  return this._handle.writeQueueSize == 0;
+};
+
+
+// Between cork() and the matching uncork() writes are held back and then
+// submitted together as one writev.
+Socket.prototype.cork = function() {
+  this._corked++;
+};
+
+
+Socket.prototype.uncork = function() {
+  if (this._corked == 0 || --this._corked > 0) return false;
+
+  var chunks = this._corkedChunks;
+  if (!chunks) return this._handle.writeQueueSize == 0;
+
+  var callbacks = this._corkedCallbacks;
+  this._corkedChunks = null;
+
+  return this.writev(chunks, this._corkedEncodings, callbacks.length == 0 ?
+    undefined : function() {
+      for (var i = 0; i < callbacks.length; i++) callbacks[i]();
+    });
+};
+
+
 function afterWrite(status, handle, req, buffer) {
   var self = handle.socket;
 
@@ -313,7 +470,13 @@ function afterWrite(status, handle, req, buffer) {
     self.emit('drain');
   }
 
-  if (req.cb) req.cb();
+  if (req.cb) {
+    if (status) {
+      req.cb(errnoException(errno, 'write'));
+    } else {
+      req.cb();
+    }
+  }
 
   if (self._writeRequests.length == 0  && self._flags & FLAG_DESTROY_SOON) {
     self.destroy();
@@ -402,7 +565,14 @@ function afterConnect(status, handle, req) {
     if (self._connectQueue) {
       debug('Drain the connect queue');
       for (var i = 0; i < self._connectQueue.length; i++) {
-        self.write.apply(self, self._connectQueue[i]);
+        var args = self._connectQueue[i];
+        if (!Array.isArray(args)) {
+          self.sendFile(args.fd, args.offset, args.length, args.cb);
+        } else if (Array.isArray(args[0])) {
+          self.writev.apply(self, args);
+        } else {
+          self.write.apply(self, args);
+        }
       }
       self._connectQueueCleanUp()
     }
@@ -19,9 +19,7 @@
 // OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
-var Timer = process.binding('timer_wrap').Timer;
-var L = require('_linklist');
-var assert = require('assert').ok;
+var TimerWheel = process.binding('timer_wrap').TimerWheel;
 
 var debug;
 if (process.env.NODE_DEBUG && /timer/.test(process.env.NODE_DEBUG)) {
@@ -31,94 +29,76 @@ if (process.env.NODE_DEBUG && /timer/.test(process.env.NODE_DEBUG)) {
 }
 
 
-// IDLE TIMEOUTS
+// All timers and idle timeouts live in one native timer wheel (see
+// TimerWheel in src/timer_wrap.cc) that runs on a single uv timer. Adding,
+// resetting and removing a timeout is O(1) whatever its value, so sockets
+// with different or jittered timeouts cost no more than identical ones.
 //
-// Because often many sockets will have the same idle timeout we will not
-// use one timeout watcher per item. It is too much overhead.  Instead
-// we'll use a single watcher for all sockets with the same timeout value
-// and a linked list. This technique is described in the libev manual:
-// http://pod.tst.eu/http://cvs.schmorp.de/libev/ev.pod#Be_smart_about_timeouts
-
-// Object containing all lists, timers
-// key = time in milliseconds
-// value = list
-var lists = {};
-
-
-// the main function - creates lists on demand and the watchers associated
-// with them.
-function insert(item, msecs) {
-  item._idleStart = new Date();
-  item._idleTimeout = msecs;
-
-  if (msecs < 0) return;
+// The wheel only knows timer ids, items maps an id to its object, which
+// keeps the id in _timerId while it is armed.
+var wheel = new TimerWheel();
+var items = [];
+
+wheel.ontimeout = function(ids) {
+  debug('timeout callback ' + ids.length);
+
+  var i = 0, threw = true;
+  try {
+    for (; i < ids.length; i++) {
+      var item = items[ids[i]];
+      if (!item) continue;
+      items[ids[i]] = undefined;
+      item._timerId = -1;
+      if (item._onTimeout) item._onTimeout();
+    }
+    threw = false;
+  } finally {
+    if (threw) {
+      // run what is left of the batch on the next tick of the wheel
+      for (i++; i < ids.length; i++) {
+        var rest = items[ids[i]];
+        if (!rest) continue;
+        items[ids[i]] = undefined;
+        rest._timerId = -1;
+        arm(rest, 0);
+      }
+    }
+  }
+};
 
-  var list;
 
-  if (lists[msecs]) {
-    list = lists[msecs];
+function arm(item, msecs) {
+  var id = item._timerId;
+  if (id >= 0 && items[id] === item) {
+    // the wheel hands out a new id if this one already fired, e.g. when a
+    // callback re-arms an item that comes later in the same batch
+    items[id] = undefined;
   } else {
-    list = new Timer();
-    list.start(msecs, 0);
-
-    L.init(list);
-
-    lists[msecs] = list;
-
-    list.ontimeout = function() {
-      debug('timeout callback ' + msecs);
-
-      var now = new Date();
-      debug('now: ' + now);
-
-      var first;
-      while (first = L.peek(list)) {
-        var diff = now - first._idleStart;
-        if (diff + 1 < msecs) {
-          list.start(msecs - diff, 0);
-          debug(msecs + ' list wait because diff is ' + diff);
-          return;
-        } else {
-          L.remove(first);
-          assert(first !== L.peek(list));
-          if (first._onTimeout) first._onTimeout();
-        }
-      }
-
-      debug(msecs + ' list empty');
-      assert(L.isEmpty(list));
-      list.close();
-      delete lists[msecs];
-    };
+    id = -1;
   }
-
-  L.append(list, item);
-  assert(!L.isEmpty(list)); // list is not empty
+  id = wheel.reset(id, msecs);
+  item._timerId = id;
+  items[id] = item;
 }
 
 
 var unenroll = exports.unenroll = function(item) {
-  L.remove(item);
-
-  var list = lists[item._idleTimeout];
-  // if empty then stop the watcher
+  var id = item._timerId;
   debug('unenroll');
-  if (list && L.isEmpty(list)) {
-    debug('unenroll: list empty');
-    list.close();
-    delete lists[item._idleTimeout];
+  if (id >= 0 && items[id] === item) {
+    wheel.remove(id);
+    items[id] = undefined;
   }
+  item._timerId = -1;
 };
 
 
 // Does not start the time, just sets up the members needed.
 exports.enroll = function(item, msecs) {
-  // if this item was already in a list somewhere
-  // then we should unenroll it from that
-  if (item._idleNext) unenroll(item);
+  // if this item was already armed then disarm it
+  unenroll(item);
 
   item._idleTimeout = msecs;
-  L.init(item);
 };
 
 
@@ -126,15 +106,13 @@ exports.enroll = function(item, msecs) {
 // it will reset its timeout.
 exports.active = function(item) {
   var msecs = item._idleTimeout;
-  if (msecs >= 0) {
-    var list = lists[msecs];
-    if (!list || L.isEmpty(list)) {
-      insert(item, msecs);
-    } else {
-      item._idleStart = new Date();
-      L.append(list, item);
-    }
-  }
+  if (msecs >= 0) arm(item, msecs);
+};
+
+
+// Counters and occupancy of the timer wheel.
+exports.wheelStats = function() {
+  return wheel.stats();
 };
 
 
@@ -144,78 +122,52 @@ exports.active = function(item) {
 
 
 exports.setTimeout = function(callback, after) {
-  var timer, c, args;
+  var timer = { _idleTimeout: after > 0 ? after : 0, _timerId: -1 };
 
-  if (after <= 0) {
-    // Use the slow case for after == 0
-    timer = new Timer();
-    timer.ontimeout = callback;
-
-    args = Array.prototype.slice.call(arguments, 2);
+  if (arguments.length <= 2) {
+    timer._onTimeout = callback;
+  } else {
+    /*
+     * Sometimes setTimeout is called with arguments, EG
+     *
+     *   setTimeout(callback, 2000, "hello", "world")
+     *
+     * If that's the case we need to call the callback with
+     * those args. The overhead of an extra closure is not
+     * desired in the normal case.
+     */
+    var args = Array.prototype.slice.call(arguments, 2);
     timer._onTimeout = function() {
       callback.apply(timer, args);
-      timer.close();
-    }
-
-    timer.start(0, 0);
-  } else {
-    timer = { _idleTimeout: after };
-    timer._idlePrev = timer;
-    timer._idleNext = timer;
-
-    if (arguments.length <= 2) {
-      timer._onTimeout = callback;
-    } else {
-      /*
-       * Sometimes setTimeout is called with arguments, EG
-       *
-       *   setTimeout(callback, 2000, "hello", "world")
-       *
-       * If that's the case we need to call the callback with
-       * those args. The overhead of an extra closure is not
-       * desired in the normal case.
-       */
-      args = Array.prototype.slice.call(arguments, 2);
-      timer._onTimeout = function() {
-        callback.apply(timer, args);
-      }
-    }
-
-    exports.active(timer);
+    };
   }
 
+  exports.active(timer);
   return timer;
 };
 
 
 exports.clearTimeout = function(timer) {
-  if (timer && (timer.ontimeout || timer._onTimeout)) {
-    timer.ontimeout = timer._onTimeout = null;
-    if (timer instanceof Timer) {
-      timer.close(); // for after === 0
-    } else {
-      exports.unenroll(timer);
-    }
+  if (timer && timer._onTimeout) {
+    timer._onTimeout = null;
+    unenroll(timer);
   }
 };
 
 
 exports.setInterval = function(callback, repeat) {
-  var timer = new Timer();
+  var timer = { _idleTimeout: repeat > 0 ? repeat : 0, _timerId: -1 };
+  var interval = repeat > 0 ? repeat : 1;
 
   var args = Array.prototype.slice.call(arguments, 2);
-  timer.ontimeout = function() {
+  timer._onTimeout = function() {
+    arm(timer, interval);
     callback.apply(timer, args);
-  }
+  };
 
-  timer.start(repeat, repeat ? repeat : 1);
+  exports.active(timer);
   return timer;
 };
 
 
-exports.clearInterval = function(timer) {
-  if (timer instanceof Timer) {
-    timer.ontimeout = null;
-    timer.close();
-  }
-};
+exports.clearInterval = exports.clearTimeout;
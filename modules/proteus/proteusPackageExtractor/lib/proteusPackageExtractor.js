@@ -43,12 +43,7 @@ var readUInt32LE = function (buf, index) {
     if (index+3 >= buf.length) {
         throwError('INVALID_VALUES_ERR');
     }
-    var b1 = buf[index].charCodeAt(0),
-        b2 = buf[index+1].charCodeAt(0),
-        b3 = buf[index+2].charCodeAt(0),
-        b4 = buf[index+3].charCodeAt(0);
-
-    return b1 + (b2 << 8) + (b3 << 16) + (b4 << 24);
+    return buf.readUInt32(index, 'little');
 };
 
 function validatePackJson(temporaryPath) {
@@ -76,7 +71,7 @@ function unzipAndInstall(zipObj, installPath, moduleName, successCB, failureCB)
         if (!path.existsSync(tempPath)) {
             fs.mkdirSync(tempPath, 448);
         }
-        var result = proteusUnzip.decompressZipBuffer(new Buffer(zipObj, 'binary'), tempPath);
+        var result = proteusUnzip.decompressZipBuffer(Buffer.isBuffer(zipObj) ? zipObj : new Buffer(zipObj, 'binary'), tempPath);
         if (result) {
             if (!(validatePackJson(tempPath))) {
                 throwError('NOT_FOUND_ERR', "Invalid package.json");
@@ -109,8 +104,8 @@ var extract = function (filePath, moduleName , successCB, failureCB) {
 var parseCRX = function (filePath, successCB, failureCB) {
     var buf, pkg = {};
     try {
-        buf = fs.readFileSync(filePath, 'binary');
-        pkg.magicNumber     = buf.slice(0, 4).toString();
+        buf = fs.readFileSync(filePath);
+        pkg.magicNumber     = buf.toString('binary', 0, 4);
         if (pkg.magicNumber !== "Cr24") {
             throwError('SECURITY_ERR', "Magic Number not matched");
         }
@@ -126,11 +121,10 @@ var parseCRX = function (filePath, successCB, failureCB) {
         if (pkg.publicKeyLength+pkg.signatureLength+8 >= buf.length) {
             throwError('SECURITY_ERR', "CRX file size is not correct");
         }
-        var stats = fs.lstatSync(filePath);
 
-        pkg.publicKey       = buf.slice(16, 16+pkg.publicKeyLength);
-        pkg.signature       = buf.slice(16+pkg.publicKeyLength, 16+pkg.publicKeyLength+pkg.signatureLength).toString('binary');
-        pkg.zip             = buf.slice(16+pkg.publicKeyLength+pkg.signatureLength, stats.size);
+        pkg.publicKey       = buf.toString('binary', 16, 16+pkg.publicKeyLength);
+        pkg.signature       = buf.toString('binary', 16+pkg.publicKeyLength, 16+pkg.publicKeyLength+pkg.signatureLength);
+        pkg.zip             = buf.slice(16+pkg.publicKeyLength+pkg.signatureLength, buf.length);
 
 
     } catch (err) {
@@ -96,6 +96,11 @@ class UnzipUtil: ObjectWrap {
     }
 
 
+    static void FreeScratch(char* data, void* hint)
+    {
+      free(data);
+    }
+
     static Handle<Value>  DecompressFile(const Arguments& args)
     {
       HandleScope scope;
@@ -132,16 +137,20 @@ class UnzipUtil: ObjectWrap {
       size = get_zipentry_size(entry);
       scratch = malloc(size);
 
+      if (scratch == NULL)
+	return v8::ThrowException(v8::String::New("out of memory"));
+
       int err;
       err = decompress_zipentry(entry, scratch, size);
       if (err != 0) {
 	NODE_LOGE("%s, error decompressing file\n", __FUNCTION__);
+	free(scratch);
 	return v8::ThrowException(v8::String::New("error decompressing file"));
       }
 
-      node::Buffer *return_buffer = node::Buffer::New( (char*)scratch, size );
-
-      free(scratch);
+      // the buffer adopts the decompressed data, no copy
+      node::Buffer *return_buffer = node::Buffer::New( (char*)scratch, size,
+                                                       FreeScratch, NULL );
 
       return scope.Close( return_buffer->handle_ );
 
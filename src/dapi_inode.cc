@@ -109,6 +109,26 @@ void INode::invokePending() {
   Node::InvokePending();
 }
 
+void INode::invokePending(unsigned int budgetUs) {
+  Node::InvokePending(budgetUs);
+}
+
+void INode::setInvokePendingBudget(unsigned int budgetUs) {
+  Node::SetInvokePendingBudget(budgetUs);
+}
+
+INode* INode::create(INodeClient *client) {
+  return Node::CreateINode(client);
+}
+
+void INode::setSparePoolSize(unsigned int size) {
+  Node::SetSparePoolSize(size);
+}
+
+void INode::trimMemory() {
+  Node::TrimMemory();
+}
+
 bool INode::queryInterface(Interface interface, void** object) {
   return m_private->queryInterface(interface, object);
 }
@@ -142,7 +142,7 @@ void INodeProxy::runInNodeContext(const char *module) {
     NODE_LOGV("runInNodeContext, creating Host context");
     m_context = Context::New();
     Context::Scope cscope(m_context);
-    m_inode = new INode(this);
+    m_inode = INode::create(this);
     si()->s_nodes.insert(m_inode);
   }
 
@@ -214,6 +214,11 @@ int Host::init(int argc, char *argv[]) {
       sleep(15);
     }
 
+    // bound the time spent per invokePending, e.g. --pending-budget=8000
+    if (strncmp(arg, "--pending-budget=", 17) == 0) {
+      INode::setInvokePendingBudget(atoi(arg + 17));
+    }
+
     if (!arg || arg[0] == '-') {
       continue;
     }
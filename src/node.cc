@@ -36,13 +36,22 @@
 #include <sys/time.h>
 
 #include <node_buffer.h>
+#include <node_hex.h>
 #include <node_io_watcher.h>
 #include <node_timer.h>
+#include <node_stat_watcher.h>
 #include <node_constants.h>
 #include <node_javascript.h>
 #include <node_string.h>
 #include <node_script.h>
+#include <node_mpsc_queue.h>
+#include <node_compile_cache.h>
+#include <node_trace.h>
+#include <node_slab.h>
+#include <node_read_pool.h>
+#include <node_net.h>
 #include <sys/resource.h>
+#include <semaphore.h>
 
 #ifdef ANDROID
 #include <sys/system_properties.h>
@@ -66,6 +75,90 @@ using namespace std;
 using namespace dapi;
 
 
+// client of the node instances that are not attached to a page yet, the
+// spares and the ones created by test.bootstrap(). Only provides the
+// webview the process object setup needs.
+class DetachedClient : public INodeClient, public INodeClientWebView {
+  public:
+    bool queryInterface(Interface interface, void** object) {
+      *object = interface == INTERFACE_WEBVIEW ? static_cast<INodeClientWebView*>(this) : 0;
+      return *object != 0;
+    }
+
+    const char* url() { return ""; }
+    const char* getEnvironmentProperty(const char *prop, bool) { return ""; }
+    void setScreenOrientationLock(const char *orientation) {}
+};
+
+// lock free handoff (NODE_LOCKFREE), instead of the mutex/cond handshake
+// the libev thread collects ready watchers into the loop's readyQueue,
+// signals the client and goes back to polling. Main thread drains the
+// queue without taking the loop mutex. Only one batch is in flight, libev
+// thread waits on drained before collecting the next one.
+struct ReadyWatcher : public MPSCNode {
+  ev_watcher* w;
+  int revents;
+  bool cancelled; // watcher stopped on the main thread after it was queued
+  bool last;
+};
+
+// An event loop along with the libev thread polling it. There is the
+// default loop, used by the service node and by every node when
+// NODE_LOOP_PER_NODE is off, and with it on each node gets a loop of its
+// own (up to s_maxLoops, the rest share the default one, spares only get
+// theirs once adopted), so a busy page
+// can't delay timers/io of the others and a node is torn down by stopping
+// its loop. ev_userdata() of the loop points back to its EvLoop.
+struct EvLoop {
+  struct ev_loop* loop;
+  pthread_t thread;
+  Node* owner;
+  volatile bool stopping;
+  bool retired; // owner deleted while its callbacks were being invoked
+
+  // synchronizing libev thread and main thread
+  // libev thread on start locks mutex and signals main thread callback and waits on a condition
+  // main thread takes the lock and signals the condition, liev thread resumes
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  volatile bool signalled; // libev thread is waiting on cond
+
+  // async watcher to keep event loop alive and to wake up the poll
+  ev_async wakeup;
+
+  // lock free handoff, see ReadyWatcher
+  MPSCQueue readyQueue;
+  MPSCQueue freeQueue; // drained nodes handed back to the libev thread
+  ReadyWatcher* collectHead;
+  ReadyWatcher* collectTail;
+  volatile unsigned int batch;
+  bool awaitingDrain; // libev thread only
+  sem_t drained;
+
+  // the batch in flight indexed by watcher (open addressing, the size is a
+  // power of two and at least twice the batch). Stopping a watcher on the
+  // main thread looks up its queued event here and marks it cancelled, this
+  // is what clear_pending does for regular ev_invoke_pending. Filled by the
+  // libev thread when publishing, both sides hold the loop lock
+  ReadyWatcher** readyIndex;
+  unsigned int readyIndexSize;
+  unsigned int readyCount; // 0 once the batch is drained
+
+  // scheduling counters, main thread only except for signals
+  uint64_t rounds;      // InvokePending calls that served this loop
+  uint64_t deferred;    // InvokePending calls that ran out of budget before it
+  uint64_t dispatched;  // watcher callbacks invoked
+  uint64_t busyNs;      // time spent in those callbacks
+  volatile unsigned int signals; // client signals raised by the libev thread
+
+  // telemetry, see process.loopStats(). Each histogram has a single writer,
+  // the libev thread (ev*, poll) or the main thread (main*)
+  LoopHistogram poll;
+  LoopHistogram evLockWait[LoopStats::LOCK_CONTEXTS];
+  LoopHistogram mainLockWait[LoopStats::LOCK_CONTEXTS];
+  uint64_t pollStart;
+};
+
 class NodeStatic {
   public:
     static NodeStatic* instance() {
@@ -86,26 +179,43 @@ class NodeStatic {
     // async watcher to signal libev for pending eio work
     uv_async_t s_eio_want_poll_notifier;
 
-    // async watcher to indicate done from eio callback to libev
-    uv_async_t s_eio_done_poll_notifier;
+    // eio completions are drained in batches bounded by s_eioMaxReqs
+    // requests and s_eioBudgetUs of callbacks. The batch doubles while the
+    // request count is what stops a drain and halves when the time budget
+    // runs out, so bursts of small completions (module install, unzip) take
+    // few loop iterations without starving the loop (NODE_EIO_BUDGET=<us>)
+    unsigned int s_eioBudgetUs;
+    unsigned int s_eioMaxReqs;
+    unsigned int s_eioDrains;
+    unsigned int s_eioCompleted;
+    volatile unsigned int s_eioWakeups;
+    LoopHistogram s_eioDepth;
+    LoopHistogram s_eioDrainStats;
+    bool DrainEio();
 
-    // async watcher to keep event loop alive
-    uv_async_t s_ev_async_watcher;
-
-    // libev thread handle
-    pthread_t s_evThread;
     pthread_t s_mainThread;
     pthread_t s_watcherThread;
 
-    // synchronizing libev thread and main thread
-    // libev thread on start locks mutex and signals main thread callback and waits on a condition
-    // main thread takes the lock and signals the condition, liev thread resumes
-    pthread_mutex_t s_mutex;
-    pthread_cond_t s_cond;
-
     pthread_mutex_t s_activity_mutex;
     pthread_cond_t s_activity_cond;
 
+    bool s_lockFree;
+    EvLoop* s_defaultLoop;
+    std::vector<EvLoop*> s_loops;       // loops with a running libev thread
+    std::vector<EvLoop*> s_parkedLoops; // stopped loops, reused by new nodes
+    bool s_loopPerNode;
+    unsigned int s_maxLoops;  // loops besides the default one
+    unsigned int s_nextLoop;  // round robin start for InvokePending
+    EvLoop* s_dispatchLoop;   // loop whose callbacks are being invoked
+
+    // loop telemetry updated on the main thread, the rest is kept per loop
+    LoopHistogram s_invokeStats;
+    LoopHistogram s_pendingStats;
+    LoopHistogram s_tickStats;
+    static void HistogramAdd(LoopHistogram &h, uint64_t value);
+    static void HistogramMerge(LoopHistogram &to, const LoopHistogram &from);
+    void GetLoopStats(LoopStats *stats);
+
     // global list of all active v8 contexts
     std::vector<v8::Persistent<v8::Context>* > s_contexts;
 
@@ -139,9 +249,25 @@ class NodeStatic {
     // This starts a separate thread for the libev event loop,
     // overrides ev_invoke_pending and indicates back to the embedder
     // to process events which invokes actual ev_invoke_pending
-    // There's only event loop created per process
+    // This runs the default loop, see EvLoop for the per node loops
     void RunEventLoop();
 
+    // per node loops
+    EvLoop* CreateLoop(struct ev_loop *loop);
+    void StartLoop(EvLoop *el);
+    void StopLoop(EvLoop *el);
+    EvLoop* AcquireLoop(Node *owner);
+    void ReleaseLoop(EvLoop *el);
+    static EvLoop* LoopFor(struct ev_loop *loop) {
+      return static_cast<EvLoop*>(ev_userdata(loop));
+    }
+
+    // picks the loop for new uv handles, the loop of the node whose context
+    // is current, otherwise the loop being dispatched (default if none)
+    static struct ev_loop* CurrentLoop();
+    static void EvWakeupCallback(EV_P_ ev_async *w, int revents);
+    void DumpLoopStats();
+
     // This is the function which we override ev_invoke_pending
     // gets called on the libev thread whenever there is pending work
     // we signal callback and wait on the condition till the main thread
@@ -153,24 +279,36 @@ class NodeStatic {
     // In test mode, it returns if there are no pending work (e.g. no watchers), and
     // sends out a NODE_EVENT_DONE to the embedder
     static void* EvThreadRun(void *data);
-    void InvokePending();
+    void InvokePending(unsigned int budgetUs);
+    bool InvokeLoop(EvLoop *el, bool budgeted);
     void (*s_clientCallback)();
 
+    // time budget for InvokePending in microseconds (0 is unlimited) and
+    // the deadline of the current InvokePending in uv_hrtime() units
+    unsigned int s_pendingBudgetUs;
+    uint64_t s_pendingDeadline;
+    static int PendingBudgetExpired(struct ev_loop *loop);
+
+    // lock free handoff, see ReadyWatcher
+    static void CollectReady(struct ev_loop *loop, void *w, int revents);
+    void PublishReady(EvLoop *el);
+    bool DrainReady(EvLoop *el, bool budgeted);
+
     // idle watcher callback that triggers eio_poll
     static void DoPoll(uv_idle_t* watcher, int status);
 
     // async watcher callback that will invoke eio_poll
     static void WantPollNotifier(uv_async_t* watcher, int status);
 
-    // done watcher callback, invoke eio_poll and stop the idle watcher if there is no pending work
-    static void DonePollNotifier(uv_async_t* watcher, int revents);
-
     // called in context of eio thread to indicate need for polling
     static void EIOWantPoll(void);
 
-    // called in context of eio thread to indicate done requests and no need for poll
+    // called from eio_poll() on the main thread once the completion queue is empty
     static void EIODonePoll(void);
 
+    // JS API - process.eioStats()
+    static Handle<Value> ProcessEioStats(const Arguments& args);
+
     // called on main thread when we send an event to check test results..
     static void TestCheckNotifier(EV_P_ ev_async *w, int status);
 
@@ -226,6 +364,17 @@ class NodeStatic {
 
     static void HandleSIGSEGV(int signal);
 
+    // binary trace of the log messages, filtered ones included, dumped on
+    // crash, on SIGUSR2 and through process.traceDump() (NODE_TRACE=<entries
+    // per thread>), see NodeTrace
+    // SIGUSR2 only wakes up the default loop, the dump runs on the main
+    // thread from TraceDumpNotifier
+    static void HandleSIGUSR2(int signal);
+    uv_async_t s_traceDumpNotifier;
+    static void TraceDumpNotifier(uv_async_t* watcher, int status);
+    static void TraceToLog(const char* line, void* data);
+    static Handle<Value> ProcessTraceDump(const Arguments& args);
+
     // print stack from js code e.g. test.stack();
     static v8::Handle<v8::Value> TestStack(const v8::Arguments& args);
     DAPILogPriority StringToLog(const char* log);
@@ -233,11 +382,84 @@ class NodeStatic {
     // initiliaze logging
     void ReadDebugLevel();
 
+    // Compiled bootstrap code shared by all the node instances. node.js and
+    // the builtin modules are compiled once, context independent, and every
+    // new node runs them from here instead of compiling from scratch
+    // (NODE_NATIVE_CACHE=0 turns this off)
+    bool s_nativeCache;
+    std::map<std::string, v8::Persistent<v8::Script> > s_nativeScripts;
+    unsigned int s_nativeHits;
+    unsigned int s_nativeMisses;
+    // preparse data of the natives and the module wrappers is kept on disk
+    // next to the module root, see CompileCache (NODE_COMPILE_CACHE=<max
+    // size in KB>, 0 turns it off)
+    bool s_compileCache;
+    unsigned int s_compileCacheKB;
+    Local<Script> NativeScript(const char* id, Handle<Value> filename);
+
+    // JS API - process._runNative(id), used by NativeModule
+    static Handle<Value> RunNative(const Arguments& args);
+
+    // Bootstrapped node instances kept ready for INode::create(), so a page
+    // attaches to a node without waiting for it to load. Spares are built
+    // on the main thread (v8 is single threaded) when the loops are idle,
+    // one per InvokePending round, inside a context of their own and are
+    // rebound to the page context on adoption (NODE_SPARE_POOL=<size>)
+    unsigned int s_sparePoolSize;
+    std::vector<INode*> s_spares;
+    DetachedClient s_spareClient;
+    v8::Persistent<v8::Context> s_spareContext;
+    bool s_buildingSpare;
+    unsigned int s_sparesAdopted;
+    unsigned int s_sparesMissed;
+    unsigned int s_sparesTrimmed;
+    LoopHistogram s_attachStats;
+    LoopHistogram s_spareBuildStats;
+    void RefillSpares();
+    void TrimSpares();
+
+    // JS API - process.sparePoolStats()
+    static Handle<Value> ProcessSparePoolStats(const Arguments& args);
+
+    // Paused nodes have their timers coalesced to s_backgroundTimerMs,
+    // polling stat watchers and tick spinners stopped. Once every node is
+    // paused the process is in background: spares are released, eio drains
+    // everything in one go instead of spinning the idle poller and each
+    // InvokePending round counts as a wakeup (NODE_BACKGROUND_TIMER=<ms>)
+    unsigned int s_backgroundTimerMs;
+    unsigned int s_pausedNodes;
+    // spares are in s_nodes as well but never get paused
+    size_t PausableNodes() { return s_nodes.size() - s_spares.size(); }
+    bool s_background;
+    uint64_t s_backgroundSince;
+    uint64_t s_backgroundTime;
+    unsigned int s_backgroundWakeups;
+    unsigned int s_backgroundWakeupsTotal;
+    void EnterBackground();
+    void LeaveBackground();
+
+    // buffers are allocated from a slab heap per node (NODE_SLAB=0 turns
+    // this off)
+    bool s_slab;
+
+    // JS API - process.backgroundStats()
+    static Handle<Value> ProcessBackgroundStats(const Arguments& args);
+
+    // creates and deletes node instances, returns the average time to
+    // bootstrap one in ms. usage: test.bootstrap(count)
+    static v8::Handle<v8::Value> TestBootstrap(const v8::Arguments& args);
+
+    // same as the client pausing/resuming this node. usage: test.pause(bool)
+    static v8::Handle<v8::Value> TestPause(const v8::Arguments& args);
+
     // Logger, similar to console.log
     static Handle<Value> ProcessLog(const Arguments& args);
     static Handle<Value> LoopRef(const Arguments& args);
     static Handle<Value> LoopUnref(const Arguments& args);
 
+    // JS API - process.loopStats(), see dapi::LoopStats
+    static Handle<Value> ProcessLoopStats(const Arguments& args);
+
     // dump watcher stats from javascript
     // JS API - test.watcherStats();
     static v8::Handle<v8::Value> TestWatcherStats(const v8::Arguments& args);
@@ -252,7 +474,6 @@ class NodeStatic {
     static Handle<Value> ExitBrowserContext(const Arguments& args);
     static Handle<Value> EvalInHostContext(const Arguments& args);
     static Handle<Value> CallInHostContext(const Arguments& args);
-    static void EvAsyncCallback(uv_async_t* watcher, int revents);
 
     enum LockContext {
       LOCK_EV_START,
@@ -261,10 +482,10 @@ class NodeStatic {
       LOCK_EV_WATCHER
     };
     static const char* LockContextStr[];
-    void Lock_(LockContext);
-    void UnLock_(LockContext);
-    void Wait_();
-    void Signal_();
+    void Lock_(EvLoop*, LockContext);
+    void UnLock_(EvLoop*, LockContext);
+    void Wait_(EvLoop*);
+    void Signal_(EvLoop*);
 
     bool IsMainThread();
     pthread_mutex_t s_log_mutex;
@@ -303,11 +524,28 @@ Node* Node::GetNodeFromObject(Handle<Object> o) {
   return inode->m_node;
 }
 
+Node* Node::GetCurrentNode() {
+  INode *inode = INode::getCurrentINode();
+  NODE_ASSERT(inode && inode->m_node);
+  return inode->m_node;
+}
+
+SlabHeap* Node::CurrentSlab() {
+  HandleScope scope;
+  Local<Value> proto = Context::GetCurrent()->Global()->GetPrototype();
+  if (!proto->IsObject() || proto->ToObject()->InternalFieldCount() != 1) {
+    return NULL;
+  }
+  INode *inode = static_cast<INode*>(proto->ToObject()->GetPointerFromInternalField(0));
+  return inode && inode->m_node ? inode->m_node->m_slab : NULL;
+}
+
 void Node::Tick(void) {
   NODE_LOGM("Node::Tick()");
 
   // Avoid entering a V8 scope.
   if (!m_need_tick_cb) return;
+  uint64_t start = uv_hrtime();
 
   // FIXME (proteus): required for FatalException
   HandleScope scope;
@@ -335,6 +573,7 @@ void Node::Tick(void) {
   if (try_catch.HasCaught()) {
     si()->FatalException(try_catch);
   }
+  NodeStatic::HistogramAdd(si()->s_tickStats, (uv_hrtime() - start) / 1000);
 }
 
 void NodeStatic::Spin(uv_idle_t* handle, int status) {
@@ -351,6 +590,10 @@ Handle<Value> NodeStatic::NeedTickCallback(const Arguments& args) {
 
   Node *n = Node::GetNodeFromObject(args.Holder());
   n->m_need_tick_cb = true;
+  // paused nodes tick from their prepare/check watchers only
+  if (n->m_paused) {
+    return Undefined();
+  }
   // TODO: this tick_spinner shouldn't be necessary. An ev_prepare should be
   // sufficent, the problem is only in the case of the very last "tick" -
   // there is nothing left to do in the event loop and libev will exit. The
@@ -382,11 +625,44 @@ void NodeStatic::CheckTick(uv_check_t* handle, int status) {
   n->Tick();
 }
 
+// bounds on the eio batch, see s_eioMaxReqs
+#define EIO_MIN_POLL_REQS 10
+#define EIO_MAX_POLL_REQS 512
+
+bool NodeStatic::DrainEio() {
+  unsigned int depth = eio_npending();
+  HistogramAdd(s_eioDepth, depth);
+
+  uint64_t start = uv_hrtime();
+  bool more = eio_poll() == -1;
+  uint64_t elapsed = (uv_hrtime() - start) / 1000;
+  HistogramAdd(s_eioDrainStats, elapsed);
+
+  unsigned int left = eio_npending();
+  s_eioCompleted += depth > left ? depth - left : 0;
+  s_eioDrains++;
+
+  if (more && !s_background) {
+    unsigned int maxReqs = s_eioMaxReqs;
+    if (elapsed >= s_eioBudgetUs) {
+      maxReqs = maxReqs / 2 < EIO_MIN_POLL_REQS ? EIO_MIN_POLL_REQS : maxReqs / 2;
+    } else if (maxReqs < EIO_MAX_POLL_REQS) {
+      maxReqs *= 2;
+    }
+    if (maxReqs != s_eioMaxReqs) {
+      NODE_LOGV("%s, %u completions left, batch %u -> %u", __FUNCTION__, left, s_eioMaxReqs, maxReqs);
+      s_eioMaxReqs = maxReqs;
+      eio_set_max_poll_reqs(s_eioMaxReqs);
+    }
+  }
+  return more;
+}
+
 void NodeStatic::DoPoll(uv_idle_t* watcher, int status) {
   NODE_LOGF();
   NODE_ASSERT(watcher == &si()->s_eio_poller);
 
-  if (eio_poll() != -1 && uv_is_active((uv_handle_t*)&si()->s_eio_poller)) {
+  if (!si()->DrainEio() && uv_is_active((uv_handle_t*)&si()->s_eio_poller)) {
     NODE_LOGV("s_eio_poller(%p) stopped", &si()->s_eio_poller);
     uv_idle_stop(&si()->s_eio_poller);
     uv_unref();
@@ -399,38 +675,27 @@ void NodeStatic::WantPollNotifier(uv_async_t* watcher, int status) {
   NODE_ASSERT(watcher == &si()->s_eio_want_poll_notifier);
 
   NODE_LOGV("WantPollNotifier/eio_poll()");
-  if (eio_poll() == -1 && !uv_is_active((uv_handle_t*) &si()->s_eio_poller)) {
+  if (si()->DrainEio() && !uv_is_active((uv_handle_t*) &si()->s_eio_poller)) {
     NODE_LOGV("s_eio_poller(%p) started", &si()->s_eio_poller);
     uv_idle_start(&si()->s_eio_poller, DoPoll);
     uv_ref();
   }
 }
 
-void NodeStatic::DonePollNotifier(uv_async_t* watcher, int revents) {
-  NODE_LOGF();
-  NODE_ASSERT(watcher == &si()->s_eio_done_poll_notifier);
-
-  NODE_LOGV("DonePollNotifier/eio_poll()");
-  if (eio_poll() != -1 && uv_is_active((uv_handle_t*) &si()->s_eio_poller)) {
-    NODE_LOGV("s_eio_poller(%p) stopped", &si()->s_eio_poller);
-    uv_idle_stop(&si()->s_eio_poller);
-    uv_unref();
-  }
-}
-
 // EIOWantPoll() is called from the EIO thread pool each time an EIO
 // request (that is, one of the node.fs.* functions) has completed.
 void NodeStatic::EIOWantPoll(void) {
   // Signal the main thread that eio_poll need to be processed.
   NODE_LOGV("EIOWantPoll (eio->main)");
+  __sync_fetch_and_add(&si()->s_eioWakeups, 1);
   uv_async_send(&si()->s_eio_want_poll_notifier);
 }
 
 void NodeStatic::EIODonePoll(void) {
-  NODE_LOGV("EIODonePoll (eio->main)");
-  // Signal the main thread that we should stop calling eio_poll().
-  // from the idle watcher.
-  uv_async_send(&si()->s_eio_done_poll_notifier);
+  // Nothing to do, eio only calls this from within eio_poll() and the
+  // poller is stopped from DrainEio()'s return value. This used to be an
+  // async round trip to the main thread for every drained queue.
+  NODE_LOGV("EIODonePoll");
 }
 
 static inline const char *errno_string(int errorno) {
@@ -653,6 +918,14 @@ Local<Value> Node::Encode(const void *buf, size_t len, enum encoding encoding) {
     return scope.Close(chunk);
   }
 
+  if (encoding == HEX) {
+    char *hex = new char[len * 2];
+    hex_encode(static_cast<const char*>(buf), len, hex);
+    Local<String> chunk = String::New(hex, len * 2);
+    delete [] hex;
+    return scope.Close(chunk);
+  }
+
   // utf8 or ascii encoding
   Local<String> chunk = String::New((const char*)buf, len);
   return scope.Close(chunk);
@@ -708,6 +981,9 @@ ssize_t Node::DecodeWrite(char *buf, size_t buflen, Handle<Value> val, enum enco
     str->WriteAscii(buf, 0, buflen, String::HINT_MANY_WRITES_EXPECTED);
     return buflen;
   }
+  if (encoding == HEX) {
+    return hex_decode(str, buf, buflen);
+  }
 
   // THIS IS AWFUL!!! FIXME
   NODE_ASSERT(encoding == BINARY);
@@ -802,6 +1078,80 @@ Local<Value> Node::ExecuteString(Handle<String> source, Handle<Value> filename)
   return scope.Close(result);
 }
 
+// The source of a native script is always looked up here from the natives
+// table by id, never taken from the caller, so nothing but the builtin code
+// can end up in the shared scripts. "node" is src/node.js itself, the other
+// ids are builtin modules wrapped like NativeModule.wrap.
+static Handle<String> NativeSource(const char* id) {
+  if (strcmp(id, "node") == 0) {
+    return MainSource();
+  }
+
+  Handle<String> source = ModuleSource(id);
+  if (source.IsEmpty()) {
+    return source;
+  }
+  source = String::Concat(IMMUTABLE_STRING(
+      "(function (process, exports, require, module, __filename, __dirname, Buffer) { "),
+      source);
+  return String::Concat(source, IMMUTABLE_STRING("\n});"));
+}
+
+Local<Script> NodeStatic::NativeScript(const char* id, Handle<Value> filename) {
+  HandleScope scope;
+  if (s_nativeCache) {
+    std::map<std::string, Persistent<Script> >::iterator it = s_nativeScripts.find(id);
+    if (it != s_nativeScripts.end()) {
+      s_nativeHits++;
+      return scope.Close(Local<Script>::New(it->second));
+    }
+  }
+
+  Handle<String> source = NativeSource(id);
+  if (source.IsEmpty()) {
+    ThrowException(Exception::Error(
+        String::Concat(String::New("No such native module "), String::New(id))));
+    return Local<Script>();
+  }
+
+  ScriptOrigin origin(filename);
+  ScriptData* pre_data = CompileCache::Get(source);
+  if (!s_nativeCache) {
+    Local<Script> script = Script::Compile(source, &origin, pre_data);
+    delete pre_data;
+    return scope.Close(script);
+  }
+
+  s_nativeMisses++;
+  Local<Script> script = Script::New(source, &origin, pre_data);
+  delete pre_data;
+  if (!script.IsEmpty()) {
+    s_nativeScripts[id] = Persistent<Script>::New(script);
+  }
+  return scope.Close(script);
+}
+
+Handle<Value> NodeStatic::RunNative(const Arguments& args) {
+  HandleScope scope;
+  NODE_ASSERT(args.Length() == 1);
+
+  String::Utf8Value id(args[0]);
+  std::string filename = std::string(*id) + ".js";
+  TryCatch try_catch;
+  Local<Script> script = si()->NativeScript(*id, String::New(filename.c_str()));
+  if (script.IsEmpty()) {
+    si()->ReportException(try_catch, true);
+    return try_catch.ReThrow();
+  }
+
+  Local<Value> result = script->Run();
+  if (result.IsEmpty()) {
+    si()->ReportException(try_catch, true);
+    return try_catch.ReThrow();
+  }
+  return scope.Close(result);
+}
+
 // Caller needs to have a scope to get the return result
 Local<Value> Node::RunScriptInServiceNode(Handle<String> source) {
   Node *n = si()->ServiceNode();
@@ -1183,7 +1533,7 @@ Handle<Value> NodeStatic::ProcessLog(const Arguments& args) {
   NODE_ASSERT(args[0]->IsNumber());
   NODE_ASSERT(args[1]->IsString());
   String::AsciiValue message(args[1]);
-  DAPILog(args[0]->ToNumber()->Value(), "node-js", *message);
+  DAPILog(args[0]->ToNumber()->Value(), "node-js", "%s", *message);
   return Undefined();
 }
 
@@ -1195,6 +1545,35 @@ Handle<Value> NodeStatic::TestSleep(const Arguments &args) {
   return Handle<Value>();
 }
 
+Handle<Value> NodeStatic::TestBootstrap(const Arguments &args) {
+  HandleScope scope;
+  unsigned int count = args.Length() > 0 ? args[0]->Uint32Value() : 1;
+  if (!count) {
+    return Undefined();
+  }
+
+  DetachedClient client;
+  uint64_t total = 0;
+  for (unsigned int i = 0; i < count; i++) {
+    uint64_t start = uv_hrtime();
+    INode *inode = new INode(&client);
+    total += uv_hrtime() - start;
+    delete inode;
+  }
+  return scope.Close(Number::New(total / 1e6 / count));
+}
+
+Handle<Value> NodeStatic::TestPause(const Arguments &args) {
+  HandleScope scope;
+  Node *n = Node::GetCurrentNode();
+  if (args[0]->IsFalse()) {
+    n->onResume();
+  } else {
+    n->onPause();
+  }
+  return Undefined();
+}
+
 Handle<Value> NodeStatic::TestContext(const Arguments &args) {
   HandleScope scope;
   Node *n = Node::GetNodeFromObject(args.Holder());
@@ -1401,12 +1780,14 @@ Handle<Value> NodeStatic::ExitBrowserContext(const Arguments& args) {
 }
 
 Handle<Value> NodeStatic::LoopRef(const Arguments& args) {
-  ev_ref(ev_default_loop());
+  Node *n = Node::GetNodeFromObject(args.Holder());
+  ev_ref(n->m_loop->loop);
   return Handle<Value>();
 }
 
 Handle<Value> NodeStatic::LoopUnref(const Arguments& args) {
-  ev_unref(ev_default_loop());
+  Node *n = Node::GetNodeFromObject(args.Holder());
+  ev_unref(n->m_loop->loop);
   return Handle<Value>();
 }
 
@@ -1465,6 +1846,17 @@ void Node::SetupProcessObject() {
   NODE_SET_METHOD(m_process, "hasBinding", NodeStatic::HasBinding);
   NODE_SET_METHOD(m_process, "log", NodeStatic::ProcessLog);
   NODE_SET_METHOD(m_process, "ref", NodeStatic::LoopRef);
+  NODE_SET_METHOD(m_process, "loopStats", NodeStatic::ProcessLoopStats);
+  NODE_SET_METHOD(m_process, "_runNative", NodeStatic::RunNative);
+  NODE_SET_METHOD(m_process, "compileCacheStats", CompileCache::Stats);
+  NODE_SET_METHOD(m_process, "sparePoolStats", NodeStatic::ProcessSparePoolStats);
+  NODE_SET_METHOD(m_process, "eioStats", NodeStatic::ProcessEioStats);
+  NODE_SET_METHOD(m_process, "traceDump", NodeStatic::ProcessTraceDump);
+  NODE_SET_METHOD(m_process, "backgroundStats", NodeStatic::ProcessBackgroundStats);
+  NODE_SET_METHOD(m_process, "utf8Stats", Buffer::Utf8Stats);
+  NODE_SET_METHOD(m_process, "slabStats", SlabHeap::Stats);
+  NODE_SET_METHOD(m_process, "readPoolStats", ReadPool::Stats);
+  NODE_SET_METHOD(m_process, "acceptStats", AcceptStats);
   NODE_SET_METHOD(m_process, "unref", NodeStatic::LoopUnref);
 
   // proteus: used to create a new js object that can hold internal fields
@@ -1515,6 +1907,8 @@ void Node::SetupProcessObject() {
   NODE_SET_METHOD(m_test, "sleep", NodeStatic::TestSleep);
   NODE_SET_METHOD(m_test, "watcherThread", NodeStatic::TestWatcherThread);
   NODE_SET_METHOD(m_test, "context", NodeStatic::TestContext);
+  NODE_SET_METHOD(m_test, "bootstrap", NodeStatic::TestBootstrap);
+  NODE_SET_METHOD(m_test, "pause", NodeStatic::TestPause);
   NODE_SET_METHOD(m_test, "exitCode", NodeStatic::TestExitCode);
   NODE_SET_METHOD(m_test, "watchers", NodeStatic::TestWatchers);
 
@@ -1537,7 +1931,11 @@ void Node::Load() {
   // The node.js file returns a function 'f'
   HandleScope scope;
   TryCatch try_catch;
-  Local<Value> f_value = ExecuteString(MainSource(), IMMUTABLE_STRING("node.js"));
+  Local<Script> script = si()->NativeScript("node", IMMUTABLE_STRING("node.js"));
+  Local<Value> f_value;
+  if (!script.IsEmpty()) {
+    f_value = script->Run();
+  }
   if (try_catch.HasCaught())  {
     ReportException(try_catch, true);
     return;
@@ -1565,6 +1963,8 @@ void Node::Load() {
   Local<Array> array = Local<Array>::Cast(arrayV);
   m_loadModule = Persistent<Function>::New(Local<Function>::Cast(array->Get(0)));
   m_require = Persistent<Function>::New(Local<Function>::Cast(array->Get(1)));
+  NODE_LOGD("%s, native scripts hits(%u) misses(%u)", __FUNCTION__,
+      si()->s_nativeHits, si()->s_nativeMisses);
 }
 
 Handle<Function> Node::GetLoadModule() {
@@ -1642,6 +2042,8 @@ void NodeStatic::Initialize() {
   RegisterSignalHandler(SIGPIPE, SIG_IGN);
   RegisterSignalHandler(SIGTRAP, SIG_IGN);
   ReadDebugLevel();
+  CompileCache::Initialize(s_appPath + "/.compile-cache", s_compileCache,
+      (size_t) s_compileCacheKB * 1024);
 
   // start the memleak watcher on demand..
   if (s_memLeak) {
@@ -1662,57 +2064,82 @@ void NodeStatic::Initialize() {
   uv_async_init(&s_eio_want_poll_notifier, WantPollNotifier);
   uv_unref();
 
-  uv_async_init(&s_eio_done_poll_notifier, DonePollNotifier);
-  uv_unref();
+  if (NodeTrace::enabled()) {
+    uv_async_init(&s_traceDumpNotifier, TraceDumpNotifier);
+    uv_unref();
+    RegisterSignalHandler(SIGUSR2, HandleSIGUSR2);
+  }
 
   eio_init(EIOWantPoll, EIODonePoll);
 
-  // Don't handle more than 10 reqs on each eio_poll(). This is to avoid
-  // race conditions. See test/simple/test-eio-race.js
-  eio_set_max_poll_reqs(10);
+  // Bound each eio_poll() so a stream of completions can't starve the loop,
+  // see test/simple/test-eio-race.js and DrainEio()
+  eio_set_max_poll_reqs(s_eioMaxReqs);
+  eio_set_max_poll_time(s_eioBudgetUs / 1e6);
   memset(&s_watchers_active, 0, sizeof(s_watchers_active));
 
-  // watcher to keep alive the event loop and signal active watchers
-  uv_async_init(&s_ev_async_watcher, EvAsyncCallback);
+  // new uv handles go to the loop of the node they are created for
+  uv_set_loop_cb(CurrentLoop);
 
   // start the event thread
   si()->RunEventLoop();
 }
 
-void NodeStatic::Lock_(LockContext context) {
-  NODE_LOGM("NODE_LOCK: %s, %s thread lock L1",
-      IsMainThread() ? "Main" : "EV", LockContextStr[context]);
-  pthread_mutex_lock(&s_mutex);
+void NodeStatic::Lock_(EvLoop *el, LockContext context) {
+  bool mainThread = IsMainThread();
+  NODE_LOGM("NODE_LOCK: %s, %s thread lock L1 (%p)",
+      mainThread ? "Main" : "EV", LockContextStr[context], el);
+
+  // only time the contended case, this is taken on every watcher start/stop
+  LoopHistogram &wait = mainThread ? el->mainLockWait[context] : el->evLockWait[context];
+  if (pthread_mutex_trylock(&el->mutex) == 0) {
+    HistogramAdd(wait, 0);
+    return;
+  }
+  uint64_t start = uv_hrtime();
+  pthread_mutex_lock(&el->mutex);
+  HistogramAdd(wait, (uv_hrtime() - start) / 1000);
 }
 
-void NodeStatic::UnLock_(LockContext context) {
-  pthread_mutex_unlock(&s_mutex);
-  NODE_LOGM("NODE_LOCK: %s, %s thread unlock L1",
-      IsMainThread() ? "Main" : "EV", LockContextStr[context]);
+void NodeStatic::UnLock_(EvLoop *el, LockContext context) {
+  pthread_mutex_unlock(&el->mutex);
+  NODE_LOGM("NODE_LOCK: %s, %s thread unlock L1 (%p)",
+      IsMainThread() ? "Main" : "EV", LockContextStr[context], el);
 }
 
-void NodeStatic::Wait_() {
-  NODE_LOGM("NODE_LOCK: %s, EV_PENDING thread wait C1", IsMainThread() ? "Main" : "EV");
-  pthread_cond_wait(&s_cond, &s_mutex);
-  NODE_LOGM("NODE_LOCK: %s, EV_PENDING thread got C1", IsMainThread() ? "Main" : "EV");
+void NodeStatic::Wait_(EvLoop *el) {
+  NODE_LOGM("NODE_LOCK: %s, EV_PENDING thread wait C1 (%p)", IsMainThread() ? "Main" : "EV", el);
+  pthread_cond_wait(&el->cond, &el->mutex);
+  NODE_LOGM("NODE_LOCK: %s, EV_PENDING thread got C1 (%p)", IsMainThread() ? "Main" : "EV", el);
 }
 
-void NodeStatic::Signal_() {
-  NODE_LOGM("NODE_LOCK: %s, EV_PENDING thread signal C1", IsMainThread() ? "Main" : "EV");
-  pthread_cond_signal(&s_cond);
+void NodeStatic::Signal_(EvLoop *el) {
+  NODE_LOGM("NODE_LOCK: %s, EV_PENDING thread signal C1 (%p)", IsMainThread() ? "Main" : "EV", el);
+  pthread_cond_signal(&el->cond);
 }
 
-extern "C" void lock() {
-  si()->Lock_(NodeStatic::LOCK_EV_WATCHER);
+// loops without an EvLoop (e.g. the host loop of qnode) are only ever
+// used from one thread and don't need the lock
+extern "C" void lock(struct ev_loop *loop) {
+  EvLoop *el = NodeStatic::LoopFor(loop);
+  if (el) {
+    si()->Lock_(el, NodeStatic::LOCK_EV_WATCHER);
+  }
 }
 
-extern "C" void unlock() {
-  si()->UnLock_(NodeStatic::LOCK_EV_WATCHER);
+extern "C" void unlock(struct ev_loop *loop) {
+  EvLoop *el = NodeStatic::LoopFor(loop);
+  if (el) {
+    si()->UnLock_(el, NodeStatic::LOCK_EV_WATCHER);
+  }
 }
 
-extern "C" void wakeup() {
-  NODE_LOGM("NODE_LOCK: wakeup event send to ev thread");
-  uv_async_send(&si()->s_ev_async_watcher);
+extern "C" void wakeup(struct ev_loop *loop) {
+  EvLoop *el = NodeStatic::LoopFor(loop);
+  if (el) {
+    NODE_LOGM("NODE_LOCK: wakeup event send to ev thread (%p)", el);
+    ev_async_send(loop, &el->wakeup);
+  }
 }
 
 extern "C" int is_main_thread() {
@@ -1772,6 +2199,13 @@ void Node::Init() {
     si()->s_nodes.push_back(this);
   }
 
+  // handles created in this node's context are started on this loop
+  m_loop = si()->AcquireLoop(this);
+
+  if (si()->s_slab) {
+    m_slab = new SlabHeap();
+  }
+
   // hold a reference to the browser context..
   m_browserContext = Persistent<Context>::New(Context::GetCurrent());
 
@@ -1818,6 +2252,9 @@ void Node::Init() {
 // node statics..
 Node::Node(INode *inode)
   : m_need_tick_cb(false)
+  , m_paused(false)
+  , m_loop(0)
+  , m_slab(0)
   , m_inode(inode)
 {
   NODE_ASSERT(si());
@@ -1833,6 +2270,11 @@ Node::~Node(){
   // to clean up (e.g. camera object could disconnect, file module could clean up watchers etc)
   EmitEvent("exit");
 
+  if (m_paused) {
+    m_paused = false;
+    si()->s_pausedNodes--;
+  }
+
   // clean up the lock functions if any.
   if (si()->s_lockList.size() > 0 ) {
     NODE_LOGV("%s, releasing function size : %d)", __FUNCTION__, si()->s_lockList.size());
@@ -1876,7 +2318,8 @@ Node::~Node(){
 
   if (uv_is_active((uv_handle_t*) &m_tick_spinner)) {
     uv_idle_stop(&m_tick_spinner);
-    uv_unref();
+    // no node context entered here, uv_unref() can't tell the loop
+    ev_unref(m_loop->loop);
   }
 
   // remove this from vector
@@ -1893,7 +2336,7 @@ Node::~Node(){
 
   // cleanup any active watchers
   NODE_LOGI("WATCHERS: node (%p) deletion, watchers active (total=%d, instance specific=%d)",
-      this, ev_activecnt(ev_default_loop()), m_watcherWrapSet.size());
+      this, ev_activecnt(m_loop->loop), m_watcherWrapSet.size());
   Context::Scope context(m_context);
   set<void*>::iterator it = m_watcherWrapSet.begin();
   while (it != m_watcherWrapSet.end()) {
@@ -1907,7 +2350,10 @@ Node::~Node(){
     delete static_cast<ObjectWrap*>(*toDelete);
   }
   NODE_LOGI("WATCHERS: count at node (%p) deletion after cleanup - %d",
-      this, ev_activecnt(ev_default_loop()));
+      this, ev_activecnt(m_loop->loop));
+
+  // stop the loop if it's ours, this takes care of anything that is left
+  si()->ReleaseLoop(m_loop);
 
 #ifdef LOG_WATCHERS
   si()->DumpActiveWatchers();
@@ -1923,16 +2369,58 @@ Node::~Node(){
   // added a custom event "delete", this is different from "exit" in that we send it as
   // the last step in node deletion, this allows for tests to verify watcher count as an example
   EmitEvent("delete");
+
+  // hands back the slab chunks in one go, buffers of this page still
+  // waiting for the GC keep theirs until they are collected
+  if (m_slab) {
+    m_slab->Release();
+    m_slab = NULL;
+  }
   NODE_LOGI("node (%p) deleted", this);
 }
 
 void Node::onPause() {
   NODE_LOGI("NODE_API: pause, node(%p)", this);
+  if (m_paused) {
+    return;
+  }
+  // js drops its pools and caches on "pause"
   EmitEvent("pause");
+  m_paused = true;
+
+  Timer::Background(this, true, si()->s_backgroundTimerMs / 1000.);
+  StatWatcher::Background(this, true);
+  if (uv_is_active((uv_handle_t*) &m_tick_spinner)) {
+    NODE_LOGV("this(%p), m_tick_spinner (%p) stopped", this, &m_tick_spinner);
+    Context::Scope cscope(m_context);
+    uv_idle_stop(&m_tick_spinner);
+    uv_unref();
+  }
+
+  if (++si()->s_pausedNodes >= si()->PausableNodes()) {
+    si()->EnterBackground();
+  }
 }
 
 void Node::onResume() {
   NODE_LOGI("NODE_API: resume, node(%p)", this);
+  if (!m_paused) {
+    return;
+  }
+  if (si()->s_background) {
+    si()->LeaveBackground();
+  }
+  m_paused = false;
+  si()->s_pausedNodes--;
+
+  Timer::Background(this, false, si()->s_backgroundTimerMs / 1000.);
+  StatWatcher::Background(this, false);
+  if (m_need_tick_cb && !uv_is_active((uv_handle_t*) &m_tick_spinner)) {
+    NODE_LOGV("this(%p), m_tick_spinner (%p) started", this, &m_tick_spinner);
+    Context::Scope cscope(m_context);
+    uv_idle_start(&m_tick_spinner, NodeStatic::Spin);
+    uv_ref();
+  }
   EmitEvent("resume");
 }
 
@@ -1956,11 +2444,15 @@ void Node::removeWatcherWrap(void* watcherWrap) {
 ////////////////////////////////// Implementation of libev thread ///////////////////////////////
 
 void NodeStatic::EvReleaseCallback (EV_P) {
-  si()->UnLock_(LOCK_EV_POLL);
+  EvLoop *el = LoopFor(loop);
+  el->pollStart = uv_hrtime();
+  si()->UnLock_(el, LOCK_EV_POLL);
 }
 
 void NodeStatic::EvAcquireCallback (EV_P) {
-  si()->Lock_(LOCK_EV_POLL);
+  EvLoop *el = LoopFor(loop);
+  HistogramAdd(el->poll, (uv_hrtime() - el->pollStart) / 1000);
+  si()->Lock_(el, LOCK_EV_POLL);
 }
 
 void NodeStatic::RunEventLoop() {
@@ -1970,36 +2462,633 @@ void NodeStatic::RunEventLoop() {
   NODE_ASSERT(!running);
   running = true;
 
-  // set the ev_invoke_pending method and start the ev_run in separate thread
-  NODE_LOGD("%s,** starting ev loop thread", __FUNCTION__);
-  ev_set_invoke_pending_cb(ev_default_loop(), EvThreadPendingCallback);
-  ev_set_loop_release_cb(ev_default_loop(), EvReleaseCallback, EvAcquireCallback);
-  pthread_create(&s_evThread, 0, EvThreadRun, 0);
+  s_defaultLoop = CreateLoop(ev_default_loop());
+  StartLoop(s_defaultLoop);
+}
+
+EvLoop* NodeStatic::CreateLoop(struct ev_loop *loop) {
+  EvLoop *el = new EvLoop();
+  el->loop = loop;
+  el->owner = 0;
+  el->stopping = false;
+  el->retired = false;
+
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&el->mutex, &attr);
+  pthread_cond_init(&el->cond, 0);
+  el->signalled = false;
+
+  el->collectHead = el->collectTail = 0;
+  el->batch = 0;
+  el->readyIndex = NULL;
+  el->readyIndexSize = el->readyCount = 0;
+  el->awaitingDrain = false;
+  sem_init(&el->drained, 0, 0);
+
+  el->rounds = el->deferred = el->dispatched = el->busyNs = 0;
+  el->signals = 0;
+  memset(&el->poll, 0, sizeof(el->poll));
+  memset(el->evLockWait, 0, sizeof(el->evLockWait));
+  memset(el->mainLockWait, 0, sizeof(el->mainLockWait));
+  el->pollStart = 0;
+
+  // set the ev_invoke_pending method, ev_run runs in a separate thread
+  ev_set_userdata(loop, el);
+  ev_set_invoke_pending_cb(loop, EvThreadPendingCallback);
+  ev_set_loop_release_cb(loop, EvReleaseCallback, EvAcquireCallback);
+
+  // watcher to keep alive the event loop and signal active watchers
+  ev_async_init(&el->wakeup, EvWakeupCallback);
+  ev_async_start(loop, &el->wakeup);
+  return el;
+}
+
+void NodeStatic::StartLoop(EvLoop *el) {
+  NODE_LOGD("%s,** starting ev loop thread (%p)", __FUNCTION__, el);
+  el->stopping = false;
+  el->retired = false;
+  s_loops.push_back(el);
+  pthread_create(&el->thread, 0, EvThreadRun, el);
 
 #if ANDROID
   // set the name of the thread to be shown in top -t
-  pthread_setname_np(s_evThread, "NodeEVThread");
+  pthread_setname_np(el->thread, "NodeEVThread");
 #endif
 }
 
-void NodeStatic::InvokePending() {
-  si()->Lock_(LOCK_EV_PENDING);
-  NODE_LOGV("ev_invoke_pending() start");
-  ev_invoke_pending(ev_default_loop());
-  NODE_LOGV("ev_invoke_pending() done, signal ev thread");
-  si()->Signal_();
-  si()->UnLock_(LOCK_EV_PENDING);
+// uv_close() feeds the handle's next_watcher, its callback finishes the
+// close. Only compares addresses, w->data isn't always a uv handle
+static bool IsCloseWatcher(ev_watcher *w, int revents) {
+  uv_handle_t *handle = static_cast<uv_handle_t*>(w->data);
+  return (revents & EV_IDLE) && (void*) &handle->next_watcher == (void*) w;
+}
+
+// Main thread, stops the libev thread and parks the loop. The loop itself
+// is kept, the close callbacks still pending for handles of the deleted
+// node are run first
+void NodeStatic::StopLoop(EvLoop *el) {
+  NODE_LOGD("%s,** stopping ev loop thread (%p)", __FUNCTION__, el);
+  NODE_ASSERT(el != s_defaultLoop);
+
+  for (vector<EvLoop*>::iterator it = s_loops.begin(); it != s_loops.end(); it++) {
+    if (*it == el) {
+      s_loops.erase(it);
+      break;
+    }
+  }
+
+  // release the libev thread from whatever handshake it is in, it breaks
+  // out of ev_run from EvThreadPendingCallback
+  Lock_(el, LOCK_EV_PENDING);
+  el->stopping = true;
+  Signal_(el);
+  ev_async_send(el->loop, &el->wakeup);
+  UnLock_(el, LOCK_EV_PENDING);
+  sem_post(&el->drained);
+  pthread_join(el->thread, 0);
+
+  // events that were handed out but not invoked go away with the node,
+  // except the close callbacks of its handles. Those only free the native
+  // wraps and have to run before the loop goes to a new owner, the thread
+  // is gone so they run here. Closing can queue more of them
+  ReadyWatcher *r;
+  while ((r = static_cast<ReadyWatcher*>(el->readyQueue.pop()))) {
+    if (!r->cancelled && IsCloseWatcher(r->w, r->revents)) {
+      ev_invoke(el->loop, r->w, r->revents);
+    }
+    el->freeQueue.push(r);
+  }
+  while (ev_pending_count(el->loop)) {
+    el->collectHead = el->collectTail = NULL;
+    ev_collect_pending(el->loop, CollectReady);
+    r = el->collectHead;
+    while (r) {
+      ReadyWatcher *next = static_cast<ReadyWatcher*>(r->next);
+      if (IsCloseWatcher(r->w, r->revents)) {
+        ev_invoke(el->loop, r->w, r->revents);
+      }
+      el->freeQueue.push(r);
+      r = next;
+    }
+  }
+  el->collectHead = el->collectTail = NULL;
+  el->readyCount = 0;
+  el->awaitingDrain = false;
+  el->signalled = false;
+  sem_destroy(&el->drained);
+  sem_init(&el->drained, 0, 0);
+
+  el->owner = 0;
+  s_parkedLoops.push_back(el);
+}
+
+EvLoop* NodeStatic::AcquireLoop(Node *owner) {
+  // spares share the default loop until they are adopted, see Node::Adopt
+  INodeClient *client = owner->inode()->client();
+  if (!s_loopPerNode || !client || client == &s_spareClient) {
+    return s_defaultLoop;
+  }
+
+  EvLoop *el = 0;
+  if (!s_parkedLoops.empty()) {
+    el = s_parkedLoops.back();
+    s_parkedLoops.pop_back();
+  } else if (s_loops.size() - 1 < s_maxLoops) {
+    struct ev_loop *loop = ev_loop_new(EVFLAG_AUTO);
+    if (loop) {
+      el = CreateLoop(loop);
+    }
+  }
+
+  if (!el) {
+    NODE_LOGW("%s, no loop available for node (%p), using default loop", __FUNCTION__, owner);
+    return s_defaultLoop;
+  }
+
+  el->owner = owner;
+  el->rounds = el->deferred = el->dispatched = el->busyNs = 0;
+  el->signals = 0;
+  StartLoop(el);
+  return el;
+}
+
+void NodeStatic::ReleaseLoop(EvLoop *el) {
+  if (el == s_defaultLoop) {
+    return;
+  }
+
+  DumpLoopStats();
+  if (el == s_dispatchLoop) {
+    // we are in the middle of invoking its callbacks (e.g. test.deleteNode),
+    // InvokePending stops it once it's done
+    el->retired = true;
+    return;
+  }
+  StopLoop(el);
+}
+
+struct ev_loop* NodeStatic::CurrentLoop() {
+  NodeStatic *s = si();
+  if (!s->s_loopPerNode || !s->IsMainThread()) {
+    return 0;
+  }
+
+  if (Context::InContext()) {
+    HandleScope scope;
+    Handle<Context> context = Context::GetCurrent();
+    for (vector<Node*>::iterator it = s->s_nodes.begin(); it != s->s_nodes.end(); it++) {
+      if ((*it)->m_loop && (*it)->m_context == context) {
+        return (*it)->m_loop->loop;
+      }
+    }
+  }
+
+  return s->s_dispatchLoop ? s->s_dispatchLoop->loop : 0;
+}
+
+void NodeStatic::EvWakeupCallback(EV_P_ ev_async *w, int revents) {
+  NODE_LOGF();
+}
+
+void NodeStatic::DumpLoopStats() {
+  for (vector<EvLoop*>::iterator it = s_loops.begin(); it != s_loops.end(); it++) {
+    EvLoop *el = *it;
+    NODE_LOGD("LOOPS: loop(%p) node(%p) watchers(%d) iterations(%u) signals(%u) "
+        "rounds(%llu) deferred(%llu) dispatched(%llu) busy(%llums)",
+        el, el->owner, ev_activecnt(el->loop), ev_iteration(el->loop), el->signals,
+        (unsigned long long) el->rounds, (unsigned long long) el->deferred,
+        (unsigned long long) el->dispatched, (unsigned long long) el->busyNs / 1000000);
+  }
+}
+
+void NodeStatic::HistogramAdd(LoopHistogram &h, uint64_t value) {
+  h.count++;
+  h.sum += value;
+  if (value > h.max) {
+    h.max = value;
+  }
+
+  unsigned int bucket = 0;
+  while (value && bucket < LoopHistogram::BUCKETS - 1) {
+    value >>= 1;
+    bucket++;
+  }
+  h.buckets[bucket]++;
+}
+
+void NodeStatic::HistogramMerge(LoopHistogram &to, const LoopHistogram &from) {
+  to.count += from.count;
+  to.sum += from.sum;
+  if (from.max > to.max) {
+    to.max = from.max;
+  }
+  for (int i = 0; i < LoopHistogram::BUCKETS; i++) {
+    to.buckets[i] += from.buckets[i];
+  }
+}
+
+// Main thread. The per loop histograms are read without the loop lock, a
+// sample being added concurrently may be missed or counted partially
+void NodeStatic::GetLoopStats(LoopStats *stats) {
+  memset(stats, 0, sizeof(*stats));
+  stats->loops = s_loops.size();
+
+  vector<EvLoop*> loops(s_loops);
+  loops.insert(loops.end(), s_parkedLoops.begin(), s_parkedLoops.end());
+  for (vector<EvLoop*>::iterator it = loops.begin(); it != loops.end(); it++) {
+    EvLoop *el = *it;
+    HistogramMerge(stats->poll, el->poll);
+    for (int i = 0; i < LoopStats::LOCK_CONTEXTS; i++) {
+      HistogramMerge(stats->lockWait[i], el->evLockWait[i]);
+      HistogramMerge(stats->lockWait[i], el->mainLockWait[i]);
+    }
+  }
+
+  stats->invokePending = s_invokeStats;
+  stats->pendingCallbacks = s_pendingStats;
+  stats->tick = s_tickStats;
+}
+
+static Local<Object> HistogramToObject(const LoopHistogram &h) {
+  HandleScope scope;
+  Local<Object> o = Object::New();
+  o->Set(String::NewSymbol("count"), Number::New(h.count));
+  o->Set(String::NewSymbol("sum"), Number::New(h.sum));
+  o->Set(String::NewSymbol("max"), Number::New(h.max));
+
+  Local<Array> buckets = Array::New(LoopHistogram::BUCKETS);
+  for (int i = 0; i < LoopHistogram::BUCKETS; i++) {
+    buckets->Set(Integer::New(i), Integer::NewFromUnsigned(h.buckets[i]));
+  }
+  o->Set(String::NewSymbol("buckets"), buckets);
+  return scope.Close(o);
+}
+
+Handle<Value> NodeStatic::ProcessLoopStats(const Arguments& args) {
+  HandleScope scope;
+  LoopStats stats;
+  si()->GetLoopStats(&stats);
+
+  Local<Object> o = Object::New();
+  o->Set(String::NewSymbol("loops"), Integer::NewFromUnsigned(stats.loops));
+  o->Set(String::NewSymbol("poll"), HistogramToObject(stats.poll));
+
+  Local<Object> lockWait = Object::New();
+  for (int i = 0; i < LoopStats::LOCK_CONTEXTS; i++) {
+    lockWait->Set(String::NewSymbol(LockContextStr[i]), HistogramToObject(stats.lockWait[i]));
+  }
+  o->Set(String::NewSymbol("lockWait"), lockWait);
+
+  o->Set(String::NewSymbol("invokePending"), HistogramToObject(stats.invokePending));
+  o->Set(String::NewSymbol("pendingCallbacks"), HistogramToObject(stats.pendingCallbacks));
+  o->Set(String::NewSymbol("tick"), HistogramToObject(stats.tick));
+  return scope.Close(o);
+}
+
+void Node::loopStats(LoopStats* stats) {
+  si()->GetLoopStats(stats);
+}
+
+static void KeepData(char* data, void* hint) {
+}
+
+Handle<Object> Node::createBuffer(char* data, size_t length, FreeCallback cb, void* hint) {
+  HandleScope scope;
+  Context::Scope cscope(m_context);
+  Buffer* buffer = Buffer::New(data, length, cb ? cb : KeepData, hint);
+  return scope.Close(buffer->handle_);
+}
+
+Handle<Object> Node::createSharedBuffer(Handle<Object> backing) {
+  HandleScope scope;
+  Context::Scope cscope(m_context);
+  Buffer* buffer = Buffer::NewShared(backing);
+  if (!buffer) {
+    return Handle<Object>();
+  }
+  return scope.Close(buffer->handle_);
+}
+
+Handle<Value> NodeStatic::ProcessEioStats(const Arguments& args) {
+  HandleScope scope;
+  Local<Object> o = Object::New();
+  o->Set(String::NewSymbol("budget"), Integer::NewFromUnsigned(si()->s_eioBudgetUs));
+  o->Set(String::NewSymbol("maxReqs"), Integer::NewFromUnsigned(si()->s_eioMaxReqs));
+  o->Set(String::NewSymbol("drains"), Integer::NewFromUnsigned(si()->s_eioDrains));
+  o->Set(String::NewSymbol("completed"), Integer::NewFromUnsigned(si()->s_eioCompleted));
+  o->Set(String::NewSymbol("wakeups"), Integer::NewFromUnsigned(si()->s_eioWakeups));
+  o->Set(String::NewSymbol("pending"), Integer::NewFromUnsigned(eio_npending()));
+  o->Set(String::NewSymbol("depth"), HistogramToObject(si()->s_eioDepth));
+  o->Set(String::NewSymbol("drain"), HistogramToObject(si()->s_eioDrainStats));
+  return scope.Close(o);
+}
+
+INode* Node::CreateINode(INodeClient *client) {
+  uint64_t start = uv_hrtime();
+  INode *inode;
+  bool adopted = !si()->s_spares.empty();
+  if (adopted) {
+    inode = si()->s_spares.front();
+    si()->s_spares.erase(si()->s_spares.begin());
+    inode->m_client = client;
+    inode->m_node->Adopt();
+    si()->s_sparesAdopted++;
+  } else {
+    inode = new INode(client);
+    si()->s_sparesMissed += si()->s_sparePoolSize ? 1 : 0;
+  }
+  uint64_t elapsed = (uv_hrtime() - start) / 1000;
+  NodeStatic::HistogramAdd(si()->s_attachStats, elapsed);
+  NODE_LOGI("NODE_API: %s, inode(%p) client(%p) %s in %lluus, %u spares left", __FUNCTION__,
+      inode, client, adopted ? "adopted" : "created", (unsigned long long) elapsed,
+      si()->s_spares.size());
+
+  // build the replacement once things settle down
+  if (si()->s_spares.size() < si()->s_sparePoolSize) {
+    (si()->s_clientCallback)();
+  }
+  return inode;
+}
+
+void Node::SetSparePoolSize(unsigned int size) {
+  NODE_LOGI("NODE_API: spare pool size %u", size);
+  si()->s_sparePoolSize = size;
+  while (si()->s_spares.size() > size) {
+    delete si()->s_spares.back();
+    si()->s_spares.pop_back();
+  }
+  if (si()->s_spares.size() < size) {
+    (si()->s_clientCallback)();
+  }
+}
+
+void Node::TrimMemory() {
+  si()->TrimSpares();
+  V8::LowMemoryNotification();
+}
+
+void Node::Adopt() {
+  HandleScope scope;
+  NODE_ASSERT(Context::InContext());
+
+  // same as Init() for a node created in the page
+  m_browserContext.Dispose();
+  m_browserContext = Persistent<Context>::New(Context::GetCurrent());
+  m_context->SetSecurityToken(m_browserContext->GetSecurityToken());
+
+  // the page gets a loop of its own now. The tick watchers move along, the
+  // few handles created while bootstrapping stay on the default loop, a uv
+  // handle keeps the loop it was initialized on
+  EvLoop *el = si()->AcquireLoop(this);
+  if (el != m_loop) {
+    bool spinning = uv_is_active((uv_handle_t*) &m_tick_spinner);
+    uv_prepare_stop(&m_prepare_tick_watcher);
+    uv_check_stop(&m_check_tick_watcher);
+    if (spinning) {
+      uv_idle_stop(&m_tick_spinner);
+      ev_unref(m_loop->loop);
+    }
+
+    m_loop = el;
+    m_prepare_tick_watcher.loop = el->loop;
+    m_check_tick_watcher.loop = el->loop;
+    m_tick_spinner.loop = el->loop;
+    uv_prepare_start(&m_prepare_tick_watcher, NodeStatic::PrepareTick);
+    uv_check_start(&m_check_tick_watcher, NodeStatic::CheckTick);
+    if (spinning) {
+      uv_idle_start(&m_tick_spinner, NodeStatic::Spin);
+      ev_ref(el->loop);
+    }
+  }
+
+  Context::Scope cscope(m_context);
+  INodeClientWebView *webview;
+  inode()->client()->queryInterface(INTERFACE_WEBVIEW, (void**)&webview);
+  NODE_ASSERT(webview);
+  if (webview) {
+    m_process->Set(String::NewSymbol("url"), String::New(webview->url()));
+  }
+}
+
+void NodeStatic::RefillSpares() {
+  if (s_background || s_buildingSpare || s_spares.size() >= s_sparePoolSize) {
+    return;
+  }
+
+  // only when idle, the pages come first
+  if (ev_activecnt(ev_default_loop()) > 1) {
+    return;
+  }
+  for (vector<Node*>::iterator it = s_nodes.begin(); it != s_nodes.end(); it++) {
+    EvLoop *el = (*it)->m_loop;
+    if (el != s_defaultLoop && ev_activecnt(el->loop) > 1) {
+      return;
+    }
+  }
+
+  HandleScope scope;
+  if (s_spareContext.IsEmpty()) {
+    s_spareContext = Context::New();
+  }
+  Context::Scope cscope(s_spareContext);
+
+  s_buildingSpare = true;
+  uint64_t start = uv_hrtime();
+  s_spares.push_back(new INode(&s_spareClient));
+  HistogramAdd(s_spareBuildStats, (uv_hrtime() - start) / 1000);
+  s_buildingSpare = false;
+  NODE_LOGI("%s, spare built in %lluus (%u/%u)", __FUNCTION__,
+      (unsigned long long) (uv_hrtime() - start) / 1000, s_spares.size(), s_sparePoolSize);
+
+  if (s_spares.size() < s_sparePoolSize) {
+    (s_clientCallback)();
+  }
+}
+
+void NodeStatic::TrimSpares() {
+  NODE_LOGI("%s, releasing %u spares", __FUNCTION__, s_spares.size());
+  s_sparesTrimmed += s_spares.size();
+  while (!s_spares.empty()) {
+    delete s_spares.back();
+    s_spares.pop_back();
+  }
+}
+
+Handle<Value> NodeStatic::ProcessSparePoolStats(const Arguments& args) {
+  HandleScope scope;
+  Local<Object> o = Object::New();
+  o->Set(String::NewSymbol("size"), Integer::NewFromUnsigned(si()->s_sparePoolSize));
+  o->Set(String::NewSymbol("ready"), Integer::NewFromUnsigned(si()->s_spares.size()));
+  o->Set(String::NewSymbol("adopted"), Integer::NewFromUnsigned(si()->s_sparesAdopted));
+  o->Set(String::NewSymbol("missed"), Integer::NewFromUnsigned(si()->s_sparesMissed));
+  o->Set(String::NewSymbol("trimmed"), Integer::NewFromUnsigned(si()->s_sparesTrimmed));
+  o->Set(String::NewSymbol("attach"), HistogramToObject(si()->s_attachStats));
+  o->Set(String::NewSymbol("build"), HistogramToObject(si()->s_spareBuildStats));
+  return scope.Close(o);
+}
+
+void NodeStatic::EnterBackground() {
+  NODE_LOGI("%s, %u nodes paused, timers on a %ums grid", __FUNCTION__,
+      s_pausedNodes, s_backgroundTimerMs);
+  s_background = true;
+  s_backgroundSince = uv_hrtime();
+  s_backgroundWakeups = 0;
+
+  // no limits, a single wakeup takes all completions
+  eio_set_max_poll_reqs(0);
+  eio_set_max_poll_time(0);
+
+  TrimSpares();
+  V8::LowMemoryNotification();
+}
+
+void NodeStatic::LeaveBackground() {
+  uint64_t elapsed = (uv_hrtime() - s_backgroundSince) / 1000000;
+  s_background = false;
+  s_backgroundTime += elapsed;
+  s_backgroundWakeupsTotal += s_backgroundWakeups;
+  NODE_LOGI("%s, %u wakeups in %llums (%.1f/min)", __FUNCTION__, s_backgroundWakeups,
+      (unsigned long long) elapsed, elapsed ? s_backgroundWakeups * 60000. / elapsed : 0.);
+
+  eio_set_max_poll_reqs(s_eioMaxReqs);
+  eio_set_max_poll_time(s_eioBudgetUs / 1e6);
+  if (s_spares.size() < s_sparePoolSize) {
+    (s_clientCallback)();
+  }
+}
+
+Handle<Value> NodeStatic::ProcessBackgroundStats(const Arguments& args) {
+  HandleScope scope;
+  NodeStatic *s = si();
+  uint64_t time = s->s_backgroundTime;
+  unsigned int wakeups = s->s_backgroundWakeupsTotal;
+  if (s->s_background) {
+    time += (uv_hrtime() - s->s_backgroundSince) / 1000000;
+    wakeups += s->s_backgroundWakeups;
+  }
+
+  Local<Object> o = Object::New();
+  o->Set(String::NewSymbol("granularity"), Integer::NewFromUnsigned(s->s_backgroundTimerMs));
+  o->Set(String::NewSymbol("paused"), Integer::NewFromUnsigned(s->s_pausedNodes));
+  o->Set(String::NewSymbol("background"), Boolean::New(s->s_background));
+  o->Set(String::NewSymbol("time"), Number::New(time));
+  o->Set(String::NewSymbol("wakeups"), Integer::NewFromUnsigned(wakeups));
+  o->Set(String::NewSymbol("wakeupsPerMinute"), Number::New(time ? wakeups * 60000. / time : 0));
+  return scope.Close(o);
+}
+
+int NodeStatic::PendingBudgetExpired(struct ev_loop *loop) {
+  return uv_hrtime() >= si()->s_pendingDeadline;
+}
+
+// Main thread, invokes the pending watchers of one loop, returns true if
+// there is work left that the libev thread won't signal again
+bool NodeStatic::InvokeLoop(EvLoop *el, bool budgeted) {
+  if (s_lockFree) {
+    return DrainReady(el, budgeted);
+  }
+
+  Lock_(el, LOCK_EV_PENDING);
+  if (el->signalled) {
+    el->signalled = false;
+    unsigned int pending = ev_pending_count(el->loop);
+    NODE_LOGV("ev_invoke_pending() start (%p)", el);
+    if (budgeted) {
+      // anything left pending makes EvThreadPendingCallback signal the client again
+      ev_invoke_pending_until(el->loop, PendingBudgetExpired);
+    } else {
+      ev_invoke_pending(el->loop);
+    }
+    el->dispatched += pending - ev_pending_count(el->loop);
+    NODE_LOGV("ev_invoke_pending() done, signal ev thread (%p)", el);
+    Signal_(el);
+  }
+  UnLock_(el, LOCK_EV_PENDING);
+  return false;
+}
+
+void NodeStatic::InvokePending(unsigned int budgetUs) {
+  if (budgetUs) {
+    s_pendingDeadline = uv_hrtime() + (uint64_t) budgetUs * 1000;
+  }
+
+  // loops are served round robin starting at a different loop each time,
+  // so with a budget the loops at the end of the list don't starve. A copy,
+  // callbacks can delete nodes and stop their loops
+  vector<EvLoop*> loops(s_loops);
+  size_t count = loops.size();
+  bool more = false;
+  uint64_t invokeStart = uv_hrtime();
+  uint64_t dispatched = 0;
+  for (size_t i = 0; i < count; i++) {
+    EvLoop *el = loops[(s_nextLoop + i) % count];
+    if (s_lockFree ? el->readyQueue.empty() : !el->signalled) {
+      continue;
+    }
+
+    // always serve at least one loop
+    if (budgetUs && i > 0 && PendingBudgetExpired(el->loop)) {
+      el->deferred++;
+      more = true;
+      continue;
+    }
+
+    uint64_t start = uv_hrtime();
+    uint64_t before = el->dispatched;
+    s_dispatchLoop = el;
+    more = InvokeLoop(el, budgetUs != 0) || more;
+    s_dispatchLoop = 0;
+    el->busyNs += uv_hrtime() - start;
+    el->rounds++;
+    dispatched += el->dispatched - before;
+
+    if (el->retired) {
+      StopLoop(el);
+    }
+  }
+  s_nextLoop++;
+  HistogramAdd(s_invokeStats, (uv_hrtime() - invokeStart) / 1000);
+  HistogramAdd(s_pendingStats, dispatched);
+
+  if (more) {
+    // out of time, ask the client to come back for the rest
+    NODE_LOGV("HANDSHAKE: %s, budget expired, signal client", __FUNCTION__);
+    (s_clientCallback)();
+  }
+}
+
+void Node::SetInvokePendingBudget(unsigned int budgetUs) {
+  NODE_LOGI("NODE_API: invoke pending budget %uus", budgetUs);
+  si()->s_pendingBudgetUs = budgetUs;
 }
 
 void Node::InvokePending() {
-  si()->InvokePending();
+  InvokePending(si()->s_pendingBudgetUs);
+}
+
+void Node::InvokePending(unsigned int budgetUs) {
+  if (si()->s_background) {
+    si()->s_backgroundWakeups++;
+    // a node created meanwhile isn't paused
+    if (si()->s_pausedNodes < si()->PausableNodes()) {
+      si()->LeaveBackground();
+    }
+  }
+  si()->InvokePending(budgetUs);
+  si()->RefillSpares();
 
   // send idle events to all active nodes if we are not active
   // host environment handles this case, so this is specific to browser
   if (si()->s_isBrowser && ev_activecnt(ev_default_loop()) <= 1) {
     vector<Node* >::iterator it = si()->s_nodes.begin();
     for (;it != si()->s_nodes.end(); it++) {
-      (*it)->EmitEvent("idle");
+      // nodes with a loop of their own are idle when only its wakeup watcher is left
+      EvLoop *el = (*it)->m_loop;
+      if (el == si()->s_defaultLoop || ev_activecnt(el->loop) <= 1) {
+        (*it)->EmitEvent("idle");
+      }
     }
   }
 }
@@ -2088,6 +3177,26 @@ extern "C" void on_ev_start(ev_watcher *w) {
 #endif
 }
 
+static inline unsigned int ReadySlot(ev_watcher *w, unsigned int mask) {
+  uintptr_t p = reinterpret_cast<uintptr_t>(w);
+  return (unsigned int) ((p >> 4) ^ (p >> 12)) & mask;
+}
+
+extern "C" void on_ev_cancel(struct ev_loop *loop, ev_watcher *w) {
+  // called with the loop locked, the index is stable here. Only the
+  // pointers are compared, the watcher of a queued event may be gone
+  EvLoop *el = NodeStatic::LoopFor(loop);
+  if (el && el->readyCount && si()->s_lockFree && is_main_thread()) {
+    unsigned int mask = el->readyIndexSize - 1;
+    for (unsigned int i = ReadySlot(w, mask); el->readyIndex[i]; i = (i + 1) & mask) {
+      if (el->readyIndex[i]->w == w) {
+        el->readyIndex[i]->cancelled = true;
+        break;
+      }
+    }
+  }
+}
+
 extern "C" void on_ev_stop(ev_watcher *w) {
 #if LOG_WATCHERS
   if (!is_main_thread() || !w->active) {
@@ -2112,9 +3221,11 @@ extern "C" void on_ev_stop(ev_watcher *w) {
 #endif
 }
 
-// Ev Thread that handles requests from multiple nodes
-void* NodeStatic::EvThreadRun(void *unused) {
+// Ev Thread that handles requests from the nodes using the loop
+void* NodeStatic::EvThreadRun(void *data) {
   NODE_LOGF();
+  EvLoop *el = static_cast<EvLoop*>(data);
+  struct ev_loop *loop = el->loop;
 
   // set the thread name, this is shown in ps
   char name[] = "NodeEvThread";
@@ -2123,41 +3234,172 @@ void* NodeStatic::EvThreadRun(void *unused) {
   // we keep this lock as long as we are processing events in libev thread
   // we release it when 1) when we signal pending events to main thread
   // 2) when the ev thread does a poll
-  si()->Lock_(LOCK_EV_START);
+  si()->Lock_(el, LOCK_EV_START);
 
-  while (true) {
-    NODE_LOGI("libev thread/loop started");
+  while (!el->stopping) {
+    NODE_LOGI("libev thread/loop started (%p)", el);
 
     // start the libev loop
-    ev_run(ev_default_loop(), 0);
+    ev_run(loop, 0);
 
-    NODE_LOGW("libev thread/loop ended, watchers: %d", ev_activecnt(ev_default_loop()));
+    NODE_LOGW("libev thread/loop ended (%p), watchers: %d", el, ev_activecnt(loop));
     // NODE_ASSERT_REACHABLE(); // we should never exit the loop in current scheme..
 
     // if the refcount goes below 1, the event loop will
     // return and we will keep spinning, get it back to 1
-    int activecnt = ev_activecnt(ev_default_loop());
+    int activecnt = ev_activecnt(loop);
     if (activecnt < 1) {
       while (activecnt++ < 1) {
-        ev_ref(ev_default_loop());
+        ev_ref(loop);
       }
-      NODE_ASSERT(ev_activecnt(ev_default_loop()) == 1);
+      NODE_ASSERT(ev_activecnt(loop) == 1);
     }
   }
 
-  si()->UnLock_(LOCK_EV_START);
+  si()->UnLock_(el, LOCK_EV_START);
   return 0;
 }
 
 // Invoked from EV thread when there is pending events to be processed on main thread
 void NodeStatic::EvThreadPendingCallback(struct ev_loop *loop){
-  NODE_ASSERT(loop == ev_default_loop());
-  while (ev_pending_count(loop)){
+  EvLoop *el = LoopFor(loop);
+  NODE_ASSERT(el);
+  if (el->stopping) {
+    ev_break(loop, EVBREAK_ALL);
+    return;
+  }
+
+  if (si()->s_lockFree) {
+    si()->PublishReady(el);
+    return;
+  }
+
+  while (ev_pending_count(loop) && !el->stopping){
     NODE_ASSERT(si()->s_clientCallback);
-    NODE_LOGV("HANDSHAKE: %s, handling pending callbacks", __FUNCTION__);
+    NODE_LOGV("HANDSHAKE: %s, handling pending callbacks (%p)", __FUNCTION__, el);
+    el->signalled = true;
+    el->signals++;
     (si()->s_clientCallback)(); // invoke callback in the client
-    si()->Wait_();
+    si()->Wait_(el);
+  }
+}
+
+// Invoked from ev_collect_pending on the EV thread, queues up the watcher
+// in the current batch, the batch gets published in PublishReady
+void NodeStatic::CollectReady(struct ev_loop *loop, void *w, int revents) {
+  EvLoop *el = LoopFor(loop);
+  ReadyWatcher *r = static_cast<ReadyWatcher*>(el->freeQueue.pop());
+  if (!r) {
+    r = new ReadyWatcher();
+  }
+  r->w = static_cast<ev_watcher*>(w);
+  r->revents = revents;
+  r->cancelled = false;
+  r->last = false;
+  r->next = NULL;
+
+  if (el->collectTail) {
+    el->collectTail->next = r;
+  } else {
+    el->collectHead = r;
+  }
+  el->collectTail = r;
+}
+
+// EV thread, called with the loop locked
+void NodeStatic::PublishReady(EvLoop *el) {
+  if (!ev_pending_count(el->loop)) {
+    return;
+  }
+
+  // the previous batch has to be drained before we hand out the next one,
+  // release the loop while we wait so main thread can start/stop watchers
+  if (el->awaitingDrain) {
+    NODE_LOGM("HANDSHAKE: %s, waiting for main thread to drain (%p)", __FUNCTION__, el);
+    UnLock_(el, LOCK_EV_PENDING);
+    while (sem_wait(&el->drained) == -1 && errno == EINTR);
+    Lock_(el, LOCK_EV_PENDING);
+    el->awaitingDrain = false;
+    if (el->stopping) {
+      return;
+    }
+  }
+
+  el->batch++;
+  el->collectHead = el->collectTail = NULL;
+  ev_collect_pending(el->loop, CollectReady);
+  if (!el->collectHead) {
+    return;
+  }
+  el->collectTail->last = true;
+
+  // index the batch for on_ev_cancel, grows with the largest batch seen
+  unsigned int count = 0;
+  ReadyWatcher *r;
+  for (r = el->collectHead; r; r = static_cast<ReadyWatcher*>(r->next)) {
+    count++;
+  }
+  if (el->readyIndexSize < count * 2) {
+    unsigned int size = el->readyIndexSize ? el->readyIndexSize : 64;
+    while (size < count * 2) {
+      size *= 2;
+    }
+    delete[] el->readyIndex;
+    el->readyIndex = new ReadyWatcher*[size];
+    el->readyIndexSize = size;
+  }
+  memset(el->readyIndex, 0, el->readyIndexSize * sizeof(ReadyWatcher*));
+  unsigned int mask = el->readyIndexSize - 1;
+  for (r = el->collectHead; r; r = static_cast<ReadyWatcher*>(r->next)) {
+    unsigned int i = ReadySlot(r->w, mask);
+    while (el->readyIndex[i]) {
+      i = (i + 1) & mask;
+    }
+    el->readyIndex[i] = r;
+  }
+  el->readyCount = count;
+
+  r = el->collectHead;
+  while (r) {
+    ReadyWatcher *next = static_cast<ReadyWatcher*>(r->next);
+    el->readyQueue.push(r);
+    r = next;
+  }
+  el->awaitingDrain = true;
+  el->signals++;
+
+  NODE_LOGV("HANDSHAKE: %s, batch %u published (%p)", __FUNCTION__, el->batch, el);
+  NODE_ASSERT(s_clientCallback);
+  (s_clientCallback)();
+}
+
+// Main thread, invokes the watchers published by the EV thread, the loop
+// mutex is not held here, callbacks take it as usual when they start/stop
+// watchers. Returns true if the budget expired with watchers left queued
+bool NodeStatic::DrainReady(EvLoop *el, bool budgeted) {
+  ReadyWatcher *r;
+  while ((r = static_cast<ReadyWatcher*>(el->readyQueue.pop()))) {
+    if (!r->cancelled) {
+      ev_invoke(el->loop, r->w, r->revents);
+      el->dispatched++;
+    } else {
+      NODE_LOGV("HANDSHAKE: %s, dropping stopped watcher (%p)", __FUNCTION__, r->w);
+    }
+
+    bool last = r->last;
+    el->freeQueue.push(r);
+    if (last) {
+      // nothing older than this batch is left in the queue
+      el->readyCount = 0;
+      NODE_LOGV("HANDSHAKE: %s, batch drained, signal ev thread (%p)", __FUNCTION__, el);
+      sem_post(&el->drained);
+    }
+
+    if (budgeted && PendingBudgetExpired(el->loop) && !el->readyQueue.empty()) {
+      return true;
+    }
   }
+  return false;
 }
 
 void NodeStatic::HandleSIGSEGV(int signal) {
@@ -2165,6 +3407,7 @@ void NodeStatic::HandleSIGSEGV(int signal) {
 #ifndef ANDROID
   Node::PrintNativeStackTrace();
 #endif
+  NodeTrace::Dump(TraceToLog, 0);
 
   if (old_sa[signal].sa_handler) {
     old_sa[signal].sa_handler(signal);
@@ -2173,6 +3416,38 @@ void NodeStatic::HandleSIGSEGV(int signal) {
   exit(1);
 }
 
+// formatting the trace isn't async signal safe, uv_async_send() is
+void NodeStatic::HandleSIGUSR2(int signal) {
+  uv_async_send(&si()->s_traceDumpNotifier);
+}
+
+void NodeStatic::TraceDumpNotifier(uv_async_t* watcher, int status) {
+  NodeTrace::Dump(TraceToLog, 0);
+}
+
+// straight to the output, the dump must not go back into the trace
+void NodeStatic::TraceToLog(const char* line, void* data) {
+#ifdef ANDROID
+  __android_log_print(DAPI_LOG_ERROR, "node-trace", "%s", line);
+#else
+  printf("%s\n", line);
+  fflush(stdout);
+#endif
+}
+
+static void TraceToString(const char* line, void* data) {
+  std::string *s = static_cast<std::string*>(data);
+  s->append(line);
+  s->append("\n");
+}
+
+Handle<Value> NodeStatic::ProcessTraceDump(const Arguments& args) {
+  HandleScope scope;
+  std::string dump;
+  NodeTrace::Dump(TraceToString, &dump);
+  return scope.Close(String::New(dump.c_str(), dump.size()));
+}
+
 void NodeStatic::DumpWatcherStats(uv_counters_t *uvc){
   NODE_LOGD("watchers: %2lld", uvc->handle_init);
   NODE_LOGD("prepare : %2lld", uvc->prepare_init);
@@ -2210,7 +3485,8 @@ Handle<Value> NodeStatic::TestExitCode(const Arguments& args) {
 }
 
 Handle<Value> NodeStatic::TestWatchers(const Arguments& args) {
-  return v8::Integer::New(ev_activecnt(ev_default_loop()));
+  Node *n = Node::GetNodeFromObject(args.Holder());
+  return v8::Integer::New(ev_activecnt(n->m_loop->loop));
 }
 
 Handle<Value> NodeStatic::TestWatcherStats(const Arguments& args) {
@@ -2218,6 +3494,7 @@ Handle<Value> NodeStatic::TestWatcherStats(const Arguments& args) {
   si()->DumpWatcherStats(uv_counters());
   NODE_LOGD("%s, all active watchers ", __FUNCTION__);
   si()->DumpWatcherStats(&si()->s_watchers_active);
+  si()->DumpLoopStats();
   return Undefined();
 }
 
@@ -2238,8 +3515,12 @@ DAPILogPriority NodeStatic::StringToLog(const char* log) {
   return s_debugLevel;
 }
 
+#define NODE_TRACE_DEFAULT_ENTRIES 512
+#define NODE_COMPILE_CACHE_DEFAULT_KB 4096
+
 void NodeStatic::ReadDebugLevel() {
   bool reportCrash = false;
+  unsigned int traceEntries = 0;
 #ifdef ANDROID
   if (__system_property_find("NODE_CRASH")) {
     reportCrash = true;
@@ -2261,6 +3542,41 @@ void NodeStatic::ReadDebugLevel() {
   if (__system_property_get("MEM_LEAK", log)) {
     s_memLeak = true;
   }
+  if (__system_property_get("NODE_LOCKFREE", log)) {
+    s_lockFree = true;
+  }
+  if (__system_property_get("NODE_NATIVE_CACHE", log) && !strcmp(log, "0")) {
+    s_nativeCache = false;
+  }
+  if (__system_property_get("NODE_COMPILE_CACHE", log)) {
+    if (!strcmp(log, "0")) {
+      s_compileCache = false;
+    } else if (atoi(log) > 0) {
+      s_compileCacheKB = atoi(log);
+    }
+  }
+  if (__system_property_get("NODE_SPARE_POOL", log)) {
+    s_sparePoolSize = atoi(log);
+  }
+  if (__system_property_get("NODE_EIO_BUDGET", log) && atoi(log) > 0) {
+    s_eioBudgetUs = atoi(log);
+  }
+  if (__system_property_get("NODE_TRACE", log)) {
+    traceEntries = atoi(log) > 0 ? atoi(log) : NODE_TRACE_DEFAULT_ENTRIES;
+  }
+  if (__system_property_get("NODE_BACKGROUND_TIMER", log) && atoi(log) > 0) {
+    s_backgroundTimerMs = atoi(log);
+  }
+  if (__system_property_get("NODE_SLAB", log) && !strcmp(log, "0")) {
+    s_slab = false;
+  }
+  // NODE_LOOP_PER_NODE=<max loops>, 0 keeps the default maximum
+  if (__system_property_get("NODE_LOOP_PER_NODE", log)) {
+    s_loopPerNode = true;
+    if (atoi(log) > 0) {
+      s_maxLoops = atoi(log);
+    }
+  }
 #else
   const char *log;
   if (log = getenv("NODE_DEBUG")) {
@@ -2269,9 +3585,51 @@ void NodeStatic::ReadDebugLevel() {
   if (getenv("MEM_LEAK")) {
     s_memLeak = true;
   }
+  if (getenv("NODE_LOCKFREE")) {
+    s_lockFree = true;
+  }
+  if ((log = getenv("NODE_NATIVE_CACHE")) && !strcmp(log, "0")) {
+    s_nativeCache = false;
+  }
+  if ((log = getenv("NODE_COMPILE_CACHE"))) {
+    if (!strcmp(log, "0")) {
+      s_compileCache = false;
+    } else if (atoi(log) > 0) {
+      s_compileCacheKB = atoi(log);
+    }
+  }
+  if ((log = getenv("NODE_SPARE_POOL"))) {
+    s_sparePoolSize = atoi(log);
+  }
+  if ((log = getenv("NODE_EIO_BUDGET")) && atoi(log) > 0) {
+    s_eioBudgetUs = atoi(log);
+  }
+  if ((log = getenv("NODE_TRACE"))) {
+    traceEntries = atoi(log) > 0 ? atoi(log) : NODE_TRACE_DEFAULT_ENTRIES;
+  }
+  if ((log = getenv("NODE_BACKGROUND_TIMER")) && atoi(log) > 0) {
+    s_backgroundTimerMs = atoi(log);
+  }
+  if ((log = getenv("NODE_SLAB")) && !strcmp(log, "0")) {
+    s_slab = false;
+  }
+  if ((log = getenv("NODE_LOOP_PER_NODE")) != NULL) {
+    s_loopPerNode = true;
+    if (atoi(log) > 0) {
+      s_maxLoops = atoi(log);
+    }
+  }
 #endif
-  NODE_LOGI("%s, setting node debug level (%s:%d), memleak(%s)",__FUNCTION__,
-      LOG_STRING[s_debugLevel], s_debugLevel, s_memLeak ? "ENABLED" : "DISABLED");
+  if (traceEntries) {
+    NodeTrace::Initialize(traceEntries);
+  }
+  NODE_LOGI("%s, setting node debug level (%s:%d), memleak(%s), lockfree(%s), loops(%s:%u), "
+      "native cache(%s) compile cache(%s) spares(%u) eio budget(%uus) trace(%u) "
+      "background timer(%ums) slab(%s)", __FUNCTION__, LOG_STRING[s_debugLevel], s_debugLevel,
+      s_memLeak ? "ENABLED" : "DISABLED", s_lockFree ? "ENABLED" : "DISABLED",
+      s_loopPerNode ? "PER_NODE" : "SHARED", s_maxLoops, s_nativeCache ? "ENABLED" : "DISABLED",
+      s_compileCache ? "ENABLED" : "DISABLED", s_sparePoolSize,
+      s_eioBudgetUs, traceEntries, s_backgroundTimerMs, s_slab ? "ENABLED" : "DISABLED");
 }
 
 void printToStdout(DAPILogPriority prio, const char *tag, const char* buf) {
@@ -2293,29 +3651,42 @@ void printToStdout(DAPILogPriority prio, const char *tag, const char* buf) {
 }
 
 // node follows android logging mechanism and will be controllable at build/runtime
+// Messages below the debug level cost a compare, unless the trace is on in
+// which case they are recorded unformatted, see NodeTrace
 #define LOG_BUF_SIZE 2048
 extern "C" DAPIEXPORT void DAPILog(DAPILogPriority prio,
   const char *tag, const char *fmt, ...) {
-  if (si()) {
-    pthread_mutex_lock(&si()->s_log_mutex);
+  bool print = s_debugLevel <= prio;
+  if (!print && !NodeTrace::enabled()) {
+    return;
   }
 
   va_list ap;
-  static char buf[LOG_BUF_SIZE];
   va_start(ap, fmt);
+  if (NodeTrace::enabled()) {
+    NodeTrace::Record(prio, tag, fmt, ap);
+  }
+  if (!print) {
+    va_end(ap);
+    return;
+  }
+
+  char buf[LOG_BUF_SIZE];
   vsnprintf(buf, LOG_BUF_SIZE, fmt, ap);
   va_end(ap);
 
-  if (s_debugLevel <= prio) {
+  if (si()) {
+    pthread_mutex_lock(&si()->s_log_mutex);
+  }
+
 #ifdef ANDROID
-    __android_log_print(prio, tag, buf);
-    if (si() && !si()->s_isBrowser) {
-      printToStdout(prio, tag, buf);
-    }
-#else
+  __android_log_print(prio, tag, buf);
+  if (si() && !si()->s_isBrowser) {
     printToStdout(prio, tag, buf);
-#endif
   }
+#else
+  printToStdout(prio, tag, buf);
+#endif
 
   if (si()) {
     pthread_mutex_unlock(&si()->s_log_mutex);
@@ -2358,15 +3729,42 @@ Node* NodeStatic::ServiceNode() {
 }
 
 
-void NodeStatic::EvAsyncCallback(uv_async_t *w, int revents) {
-  NODE_LOGF();
-}
-
 NodeStatic::NodeStatic(void (*clientCallback)(), bool isBrowser, const char* appPath)
-  : s_isBrowser(isBrowser)
+  : s_eioBudgetUs(1000)
+  , s_eioMaxReqs(EIO_MIN_POLL_REQS)
+  , s_eioDrains(0)
+  , s_eioCompleted(0)
+  , s_eioWakeups(0)
+  , s_lockFree(false)
+  , s_defaultLoop(0)
+  , s_loopPerNode(false)
+  , s_maxLoops(4)
+  , s_nextLoop(0)
+  , s_dispatchLoop(0)
+  , s_isBrowser(isBrowser)
   , s_isAndroid(false)
   , s_serviceNode(0)
   , s_clientCallback(clientCallback)
+  , s_pendingBudgetUs(0)
+  , s_pendingDeadline(0)
+  , s_nativeCache(true)
+  , s_nativeHits(0)
+  , s_nativeMisses(0)
+  , s_compileCache(true)
+  , s_compileCacheKB(NODE_COMPILE_CACHE_DEFAULT_KB)
+  , s_sparePoolSize(0)
+  , s_buildingSpare(false)
+  , s_sparesAdopted(0)
+  , s_sparesMissed(0)
+  , s_sparesTrimmed(0)
+  , s_backgroundTimerMs(1000)
+  , s_pausedNodes(0)
+  , s_background(false)
+  , s_backgroundSince(0)
+  , s_backgroundTime(0)
+  , s_backgroundWakeups(0)
+  , s_backgroundWakeupsTotal(0)
+  , s_slab(true)
   , s_memLeak(false)
   , s_exitCode(0)
 {
@@ -2375,18 +3773,20 @@ NodeStatic::NodeStatic(void (*clientCallback)(), bool isBrowser, const char* app
   // This should be called from main thread
   s_mainThread = pthread_self();
 
-  // initialize mutex/cond
-  pthread_mutexattr_t attr;
-  pthread_mutexattr_init(&attr);
-  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
-  pthread_mutex_init(&s_mutex, &attr);
-
+  // initialize mutex/cond, the loop ones are created with the loops
   pthread_mutex_init(&s_log_mutex, 0);
 
-  pthread_cond_init(&s_cond, 0);
   pthread_mutex_init(&s_activity_mutex, 0);
   pthread_cond_init(&s_activity_cond, 0);
 
+  memset(&s_invokeStats, 0, sizeof(s_invokeStats));
+  memset(&s_pendingStats, 0, sizeof(s_pendingStats));
+  memset(&s_tickStats, 0, sizeof(s_tickStats));
+  memset(&s_attachStats, 0, sizeof(s_attachStats));
+  memset(&s_spareBuildStats, 0, sizeof(s_spareBuildStats));
+  memset(&s_eioDepth, 0, sizeof(s_eioDepth));
+  memset(&s_eioDrainStats, 0, sizeof(s_eioDrainStats));
+
   // node modules will be downloaded to/loaded from <app_path>/.proteus/downloads directory
 #ifdef ANDROID
   s_isAndroid = true;
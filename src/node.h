@@ -32,20 +32,29 @@ extern "C" {
   int gettid();
   void on_ev_start(ev_watcher *w);
   void on_ev_stop(ev_watcher *w);
-  void lock();
-  void unlock();
-  void wakeup();
+  void on_ev_cancel(struct ev_loop *loop, ev_watcher *w);
+  void lock(struct ev_loop *loop);
+  void unlock(struct ev_loop *loop);
+  void wakeup(struct ev_loop *loop);
   int is_main_thread();
 
+/* Every loop is guarded by its own lock, loops not created by Node are
+ * not guarded at all */
+#if EV_MULTIPLICITY
+# define NODE_EV_LOOP loop
+#else
+# define NODE_EV_LOOP 0
+#endif
+
 #define LOCK \
-  lock();
+  lock(NODE_EV_LOOP);
 
 #define UNLOCK \
-  unlock();
+  unlock(NODE_EV_LOOP);
 
 #define UNLOCK_N_WAKEUP \
-  wakeup();           \
-  unlock();
+  wakeup(NODE_EV_LOOP); \
+  unlock(NODE_EV_LOOP);
 
 #ifdef __cplusplus
 };
@@ -64,6 +73,8 @@ extern "C" {
 namespace node {
 
 class Node;
+class SlabHeap;
+struct EvLoop;
 
 class Lock {
   public:
@@ -158,6 +169,36 @@ class Node :
      */
     static void InvokePending();
 
+    /**
+     * Time budgeted variant of InvokePending, dispatches callbacks until
+     * budgetUs microseconds have elapsed and leaves the rest pending, the
+     * client is signalled again through the invoke pending callback
+     * @param budgetUs budget in microseconds, 0 for no limit
+     */
+    static void InvokePending(unsigned int budgetUs);
+
+    /**
+     * Sets the default budget used by InvokePending()
+     */
+    static void SetInvokePendingBudget(unsigned int budgetUs);
+
+    /**
+     * Returns an instance for client, adopting a bootstrapped spare when
+     * one is ready, creating one otherwise. Called in the client context
+     * @param client Handle to browser, used for sending events
+     */
+    static dapi::INode* CreateINode(dapi::INodeClient* client);
+
+    /**
+     * Number of bootstrapped spares to keep ready for CreateINode, 0 disables
+     */
+    static void SetSparePoolSize(unsigned int size);
+
+    /**
+     * Releases the spares, used under memory pressure
+     */
+    static void TrimMemory();
+
     /**
      * Get handle to loadModule function in the current node context
      * this will be set as window.navigator.loadModule by the client
@@ -257,6 +298,7 @@ class Node :
     dapi::INode* inode() { return m_inode; }
 
     void Init();
+    void Adopt(); // rebinds a spare to its new client and the current context
     void SetupProcessObject();
     void Load(); // load all builtin modules in current context
     void Tick();
@@ -268,6 +310,16 @@ class Node :
     void onResume();
     void onIdle();
 
+    // true between onPause() and onResume()
+    bool paused() { return m_paused; }
+
+    // allocator of this instance's buffers, NULL when disabled
+    SlabHeap* slab() { return m_slab; }
+
+    // slab() of the node owning the current context, NULL for contexts
+    // without one (vm module)
+    static SlabHeap* CurrentSlab();
+
     // INodeCore
 
     /**
@@ -282,6 +334,10 @@ class Node :
     v8::Handle<v8::Context> inodeClientContext() { return m_browserContext; }
     void addWatcherWrap(void* watcherWrap);
     void removeWatcherWrap(void* watcherWrap);
+    void loopStats(dapi::LoopStats* stats);
+    v8::Handle<v8::Object> createBuffer(char* data, size_t length,
+        FreeCallback cb, void* hint);
+    v8::Handle<v8::Object> createSharedBuffer(v8::Handle<v8::Object> backing);
 
   private:
 
@@ -311,6 +367,15 @@ class Node :
     uv_idle_t m_tick_spinner;
     bool m_need_tick_cb;
 
+    // paused by the client, the tick spinner is left stopped meanwhile
+    bool m_paused;
+
+    // loop the watchers of this instance are started on
+    EvLoop* m_loop;
+
+    // backing stores of the buffers, released with the instance
+    SlabHeap* m_slab;
+
     // watcher for timeouts
     uv_timer_t  m_test_timeout_watcher;
 
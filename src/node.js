@@ -288,9 +288,6 @@
   // core modules found in lib/*.js. All core modules are compiled into the
   // node binary, so they can be loaded faster.
 
-  var Script = process.binding('evals').NodeScript;
-  var runInThisContext = Script.runInThisContext;
-
   function translateId(id) {
     switch (id) {
       case 'net':
@@ -368,16 +365,16 @@
     return NativeModule.wrapper[0] + script + NativeModule.wrapper[1];
   };
 
+  // NativeSource() in node.cc wraps the builtins with the same text
   NativeModule.wrapper = [
     '(function (process, exports, require, module, __filename, __dirname, Buffer) { ',
     '\n});'
   ];
 
   NativeModule.prototype.compile = function() {
-    var source = NativeModule.getSource(this.id);
-    source = NativeModule.wrap(source);
-
-    var fn = runInThisContext(source, this.filename, true);
+    // compiled once per process and shared by all the node instances, the
+    // source is looked up natively from the id
+    var fn = process._runNative(this.id);
     // proteus, pass process as a parameter in closure so that trusted modules can access it,
     // but the global/user space dont have access
     fn(process, this.exports, NativeModule.require, this, this.filename, undefined, process.Buffer);
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <node_base64.h>
+#include <node_cpu.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#define NODE_BASE64_SSSE3
+#endif
+
+namespace node {
+
+static const char *base64_table = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                  "abcdefghijklmnopqrstuvwxyz"
+                                  "0123456789+/";
+static const int unbase64_table[] =
+  {-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-2,-1,-1,-2,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-2,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,62,-1,-1,-1,63
+  ,52,53,54,55,56,57,58,59,60,61,-1,-1,-1,-1,-1,-1
+  ,-1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,10,11,12,13,14
+  ,15,16,17,18,19,20,21,22,23,24,25,-1,-1,-1,-1,-1
+  ,-1,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40
+  ,41,42,43,44,45,46,47,48,49,50,51,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  };
+#define unbase64(x) unbase64_table[(uint8_t)(x)]
+
+
+// no blocks, base64_encode/base64_decode do it all
+static size_t scalar_encode(const uint8_t *src, size_t len, char *dst) {
+  return 0;
+}
+
+static size_t scalar_decode(const char *src, size_t len, uint8_t *dst) {
+  return 0;
+}
+
+static const Base64Kernels s_scalar = { "scalar", scalar_encode, scalar_decode };
+
+
+#ifdef NODE_BASE64_SSSE3
+
+#define SSSE3 __attribute__((target("ssse3")))
+
+// 16 6-bit values to their characters: the high nibble of a saturated
+// subtraction picks the offset of the value's range
+SSSE3 static inline __m128i encode_translate(__m128i v) {
+  const __m128i offsets = _mm_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  __m128i range = _mm_subs_epu8(v, _mm_set1_epi8(51));
+  __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), v);
+  range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+  return _mm_add_epi8(v, _mm_shuffle_epi8(offsets, range));
+}
+
+// 12 bytes per 16 characters, loads 16 bytes
+SSSE3 static size_t ssse3_encode(const uint8_t *src, size_t len, char *dst) {
+  const uint8_t *start = src;
+  while (len >= 16) {
+    __m128i in = _mm_loadu_si128((const __m128i*) src);
+    // each 32 bit lane gets the 3 bytes of one group as b1 b0 b2 b1
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+                                           4, 5, 3, 4, 1, 2, 0, 1));
+    // move the 4 6-bit fields to the low bits of their bytes
+    __m128i ac = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+                                 _mm_set1_epi32(0x04000040));
+    __m128i bd = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+                                 _mm_set1_epi32(0x01000010));
+    _mm_storeu_si128((__m128i*) dst, encode_translate(_mm_or_si128(ac, bd)));
+    src += 12;
+    dst += 16;
+    len -= 12;
+  }
+  return src - start;
+}
+
+SSSE3 static inline __m128i in_range(__m128i c, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(lo - 1)),
+                       _mm_cmplt_epi8(c, _mm_set1_epi8(hi + 1)));
+}
+
+// 16 characters per 12 bytes, 0 for a block with anything else
+SSSE3 static size_t ssse3_decode(const char *src, size_t len, uint8_t *dst) {
+  const char *start = src;
+  while (len >= 16) {
+    __m128i c = _mm_loadu_si128((const __m128i*) src);
+    __m128i upper = in_range(c, 'A', 'Z');
+    __m128i lower = in_range(c, 'a', 'z');
+    __m128i digit = in_range(c, '0', '9');
+    __m128i plus = _mm_cmpeq_epi8(c, _mm_set1_epi8('+'));
+    __m128i slash = _mm_cmpeq_epi8(c, _mm_set1_epi8('/'));
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower),
+                                 _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+    if (_mm_movemask_epi8(valid) != 0xffff) {
+      break;
+    }
+
+    __m128i v = _mm_and_si128(upper, _mm_sub_epi8(c, _mm_set1_epi8('A')));
+    v = _mm_or_si128(v, _mm_and_si128(lower, _mm_sub_epi8(c, _mm_set1_epi8('a' - 26))));
+    v = _mm_or_si128(v, _mm_and_si128(digit, _mm_add_epi8(c, _mm_set1_epi8(52 - '0'))));
+    v = _mm_or_si128(v, _mm_and_si128(plus, _mm_set1_epi8(62)));
+    v = _mm_or_si128(v, _mm_and_si128(slash, _mm_set1_epi8(63)));
+
+    // pack the 6-bit fields to 24 bit groups, big endian in the lanes
+    v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+    v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+    v = _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                          -1, -1, -1, -1));
+    // dst is sized for the decoded length, don't store past the 12 bytes
+    uint8_t out[16];
+    _mm_storeu_si128((__m128i*) out, v);
+    memcpy(dst, out, 12);
+    src += 16;
+    dst += 12;
+    len -= 16;
+  }
+  return src - start;
+}
+
+static const Base64Kernels s_ssse3 = { "ssse3", ssse3_encode, ssse3_decode };
+
+#undef SSSE3
+
+#endif  // NODE_BASE64_SSSE3
+
+
+static const Base64Kernels *s_kernels;
+
+// Picked once, racing threads pick the same kernels
+static const Base64Kernels* Kernels() {
+  if (s_kernels) {
+    return s_kernels;
+  }
+
+  const Base64Kernels *kernels = &s_scalar;
+  if (cpu_simd_enabled()) {
+#ifdef NODE_BASE64_SSSE3
+    if (cpu_has_ssse3()) {
+      kernels = &s_ssse3;
+    }
+#endif
+    if (base64_neon_kernels()) {
+      kernels = base64_neon_kernels();
+    }
+  }
+  s_kernels = kernels;
+  return s_kernels;
+}
+
+const char* base64_impl() {
+  return Kernels()->name;
+}
+
+
+size_t base64_encode(const char *src, size_t len, char *dst) {
+  const uint8_t *in = (const uint8_t*) src;
+  size_t done = Kernels()->encode(in, len, dst);
+  char *out = dst + done / 3 * 4;
+
+  // the remainder, 3 bytes to 4 characters, padded
+  for (size_t i = done; i < len; i += 3) {
+    uint8_t b0 = in[i];
+    uint8_t b1 = i + 1 < len ? in[i + 1] : 0;
+    uint8_t b2 = i + 2 < len ? in[i + 2] : 0;
+
+    *out++ = base64_table[b0 >> 2];
+    *out++ = base64_table[((b0 & 0x03) << 4) | (b1 >> 4)];
+    *out++ = i + 1 < len ? base64_table[((b1 & 0x0F) << 2) | (b2 >> 6)] : '=';
+    *out++ = i + 2 < len ? base64_table[b2 & 0x3F] : '=';
+  }
+
+  assert((size_t) (out - dst) == base64_encoded_size(len));
+  return out - dst;
+}
+
+
+size_t base64_decode(const char *src, size_t len, char *dst) {
+  assert(unbase64('/') == 63);
+  assert(unbase64('+') == 62);
+  assert(unbase64('T') == 19);
+  assert(unbase64('Z') == 25);
+  assert(unbase64('t') == 45);
+  assert(unbase64('z') == 51);
+
+  assert(unbase64(' ') == -2);
+  assert(unbase64('\n') == -2);
+  assert(unbase64('\r') == -2);
+
+  const Base64Kernels *kernels = Kernels();
+  char a, b, c, d;
+  char* start = dst;
+  const char *const srcEnd = src + len;
+
+  while (src < srcEnd) {
+    // runs of clean blocks, then one group at a time over whitespace and
+    // padding until the next clean block
+    size_t done = kernels->decode(src, srcEnd - src, (uint8_t*) dst);
+    src += done;
+    dst += done / 4 * 3;
+
+    int remaining = srcEnd - src;
+
+    while (src < srcEnd && unbase64(*src) < 0) {
+      src++;
+      remaining--;
+    }
+    if (remaining == 0 || *src == '=') break;
+    a = unbase64(*src++);
+
+    while (src < srcEnd && unbase64(*src) < 0) {
+      src++;
+      remaining--;
+    }
+    if (remaining <= 1 || *src == '=') break;
+    b = unbase64(*src++);
+    *dst++ = (a << 2) | ((b & 0x30) >> 4);
+
+    while (src < srcEnd && unbase64(*src) < 0) {
+      src++;
+      remaining--;
+    }
+    if (remaining <= 2 || *src == '=') break;
+    c = unbase64(*src++);
+    *dst++ = ((b & 0x0F) << 4) | ((c & 0x3C) >> 2);
+
+    while (src < srcEnd && unbase64(*src) < 0) {
+      src++;
+      remaining--;
+    }
+    if (remaining <= 3 || *src == '=') break;
+    d = unbase64(*src++);
+    *dst++ = ((c & 0x03) << 6) | (d & 0x3F);
+  }
+
+  return dst - start;
+}
+
+}  // namespace node
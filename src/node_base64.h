@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NODE_BASE64_H_
+#define NODE_BASE64_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace node {
+
+/**
+ * Vectorized kernels, both process whole blocks only and return the number
+ * of input bytes consumed. decode stops at the first block holding anything
+ * but the 64 alphabet characters (whitespace, padding, garbage), the scalar
+ * code takes it from there.
+ */
+struct Base64Kernels {
+  const char *name;
+  size_t (*encode)(const uint8_t *src, size_t len, char *dst);
+  size_t (*decode)(const char *src, size_t len, uint8_t *dst);
+};
+
+// NEON kernels, NULL if the cpu or the build has no NEON
+const Base64Kernels* base64_neon_kernels();
+
+// size of the encoding of len bytes, padding included
+inline size_t base64_encoded_size(size_t len) {
+  return (len + 2) / 3 * 4;
+}
+
+/**
+ * Encodes len bytes from src into dst, which must hold
+ * base64_encoded_size(len) characters. Returns the characters written.
+ */
+size_t base64_encode(const char *src, size_t len, char *dst);
+
+/**
+ * Decodes len characters from src into dst, skipping whitespace and
+ * invalid characters and stopping at padding. dst must hold the size
+ * computed from the length and padding of src. Returns the bytes written.
+ */
+size_t base64_decode(const char *src, size_t len, char *dst);
+
+// name of the kernels in use: "neon", "ssse3" or "scalar"
+const char* base64_impl();
+
+}  // namespace node
+
+#endif  // NODE_BASE64_H_
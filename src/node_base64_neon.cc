@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Built with NEON enabled on ARM (see Android.libnode.mk), only called once
+// the cpu is known to have it. Empty on other targets.
+
+#include <node_base64.h>
+#include <node_cpu.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+namespace node {
+
+// 6-bit values to their characters, 'A' + v moved by the offset of the
+// range v falls into
+static inline uint8x16_t encode_translate(uint8x16_t v) {
+  uint8x16_t c = vaddq_u8(v, vdupq_n_u8('A'));
+  c = vaddq_u8(c, vandq_u8(vcgtq_u8(v, vdupq_n_u8(25)), vdupq_n_u8('a' - 'A' - 26)));
+  c = vsubq_u8(c, vandq_u8(vcgtq_u8(v, vdupq_n_u8(51)), vdupq_n_u8('a' - '0' + 26)));
+  c = vsubq_u8(c, vandq_u8(vceqq_u8(v, vdupq_n_u8(62)), vdupq_n_u8('0' + 10 - '+')));
+  c = vsubq_u8(c, vandq_u8(vceqq_u8(v, vdupq_n_u8(63)), vdupq_n_u8('0' + 11 - '/')));
+  return c;
+}
+
+// 48 bytes per 64 characters, de-interleaved by the loads and stores
+static size_t neon_encode(const uint8_t *src, size_t len, char *dst) {
+  const uint8_t *start = src;
+  while (len >= 48) {
+    uint8x16x3_t in = vld3q_u8(src);
+    uint8x16x4_t out;
+    out.val[0] = vshrq_n_u8(in.val[0], 2);
+    out.val[1] = vorrq_u8(vshlq_n_u8(vandq_u8(in.val[0], vdupq_n_u8(0x03)), 4),
+                          vshrq_n_u8(in.val[1], 4));
+    out.val[2] = vorrq_u8(vshlq_n_u8(vandq_u8(in.val[1], vdupq_n_u8(0x0f)), 2),
+                          vshrq_n_u8(in.val[2], 6));
+    out.val[3] = vandq_u8(in.val[2], vdupq_n_u8(0x3f));
+    for (int i = 0; i < 4; i++) {
+      out.val[i] = encode_translate(out.val[i]);
+    }
+    vst4q_u8((uint8_t*) dst, out);
+    src += 48;
+    dst += 64;
+    len -= 48;
+  }
+  return src - start;
+}
+
+static inline uint8x16_t in_range(uint8x16_t c, uint8_t lo, uint8_t hi) {
+  return vandq_u8(vcgeq_u8(c, vdupq_n_u8(lo)), vcleq_u8(c, vdupq_n_u8(hi)));
+}
+
+// characters to 6-bit values, bad collects what is outside the alphabet
+static inline uint8x16_t decode_translate(uint8x16_t c, uint8x16_t &bad) {
+  uint8x16_t upper = in_range(c, 'A', 'Z');
+  uint8x16_t lower = in_range(c, 'a', 'z');
+  uint8x16_t digit = in_range(c, '0', '9');
+  uint8x16_t plus = vceqq_u8(c, vdupq_n_u8('+'));
+  uint8x16_t slash = vceqq_u8(c, vdupq_n_u8('/'));
+  bad = vorrq_u8(bad, vmvnq_u8(vorrq_u8(vorrq_u8(upper, lower),
+                                        vorrq_u8(digit, vorrq_u8(plus, slash)))));
+
+  uint8x16_t v = vandq_u8(upper, vsubq_u8(c, vdupq_n_u8('A')));
+  v = vorrq_u8(v, vandq_u8(lower, vsubq_u8(c, vdupq_n_u8('a' - 26))));
+  v = vorrq_u8(v, vandq_u8(digit, vaddq_u8(c, vdupq_n_u8(52 - '0'))));
+  v = vorrq_u8(v, vandq_u8(plus, vdupq_n_u8(62)));
+  v = vorrq_u8(v, vandq_u8(slash, vdupq_n_u8(63)));
+  return v;
+}
+
+// 64 characters per 48 bytes, 0 for a block with anything else
+static size_t neon_decode(const char *src, size_t len, uint8_t *dst) {
+  const char *start = src;
+  while (len >= 64) {
+    uint8x16x4_t in = vld4q_u8((const uint8_t*) src);
+    uint8x16_t bad = vdupq_n_u8(0);
+    for (int i = 0; i < 4; i++) {
+      in.val[i] = decode_translate(in.val[i], bad);
+    }
+    uint64x2_t bad64 = vreinterpretq_u64_u8(bad);
+    if (vgetq_lane_u64(bad64, 0) | vgetq_lane_u64(bad64, 1)) {
+      break;
+    }
+
+    uint8x16x3_t out;
+    out.val[0] = vorrq_u8(vshlq_n_u8(in.val[0], 2), vshrq_n_u8(in.val[1], 4));
+    out.val[1] = vorrq_u8(vshlq_n_u8(in.val[1], 4), vshrq_n_u8(in.val[2], 2));
+    out.val[2] = vorrq_u8(vshlq_n_u8(in.val[2], 6), in.val[3]);
+    vst3q_u8(dst, out);
+    src += 64;
+    dst += 48;
+    len -= 64;
+  }
+  return src - start;
+}
+
+static const Base64Kernels s_neon = { "neon", neon_encode, neon_decode };
+
+const Base64Kernels* base64_neon_kernels() {
+  return cpu_has_neon() ? &s_neon : NULL;
+}
+
+}  // namespace node
+
+#else
+
+namespace node {
+
+const Base64Kernels* base64_neon_kernels() {
+  return NULL;
+}
+
+}  // namespace node
+
+#endif
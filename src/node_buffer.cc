@@ -22,12 +22,18 @@
 
 #include <node.h>
 #include <node_buffer.h>
+#include <node_base64.h>
+#include <node_hex.h>
+#include <node_utf8.h>
+#include <node_slab.h>
+#include <node_search.h>
 
 #include <v8.h>
 
 #include <assert.h>
 #include <stdlib.h> // malloc, free
 #include <string.h> // memcpy
+#include <math.h> // fmod
 
 #ifdef __MINGW32__
 # include <platform.h>
@@ -72,8 +78,10 @@ static Persistent<String> write_sym;
 Persistent<FunctionTemplate> Buffer::constructor_template;
 
 
-static inline size_t base64_decoded_size(const char *src, size_t size) {
-  const char *const end = src + size;
+// only the length and the trailing padding matter, end points past the
+// last two characters
+template <typename T>
+static inline size_t base64_decoded_size(const T *end, size_t size) {
   const int remainder = size % 4;
 
   size = (size / 4) * 3;
@@ -103,8 +111,13 @@ static size_t ByteLength (Handle<String> string, enum encoding enc) {
   if (enc == UTF8) {
     return string->Utf8Length();
   } else if (enc == BASE64) {
-    String::Utf8Value v(string);
-    return base64_decoded_size(*v, v.length());
+    // no need to copy the whole string for its last two characters
+    uint16_t tail[2] = { 0, 0 };
+    int length = string->Length();
+    if (length >= 2) {
+      string->Write(tail, length - 2, 2);
+    }
+    return base64_decoded_size(tail + 2, length);
   } else if (enc == UCS2) {
     return string->Length() * 2;
   } else if (enc == HEX) {
@@ -169,6 +182,44 @@ Buffer* Buffer::New(char *data, size_t length,
 }
 
 
+static void ReleaseBacking(char *data, void *hint) {
+  Persistent<Object> *backing = static_cast<Persistent<Object>*>(hint);
+  backing->Dispose();
+  delete backing;
+}
+
+
+static size_t ExternalArraySize(ExternalArrayType type) {
+  switch (type) {
+    case kExternalShortArray:
+    case kExternalUnsignedShortArray:
+      return 2;
+    case kExternalIntArray:
+    case kExternalUnsignedIntArray:
+    case kExternalFloatArray:
+      return 4;
+    case kExternalDoubleArray:
+      return 8;
+    default:
+      return 1;
+  }
+}
+
+
+Buffer* Buffer::NewShared(Handle<Object> backing) {
+  HandleScope scope;
+
+  if (!backing->HasIndexedPropertiesInExternalArrayData()) {
+    return NULL;
+  }
+
+  size_t length = backing->GetIndexedPropertiesExternalArrayDataLength() *
+    ExternalArraySize(backing->GetIndexedPropertiesExternalArrayDataType());
+  Persistent<Object> *hint = new Persistent<Object>(Persistent<Object>::New(backing));
+  return New(Data(backing), length, ReleaseBacking, hint);
+}
+
+
 Handle<Value> Buffer::New(const Arguments &args) {
   if (!args.IsConstructCall()) {
     return Node::FromConstructorTemplate(constructor_template, args);
@@ -192,6 +243,7 @@ Buffer::Buffer(Handle<Object> wrapper, size_t length) : ObjectWrap() {
   Wrap(wrapper);
 
   length_ = 0;
+  slab_ = NULL;
   callback_ = NULL;
 
   Replace(NULL, length, NULL, NULL);
@@ -213,6 +265,10 @@ void Buffer::Replace(char *data, size_t length,
 
   if (callback_) {
     callback_(data_, callback_hint_);
+  } else if (slab_) {
+    // the heap reports its chunks to v8, not each buffer
+    slab_->Free(data_, length_);
+    slab_ = NULL;
   } else if (length_) {
     delete [] data_;
     V8::AdjustAmountOfExternalAllocatedMemory(-(sizeof(Buffer) + length_));
@@ -225,10 +281,15 @@ void Buffer::Replace(char *data, size_t length,
   if (callback_) {
     data_ = data;
   } else if (length_) {
-    data_ = new char[length_];
+    slab_ = Node::CurrentSlab();
+    data_ = slab_ ? slab_->Alloc(length_) : NULL;
+    if (!data_) {
+      slab_ = NULL;
+      data_ = new char[length_];
+      V8::AdjustAmountOfExternalAllocatedMemory(sizeof(Buffer) + length_);
+    }
     if (data)
       memcpy(data_, data, length_);
-    V8::AdjustAmountOfExternalAllocatedMemory(sizeof(Buffer) + length_);
   } else {
     data_ = NULL;
   }
@@ -266,13 +327,82 @@ Handle<Value> Buffer::AsciiSlice(const Arguments &args) {
 }
 
 
+// how the utf8 slices and writes went, see process.utf8Stats()
+static struct {
+  unsigned int sliceAscii;    // 7-bit ASCII only
+  unsigned int sliceExternal; // of these, handed to v8 as external strings
+  unsigned int sliceDecoded;  // valid UTF-8, decoded here
+  unsigned int sliceFallback; // invalid UTF-8, left to v8's decoder
+  unsigned int writeAscii;    // 7-bit ASCII only
+  unsigned int writeMixed;
+} s_utf8Stats;
+
+// ASCII slices this big become external strings, v8 neither scans nor
+// copies them a character at a time
+#define EXTERNAL_ASCII_MIN (64 * 1024)
+
+// decode buffer kept on the stack
+#define UTF8_STACK_UNITS 512
+
+class ExternalAsciiString : public String::ExternalAsciiStringResource {
+ public:
+  ExternalAsciiString(const char *data, size_t length)
+    : data_(new char[length]), length_(length) {
+    memcpy(data_, data, length);
+    V8::AdjustAmountOfExternalAllocatedMemory(length_);
+  }
+
+  ~ExternalAsciiString() {
+    delete [] data_;
+    V8::AdjustAmountOfExternalAllocatedMemory(-length_);
+  }
+
+  const char* data() const { return data_; }
+  size_t length() const { return length_; }
+
+ private:
+  char *data_;
+  size_t length_;
+};
+
+
+Local<String> Buffer::Utf8String(const char *data, size_t length) {
+  HandleScope scope;
+
+  if (utf8_ascii_prefix(data, length) == length) {
+    s_utf8Stats.sliceAscii++;
+    if (length >= EXTERNAL_ASCII_MIN) {
+      s_utf8Stats.sliceExternal++;
+      return scope.Close(String::NewExternal(new ExternalAsciiString(data, length)));
+    }
+    return scope.Close(String::New(data, length));
+  }
+
+  // v8 decodes in two passes a character at a time, do it here unless the
+  // data needs its replacement of the invalid sequences
+  uint16_t stack[UTF8_STACK_UNITS];
+  uint16_t *units = length <= UTF8_STACK_UNITS ? stack : new uint16_t[length];
+  ssize_t n = utf8_decode(data, length, units);
+  Local<String> string;
+  if (n >= 0) {
+    s_utf8Stats.sliceDecoded++;
+    string = String::New(units, n);
+  } else {
+    s_utf8Stats.sliceFallback++;
+    string = String::New(data, length);
+  }
+  if (units != stack) {
+    delete [] units;
+  }
+  return scope.Close(string);
+}
+
+
 Handle<Value> Buffer::Utf8Slice(const Arguments &args) {
   HandleScope scope;
   Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
   SLICE_ARGS(args[0], args[1])
-  char *data = parent->data_ + start;
-  Local<String> string = String::New(data, end - start);
-  return scope.Close(string);
+  return scope.Close(Utf8String(parent->data_ + start, end - start));
 }
 
 Handle<Value> Buffer::Ucs2Slice(const Arguments &args) {
@@ -284,95 +414,31 @@ Handle<Value> Buffer::Ucs2Slice(const Arguments &args) {
   return scope.Close(string);
 }
 
-static const char *base64_table = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-                                  "abcdefghijklmnopqrstuvwxyz"
-                                  "0123456789+/";
-static const int unbase64_table[] =
-  {-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-2,-1,-1,-2,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-2,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,62,-1,-1,-1,63
-  ,52,53,54,55,56,57,58,59,60,61,-1,-1,-1,-1,-1,-1
-  ,-1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,10,11,12,13,14
-  ,15,16,17,18,19,20,21,22,23,24,25,-1,-1,-1,-1,-1
-  ,-1,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40
-  ,41,42,43,44,45,46,47,48,49,50,51,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-  };
-#define unbase64(x) unbase64_table[(uint8_t)(x)]
 
-
-Handle<Value> Buffer::Base64Slice(const Arguments &args) {
+Handle<Value> Buffer::HexSlice(const Arguments &args) {
   HandleScope scope;
   Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
   SLICE_ARGS(args[0], args[1])
 
   int n = end - start;
-  int out_len = (n + 2 - ((n + 2) % 3)) / 3 * 4;
-  char *out = new char[out_len];
+  char *out = new char[n * 2];
+  hex_encode(parent->data_ + start, n, out);
 
-  uint8_t bitbuf[3];
-  int i = start; // data() index
-  int j = 0; // out index
-  char c;
-  bool b1_oob, b2_oob;
-
-  while (i < end) {
-    bitbuf[0] = parent->data_[i++];
-
-    if (i < end) {
-      bitbuf[1] = parent->data_[i];
-      b1_oob = false;
-    }  else {
-      bitbuf[1] = 0;
-      b1_oob = true;
-    }
-    i++;
-
-    if (i < end) {
-      bitbuf[2] = parent->data_[i];
-      b2_oob = false;
-    }  else {
-      bitbuf[2] = 0;
-      b2_oob = true;
-    }
-    i++;
-
-
-    c = bitbuf[0] >> 2;
-    assert(c < 64);
-    out[j++] = base64_table[(int)c];
-    assert(j < out_len);
+  Local<String> string = String::New(out, n * 2);
+  delete [] out;
+  return scope.Close(string);
+}
 
-    c = ((bitbuf[0] & 0x03) << 4) | (bitbuf[1] >> 4);
-    assert(c < 64);
-    out[j++] = base64_table[(int)c];
-    assert(j < out_len);
 
-    if (b1_oob) {
-      out[j++] = '=';
-    } else {
-      c = ((bitbuf[1] & 0x0F) << 2) | (bitbuf[2] >> 6);
-      assert(c < 64);
-      out[j++] = base64_table[(int)c];
-    }
-    assert(j < out_len);
+Handle<Value> Buffer::Base64Slice(const Arguments &args) {
+  HandleScope scope;
+  Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
+  SLICE_ARGS(args[0], args[1])
 
-    if (b2_oob) {
-      out[j++] = '=';
-    } else {
-      c = bitbuf[2] & 0x3F;
-      assert(c < 64);
-      out[j++]  = base64_table[(int)c];
-    }
-    assert(j <= out_len);
-  }
+  int n = end - start;
+  int out_len = base64_encoded_size(n);
+  char *out = new char[out_len];
+  base64_encode(parent->data_ + start, n, out);
 
   Local<String> string = String::New(out, out_len);
   delete [] out;
@@ -401,6 +467,270 @@ Handle<Value> Buffer::Fill(const Arguments &args) {
 }
 
 
+// needles held on the stack, longer strings are decoded on the heap
+#define NEEDLE_STACK_BYTES 256
+
+// buffer.indexOf(value, start, end, encoding) and lastIndexOf(), value
+// is a byte, a string in encoding (utf8 by default) or a buffer. Returns the
+// offset of the first/last match within [start, end) or -1
+Handle<Value> Buffer::Search(const Arguments &args, bool forward) {
+  HandleScope scope;
+  Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
+  SLICE_ARGS(args[1], args[2])
+
+  char stack[NEEDLE_STACK_BYTES];
+  char *needle = stack;
+  size_t nlen;
+  if (args[0]->IsNumber()) {
+    stack[0] = (char) args[0]->Int32Value();
+    nlen = 1;
+  } else if (args[0]->IsString()) {
+    Local<String> s = args[0]->ToString();
+    enum encoding e = Node::ParseEncoding(args[3], UTF8);
+    nlen = node::ByteLength(s, e);
+    if (nlen > NEEDLE_STACK_BYTES) {
+      needle = new char[nlen];
+    }
+    ssize_t written = Node::DecodeWrite(needle, nlen, s, e);
+    if (written < 0) {
+      // e.g. an odd length or non hex digits for 'hex'
+      if (needle != stack) {
+        delete [] needle;
+      }
+      return ThrowException(Exception::TypeError(String::New(
+              "value can't be decoded in the given encoding")));
+    }
+    nlen = written;
+  } else if (Buffer::HasInstance(args[0]) ||
+             (args[0]->IsObject() &&
+              args[0]->ToObject()->HasIndexedPropertiesInExternalArrayData())) {
+    // a SlowBuffer or a Buffer, which has the data of its slice
+    needle = Buffer::Data(args[0]->ToObject());
+    nlen = Buffer::Length(args[0]->ToObject());
+  } else {
+    return ThrowException(Exception::TypeError(String::New(
+            "value must be a number, string or Buffer")));
+  }
+
+  ssize_t found = forward ?
+    search_forward(parent->data_ + start, end - start, needle, nlen) :
+    search_backward(parent->data_ + start, end - start, needle, nlen);
+
+  if (needle != stack && args[0]->IsString()) {
+    delete [] needle;
+  }
+  return scope.Close(Integer::New(found < 0 ? -1 : start + found));
+}
+
+
+Handle<Value> Buffer::IndexOf(const Arguments &args) {
+  return Search(args, true);
+}
+
+
+Handle<Value> Buffer::LastIndexOf(const Arguments &args) {
+  return Search(args, false);
+}
+
+
+// Fixed width numbers, in the byte order asked for whatever the host's
+enum NumberType {
+  NUMBER_UINT8, NUMBER_INT8, NUMBER_UINT16, NUMBER_INT16,
+  NUMBER_UINT32, NUMBER_INT32, NUMBER_FLOAT, NUMBER_DOUBLE,
+  NUMBER_INVALID
+};
+
+static const char *number_type_names[] = {
+  "uint8", "int8", "uint16", "int16", "uint32", "int32", "float", "double"
+};
+
+static NumberType ParseNumberType(Handle<Value> type) {
+  if (type->IsString()) {
+    String::AsciiValue name(type);
+    for (int i = 0; i < NUMBER_INVALID; i++) {
+      if (!strcmp(*name, number_type_names[i])) {
+        return (NumberType) i;
+      }
+    }
+  }
+  return NUMBER_INVALID;
+}
+
+static inline bool HostIsBigEndian() {
+  const uint16_t one = 1;
+  return *(const uint8_t*) &one == 0;
+}
+
+template <typename T>
+static inline T LoadNumber(const char *p, bool big) {
+  union { T value; char bytes[sizeof(T)]; } u;
+  if (big == HostIsBigEndian()) {
+    memcpy(u.bytes, p, sizeof(T));
+  } else {
+    for (size_t i = 0; i < sizeof(T); i++) {
+      u.bytes[i] = p[sizeof(T) - 1 - i];
+    }
+  }
+  return u.value;
+}
+
+template <typename T>
+static inline void StoreNumber(char *p, T value, bool big) {
+  union { T value; char bytes[sizeof(T)]; } u;
+  u.value = value;
+  if (big == HostIsBigEndian()) {
+    memcpy(p, u.bytes, sizeof(T));
+  } else {
+    for (size_t i = 0; i < sizeof(T); i++) {
+      p[i] = u.bytes[sizeof(T) - 1 - i];
+    }
+  }
+}
+
+// integers wrap modulo 2^32 like ToInt32, the single value writes check the
+// range in lib/buffer.js first
+template <typename T>
+static inline T ToNumber(double value) {
+  if (isnan(value) || isinf(value)) {
+    return 0;
+  }
+  return (T) (int64_t) fmod(value, 4294967296.0);
+}
+
+template <>
+inline float ToNumber<float>(double value) {
+  return (float) value;
+}
+
+template <>
+inline double ToNumber<double>(double value) {
+  return value;
+}
+
+static inline Local<Value> NumberValue(double value) {
+  return Number::New(value);
+}
+
+
+#define NUMBER_BOUNDS(offset, size, length)                          \
+  if ((offset) > (length) || (size) > (length) - (offset)) {         \
+    return ThrowException(Exception::RangeError(                     \
+          String::New("Trying to access beyond buffer length")));    \
+  }
+
+// slowBuffer._readUInt16(offset, bigEndian) and friends
+template <typename T>
+Handle<Value> Buffer::ReadNumber(const Arguments &args) {
+  HandleScope scope;
+  Buffer *buffer = ObjectWrap::Unwrap<Buffer>(args.This());
+  size_t offset = args[0]->Uint32Value();
+  NUMBER_BOUNDS(offset, sizeof(T), buffer->length_)
+  return scope.Close(NumberValue(LoadNumber<T>(buffer->data_ + offset, args[1]->IsTrue())));
+}
+
+
+// slowBuffer._writeUInt16(value, offset, bigEndian) and friends
+template <typename T>
+Handle<Value> Buffer::WriteNumber(const Arguments &args) {
+  HandleScope scope;
+  Buffer *buffer = ObjectWrap::Unwrap<Buffer>(args.This());
+  size_t offset = args[1]->Uint32Value();
+  NUMBER_BOUNDS(offset, sizeof(T), buffer->length_)
+  StoreNumber<T>(buffer->data_ + offset, ToNumber<T>(args[0]->NumberValue()),
+                 args[2]->IsTrue());
+  return Undefined();
+}
+
+
+template <typename T>
+static void LoadValues(const char *p, uint32_t count, bool big, Local<Array> values) {
+  for (uint32_t i = 0; i < count; i++, p += sizeof(T)) {
+    values->Set(i, NumberValue(LoadNumber<T>(p, big)));
+  }
+}
+
+template <typename T>
+static void StoreValues(char *p, Local<Array> values, uint32_t count, bool big) {
+  for (uint32_t i = 0; i < count; i++, p += sizeof(T)) {
+    StoreNumber<T>(p, ToNumber<T>(values->Get(i)->NumberValue()), big);
+  }
+}
+
+static const size_t number_type_sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+#define VALUES_BOUNDS(offset, count, size, length)                   \
+  if ((offset) > (length) || (count) > ((length) - (offset)) / (size)) { \
+    return ThrowException(Exception::RangeError(                     \
+          String::New("Trying to access beyond buffer length")));    \
+  }
+
+
+// var values = slowBuffer._readValues(type, offset, count, bigEndian)
+Handle<Value> Buffer::ReadValues(const Arguments &args) {
+  HandleScope scope;
+  Buffer *buffer = ObjectWrap::Unwrap<Buffer>(args.This());
+
+  NumberType type = ParseNumberType(args[0]);
+  if (type == NUMBER_INVALID) {
+    return ThrowException(Exception::TypeError(String::New("Unknown type")));
+  }
+  size_t offset = args[1]->Uint32Value();
+  uint32_t count = args[2]->Uint32Value();
+  bool big = args[3]->IsTrue();
+  VALUES_BOUNDS(offset, count, number_type_sizes[type], buffer->length_)
+
+  Local<Array> values = Array::New(count);
+  char *p = buffer->data_ + offset;
+  switch (type) {
+    case NUMBER_UINT8: LoadValues<uint8_t>(p, count, big, values); break;
+    case NUMBER_INT8: LoadValues<int8_t>(p, count, big, values); break;
+    case NUMBER_UINT16: LoadValues<uint16_t>(p, count, big, values); break;
+    case NUMBER_INT16: LoadValues<int16_t>(p, count, big, values); break;
+    case NUMBER_UINT32: LoadValues<uint32_t>(p, count, big, values); break;
+    case NUMBER_INT32: LoadValues<int32_t>(p, count, big, values); break;
+    case NUMBER_FLOAT: LoadValues<float>(p, count, big, values); break;
+    case NUMBER_DOUBLE: LoadValues<double>(p, count, big, values); break;
+    default: break;
+  }
+  return scope.Close(values);
+}
+
+
+// var bytes = slowBuffer._writeValues(type, values, offset, bigEndian)
+Handle<Value> Buffer::WriteValues(const Arguments &args) {
+  HandleScope scope;
+  Buffer *buffer = ObjectWrap::Unwrap<Buffer>(args.This());
+
+  NumberType type = ParseNumberType(args[0]);
+  if (type == NUMBER_INVALID) {
+    return ThrowException(Exception::TypeError(String::New("Unknown type")));
+  }
+  if (!args[1]->IsArray()) {
+    return ThrowException(Exception::TypeError(String::New(
+            "values must be an array")));
+  }
+  Local<Array> values = Local<Array>::Cast(args[1]);
+  size_t offset = args[2]->Uint32Value();
+  uint32_t count = values->Length();
+  bool big = args[3]->IsTrue();
+  VALUES_BOUNDS(offset, count, number_type_sizes[type], buffer->length_)
+
+  char *p = buffer->data_ + offset;
+  switch (type) {
+    case NUMBER_UINT8: StoreValues<uint8_t>(p, values, count, big); break;
+    case NUMBER_INT8: StoreValues<int8_t>(p, values, count, big); break;
+    case NUMBER_UINT16: StoreValues<uint16_t>(p, values, count, big); break;
+    case NUMBER_INT16: StoreValues<int16_t>(p, values, count, big); break;
+    case NUMBER_UINT32: StoreValues<uint32_t>(p, values, count, big); break;
+    case NUMBER_INT32: StoreValues<int32_t>(p, values, count, big); break;
+    case NUMBER_FLOAT: StoreValues<float>(p, values, count, big); break;
+    case NUMBER_DOUBLE: StoreValues<double>(p, values, count, big); break;
+    default: break;
+  }
+  return scope.Close(Integer::NewFromUnsigned(count * number_type_sizes[type]));
+}
+
+
 // var bytesCopied = buffer.copy(target, targetStart, sourceStart, sourceEnd);
 Handle<Value> Buffer::Copy(const Arguments &args) {
   HandleScope scope;
@@ -493,24 +823,31 @@ Handle<Value> Buffer::Utf8Write(const Arguments &args) {
 
   char* p = buffer->data_ + offset;
 
-  int char_written;
+  // String::WriteUtf8 encodes a character at a time, copy the string out
+  // in chunks instead and store the ASCII runs a block at a time
+  uint16_t units[UTF8_STACK_UNITS];
+  size_t written = 0;
+  int char_written = 0;
+  while (char_written < length && written < max_length) {
+    size_t chunk = MIN((size_t) (length - char_written), UTF8_STACK_UNITS);
+    s->Write(units, char_written, chunk, String::HINT_MANY_WRITES_EXPECTED);
+    size_t consumed;
+    written += utf8_encode(units, chunk, p + written, max_length - written, &consumed);
+    char_written += consumed;
+    if (consumed < chunk) {
+      break;
+    }
+  }
 
-  int written = s->WriteUtf8(p,
-                             max_length,
-                             &char_written,
-                             String::HINT_MANY_WRITES_EXPECTED);
+  if (written == (size_t) char_written) {
+    s_utf8Stats.writeAscii++;
+  } else {
+    s_utf8Stats.writeMixed++;
+  }
 
   constructor_template->GetFunction()->Set(chars_written_sym,
                                            Integer::New(char_written));
 
-  if (written > 0 && p[written-1] == '\0' && char_written == length) {
-    uint16_t last_char;
-    s->Write(&last_char, length - 1, 1, String::NO_HINTS);
-    if (last_char != 0 || written > s->Utf8Length()) {
-      written--;
-    }
-  }
-
   return scope.Close(Integer::New(written));
 }
 
@@ -552,6 +889,48 @@ Handle<Value> Buffer::Ucs2Write(const Arguments &args) {
 }
 
 
+// var bytesWritten = buffer.hexWrite(string, offset, [maxLength]);
+Handle<Value> Buffer::HexWrite(const Arguments &args) {
+  HandleScope scope;
+  Buffer *buffer = ObjectWrap::Unwrap<Buffer>(args.This());
+
+  if (!args[0]->IsString()) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Argument must be a string")));
+  }
+
+  Local<String> s = args[0]->ToString();
+
+  // must be an even number of digits
+  if (s->Length() % 2) {
+    return ThrowException(Exception::Error(String::New(
+            "Invalid hex string")));
+  }
+
+  size_t offset = args[1]->Uint32Value();
+
+  if (s->Length() > 0 && offset >= buffer->length_) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Offset is out of bounds")));
+  }
+
+  size_t max_length = args[2]->IsUndefined() ? buffer->length_ - offset
+                                             : args[2]->Uint32Value();
+  max_length = MIN(buffer->length_ - offset, max_length);
+
+  ssize_t written = hex_decode(s, buffer->data_ + offset, max_length);
+  if (written < 0) {
+    return ThrowException(Exception::Error(String::New(
+            "Invalid hex string")));
+  }
+
+  constructor_template->GetFunction()->Set(chars_written_sym,
+                                           Integer::New(written * 2));
+
+  return scope.Close(Integer::New(written));
+}
+
+
 // var charsWritten = buffer.asciiWrite(string, offset);
 Handle<Value> Buffer::AsciiWrite(const Arguments &args) {
   HandleScope scope;
@@ -595,17 +974,6 @@ Handle<Value> Buffer::AsciiWrite(const Arguments &args) {
 Handle<Value> Buffer::Base64Write(const Arguments &args) {
   HandleScope scope;
 
-  assert(unbase64('/') == 63);
-  assert(unbase64('+') == 62);
-  assert(unbase64('T') == 19);
-  assert(unbase64('Z') == 25);
-  assert(unbase64('t') == 45);
-  assert(unbase64('z') == 51);
-
-  assert(unbase64(' ') == -2);
-  assert(unbase64('\n') == -2);
-  assert(unbase64('\r') == -2);
-
   Buffer *buffer = ObjectWrap::Unwrap<Buffer>(args.This());
 
   if (!args[0]->IsString()) {
@@ -626,58 +994,19 @@ Handle<Value> Buffer::Base64Write(const Arguments &args) {
             "Offset is out of bounds")));
   }
 
-  const size_t size = base64_decoded_size(*s, s.length());
+  const size_t size = base64_decoded_size(*s + s.length(), s.length());
   if (size > buffer->length_ - offset) {
     // throw exception, don't silently truncate
     return ThrowException(Exception::TypeError(String::New(
             "Buffer too small")));
   }
 
-  char a, b, c, d;
-  char* start = buffer->data_ + offset;
-  char* dst = start;
-  const char *src = *s;
-  const char *const srcEnd = src + s.length();
-
-  while (src < srcEnd) {
-    int remaining = srcEnd - src;
-
-    while (unbase64(*src) < 0 && src < srcEnd) {
-      src++;
-      remaining--;
-    }
-    if (remaining == 0 || *src == '=') break;
-    a = unbase64(*src++);
-
-    while (unbase64(*src) < 0 && src < srcEnd) {
-      src++;
-      remaining--;
-    }
-    if (remaining <= 1 || *src == '=') break;
-    b = unbase64(*src++);
-    *dst++ = (a << 2) | ((b & 0x30) >> 4);
-
-    while (unbase64(*src) < 0 && src < srcEnd) {
-      src++;
-      remaining--;
-    }
-    if (remaining <= 2 || *src == '=') break;
-    c = unbase64(*src++);
-    *dst++ = ((b & 0x0F) << 4) | ((c & 0x3C) >> 2);
-
-    while (unbase64(*src) < 0 && src < srcEnd) {
-      src++;
-      remaining--;
-    }
-    if (remaining <= 3 || *src == '=') break;
-    d = unbase64(*src++);
-    *dst++ = ((c & 0x03) << 6) | (d & 0x3F);
-  }
+  size_t written = base64_decode(*s, s.length(), buffer->data_ + offset);
 
   constructor_template->GetFunction()->Set(chars_written_sym,
                                            Integer::New(s.length()));
 
-  return scope.Close(Integer::New(dst - start));
+  return scope.Close(Integer::New(written));
 }
 
 
@@ -753,6 +1082,24 @@ Handle<Value> Buffer::MakeFastBuffer(const Arguments &args) {
 }
 
 
+// SlowBuffer.makeShared(backing), JS side of NewShared(), lets the tests
+// check what createSharedBuffer() hands to modules
+Handle<Value> Buffer::MakeShared(const Arguments &args) {
+  HandleScope scope;
+
+  Buffer *buffer = NULL;
+  if (args[0]->IsObject()) {
+    buffer = NewShared(args[0]->ToObject());
+  }
+  if (!buffer) {
+    return ThrowException(Exception::TypeError(String::New(
+            "First argument must have external array data")));
+  }
+
+  return scope.Close(buffer->handle_);
+}
+
+
 bool Buffer::HasInstance(v8::Handle<v8::Value> val) {
   if (!val->IsObject()) return false;
   v8::Local<v8::Object> obj = val->ToObject();
@@ -768,6 +1115,26 @@ bool Buffer::HasInstance(v8::Handle<v8::Value> val) {
 }
 
 
+Handle<Value> Buffer::Utf8Stats(const Arguments &args) {
+  HandleScope scope;
+  Local<Object> slice = Object::New();
+  slice->Set(String::NewSymbol("ascii"), Integer::NewFromUnsigned(s_utf8Stats.sliceAscii));
+  slice->Set(String::NewSymbol("external"), Integer::NewFromUnsigned(s_utf8Stats.sliceExternal));
+  slice->Set(String::NewSymbol("decoded"), Integer::NewFromUnsigned(s_utf8Stats.sliceDecoded));
+  slice->Set(String::NewSymbol("fallback"), Integer::NewFromUnsigned(s_utf8Stats.sliceFallback));
+
+  Local<Object> write = Object::New();
+  write->Set(String::NewSymbol("ascii"), Integer::NewFromUnsigned(s_utf8Stats.writeAscii));
+  write->Set(String::NewSymbol("mixed"), Integer::NewFromUnsigned(s_utf8Stats.writeMixed));
+
+  Local<Object> o = Object::New();
+  o->Set(String::NewSymbol("impl"), String::New(utf8_impl()));
+  o->Set(String::NewSymbol("slice"), slice);
+  o->Set(String::NewSymbol("write"), write);
+  return scope.Close(o);
+}
+
+
 void Buffer::Initialize(Handle<Object> target) {
   HandleScope scope;
 
@@ -790,6 +1157,7 @@ void Buffer::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "asciiSlice", Buffer::AsciiSlice);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "base64Slice", Buffer::Base64Slice);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "ucs2Slice", Buffer::Ucs2Slice);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "hexSlice", Buffer::HexSlice);
   // TODO NODE_SET_PROTOTYPE_METHOD(t, "utf16Slice", Utf16Slice);
   // copy
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "utf8Slice", Buffer::Utf8Slice);
@@ -799,8 +1167,32 @@ void Buffer::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "binaryWrite", Buffer::BinaryWrite);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "base64Write", Buffer::Base64Write);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "ucs2Write", Buffer::Ucs2Write);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "hexWrite", Buffer::HexWrite);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "fill", Buffer::Fill);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "copy", Buffer::Copy);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "indexOf", Buffer::IndexOf);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "lastIndexOf", Buffer::LastIndexOf);
+
+  // internal, lib/buffer.js checks the arguments of the Buffer accessors and
+  // passes the byte order on as a bool
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_readUInt8", Buffer::ReadNumber<uint8_t>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_readInt8", Buffer::ReadNumber<int8_t>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_readUInt16", Buffer::ReadNumber<uint16_t>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_readInt16", Buffer::ReadNumber<int16_t>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_readUInt32", Buffer::ReadNumber<uint32_t>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_readInt32", Buffer::ReadNumber<int32_t>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_readFloat", Buffer::ReadNumber<float>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_readDouble", Buffer::ReadNumber<double>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_writeUInt8", Buffer::WriteNumber<uint8_t>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_writeInt8", Buffer::WriteNumber<int8_t>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_writeUInt16", Buffer::WriteNumber<uint16_t>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_writeInt16", Buffer::WriteNumber<int16_t>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_writeUInt32", Buffer::WriteNumber<uint32_t>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_writeInt32", Buffer::WriteNumber<int32_t>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_writeFloat", Buffer::WriteNumber<float>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_writeDouble", Buffer::WriteNumber<double>);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_readValues", Buffer::ReadValues);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "_writeValues", Buffer::WriteValues);
 
   NODE_SET_METHOD(constructor_template->GetFunction(),
                   "byteLength",
@@ -808,6 +1200,9 @@ void Buffer::Initialize(Handle<Object> target) {
   NODE_SET_METHOD(constructor_template->GetFunction(),
                   "makeFastBuffer",
                   Buffer::MakeFastBuffer);
+  NODE_SET_METHOD(constructor_template->GetFunction(),
+                  "makeShared",
+                  Buffer::MakeShared);
 
   target->Set(String::NewSymbol("SlowBuffer"), constructor_template->GetFunction());
 }
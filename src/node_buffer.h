@@ -29,6 +29,8 @@
 
 namespace node {
 
+class SlabHeap;
+
 /* A buffer is a chunk of memory stored outside the V8 heap, mirrored by an
  * object in javascript. The object is not totally opaque, one can access
  * individual bytes with [] and slice it into substrings or sub-buffers
@@ -93,11 +95,23 @@ class Buffer : public ObjectWrap {
   static v8::Handle<v8::Object> New(v8::Handle<v8::String> string);
 
   static void Initialize(v8::Handle<v8::Object> target);
+
+  // String of the UTF-8 data, through the ASCII and SIMD decoding paths
+  // of toString('utf8')
+  static v8::Local<v8::String> Utf8String(const char *data, size_t length);
+
+  // JS API - process.utf8Stats(), hits of the utf8 fast paths
+  static v8::Handle<v8::Value> Utf8Stats(const v8::Arguments &args);
+
   static Buffer* New(size_t length); // public constructor
   static Buffer* New(char *data, size_t len); // public constructor
   static Buffer* New(char *data, size_t length,
                      free_callback callback, void *hint); // public constructor
 
+  // Buffer on the external array data of backing, which it keeps alive.
+  // NULL if backing has none
+  static Buffer* NewShared(v8::Handle<v8::Object> backing);
+
   private:
   static v8::Persistent<v8::FunctionTemplate> constructor_template;
 
@@ -107,21 +121,34 @@ class Buffer : public ObjectWrap {
   static v8::Handle<v8::Value> Base64Slice(const v8::Arguments &args);
   static v8::Handle<v8::Value> Utf8Slice(const v8::Arguments &args);
   static v8::Handle<v8::Value> Ucs2Slice(const v8::Arguments &args);
+  static v8::Handle<v8::Value> HexSlice(const v8::Arguments &args);
   static v8::Handle<v8::Value> BinaryWrite(const v8::Arguments &args);
   static v8::Handle<v8::Value> Base64Write(const v8::Arguments &args);
   static v8::Handle<v8::Value> AsciiWrite(const v8::Arguments &args);
   static v8::Handle<v8::Value> Utf8Write(const v8::Arguments &args);
   static v8::Handle<v8::Value> Ucs2Write(const v8::Arguments &args);
+  static v8::Handle<v8::Value> HexWrite(const v8::Arguments &args);
   static v8::Handle<v8::Value> ByteLength(const v8::Arguments &args);
   static v8::Handle<v8::Value> MakeFastBuffer(const v8::Arguments &args);
+  static v8::Handle<v8::Value> MakeShared(const v8::Arguments &args);
   static v8::Handle<v8::Value> Fill(const v8::Arguments &args);
   static v8::Handle<v8::Value> Copy(const v8::Arguments &args);
+  static v8::Handle<v8::Value> IndexOf(const v8::Arguments &args);
+  static v8::Handle<v8::Value> LastIndexOf(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Search(const v8::Arguments &args, bool forward);
+  template <typename T>
+  static v8::Handle<v8::Value> ReadNumber(const v8::Arguments &args);
+  template <typename T>
+  static v8::Handle<v8::Value> WriteNumber(const v8::Arguments &args);
+  static v8::Handle<v8::Value> ReadValues(const v8::Arguments &args);
+  static v8::Handle<v8::Value> WriteValues(const v8::Arguments &args);
 
   Buffer(v8::Handle<v8::Object> wrapper, size_t length);
   void Replace(char *data, size_t length, free_callback callback, void *hint);
 
   size_t length_;
   char* data_;
+  SlabHeap* slab_; // data_ comes from this heap, NULL for new[]
   free_callback callback_;
   void* callback_hint_;
 };
@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <node.h>
+#include <node_compile_cache.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace node {
+
+using namespace v8;
+
+// smaller sources compile faster than the file round trip
+#define COMPILE_CACHE_MIN_SOURCE 1024
+#define COMPILE_CACHE_MAGIC 0x4e504443  // 'NPDC'
+// eio priority of the writes, fs.PRIORITY_BACKGROUND
+#define COMPILE_CACHE_PRIORITY -2
+
+struct CompileCacheHeader {
+  unsigned int magic;
+  int length;
+  unsigned long long hash;
+};
+
+bool CompileCache::s_enabled = false;
+std::string CompileCache::s_dir;
+size_t CompileCache::s_limit = 0;
+size_t CompileCache::s_size = 0;
+unsigned int CompileCache::s_hits = 0;
+unsigned int CompileCache::s_misses = 0;
+unsigned int CompileCache::s_errors = 0;
+unsigned int CompileCache::s_evicted = 0;
+
+// entries on disk by path, most recently used first
+struct CompileCacheEntry {
+  std::string path;
+  size_t size;
+};
+typedef std::list<CompileCacheEntry> CompileCacheLRU;
+static CompileCacheLRU s_lru;
+static std::map<std::string, CompileCacheLRU::iterator> s_entries;
+
+void CompileCache::Initialize(const std::string& dir, bool enabled, size_t limit) {
+  s_dir = dir;
+  s_enabled = enabled;
+  s_limit = limit;
+  if (s_enabled && mkdir(s_dir.c_str(), 0700) && errno != EEXIST) {
+    NODE_LOGW("%s, unable to create %s (%s), compile cache disabled",
+        __FUNCTION__, s_dir.c_str(), strerror(errno));
+    s_enabled = false;
+  }
+  if (s_enabled) {
+    Scan();
+  }
+  NODE_LOGI("%s, compile cache(%s) dir(%s) size(%u/%uKB) entries(%u)", __FUNCTION__,
+      s_enabled ? "ENABLED" : "DISABLED", s_dir.c_str(), (unsigned int) (s_size / 1024),
+      (unsigned int) (s_limit / 1024), (unsigned int) s_entries.size());
+}
+
+static bool OlderEntry(const std::pair<time_t, CompileCacheEntry>& a,
+    const std::pair<time_t, CompileCacheEntry>& b) {
+  return a.first < b.first;
+}
+
+// Indexes the entries left by earlier runs, the file mtime being their last
+// use. Entries of another V8 version and temporaries of an interrupted
+// Store are deleted, then the cache is trimmed to the limit
+void CompileCache::Scan() {
+  DIR* dir = opendir(s_dir.c_str());
+  if (!dir) {
+    return;
+  }
+
+  std::string suffix = std::string(".v8-") + V8::GetVersion();
+  std::vector<std::pair<time_t, CompileCacheEntry> > found;
+  unsigned int stale = 0;
+  struct dirent* ent;
+  while ((ent = readdir(dir))) {
+    std::string name = ent->d_name;
+    if (name == "." || name == "..") {
+      continue;
+    }
+
+    CompileCacheEntry entry = { s_dir + "/" + name, 0 };
+    struct stat st;
+    if (name.size() <= suffix.size() ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) ||
+        stat(entry.path.c_str(), &st) || !S_ISREG(st.st_mode)) {
+      unlink(entry.path.c_str());
+      stale++;
+      continue;
+    }
+    entry.size = st.st_size;
+    found.push_back(std::make_pair(st.st_mtime, entry));
+  }
+  closedir(dir);
+
+  std::sort(found.begin(), found.end(), OlderEntry);
+  for (size_t i = 0; i < found.size(); i++) {
+    Touch(found[i].second.path, found[i].second.size);
+  }
+  if (stale) {
+    NODE_LOGI("%s, removed %u stale entries", __FUNCTION__, stale);
+  }
+  Evict();
+}
+
+// marks path as the most recently used entry
+void CompileCache::Touch(const std::string& path, size_t size) {
+  std::map<std::string, CompileCacheLRU::iterator>::iterator it = s_entries.find(path);
+  if (it != s_entries.end()) {
+    s_size -= it->second->size;
+    s_lru.erase(it->second);
+  }
+  CompileCacheEntry entry = { path, size };
+  s_lru.push_front(entry);
+  s_entries[path] = s_lru.begin();
+  s_size += size;
+}
+
+void CompileCache::Forget(const std::string& path) {
+  std::map<std::string, CompileCacheLRU::iterator>::iterator it = s_entries.find(path);
+  if (it != s_entries.end()) {
+    s_size -= it->second->size;
+    s_lru.erase(it->second);
+    s_entries.erase(it);
+  }
+}
+
+// drops the least recently used entries until the cache fits the limit
+void CompileCache::Evict() {
+  while (s_size > s_limit && !s_lru.empty()) {
+    std::string path = s_lru.back().path;
+    NODE_LOGV("%s, evicting %s", __FUNCTION__, path.c_str());
+    unlink(path.c_str());
+    Forget(path);
+    s_evicted++;
+  }
+}
+
+// 64 bit FNV-1a over the UTF-16 source
+std::string CompileCache::Path(Handle<String> source, unsigned long long* hash) {
+  String::Value value(source);
+  const uint16_t* chars = *value;
+  unsigned long long h = 14695981039346656037ULL;
+  for (int i = 0; i < value.length(); i++) {
+    h ^= chars[i];
+    h *= 1099511628211ULL;
+  }
+  *hash = h;
+
+  char name[64];
+  snprintf(name, sizeof(name), "/%016llx-%d.v8-", h, value.length());
+  return s_dir + name + V8::GetVersion();
+}
+
+ScriptData* CompileCache::Load(const std::string& path, unsigned long long hash, int length) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    Forget(path);
+    return NULL;
+  }
+
+  ScriptData* data = NULL;
+  struct stat st;
+  CompileCacheHeader header;
+  if (!fstat(fd, &st) && st.st_size > (off_t) sizeof(header) &&
+      read(fd, &header, sizeof(header)) == sizeof(header) &&
+      header.magic == COMPILE_CACHE_MAGIC && header.hash == hash && header.length == length) {
+    int size = st.st_size - sizeof(header);
+    char* buf = new char[size];
+    if (read(fd, buf, size) == size) {
+      data = ScriptData::New(buf, size);
+      if (data->HasError()) {
+        delete data;
+        data = NULL;
+      }
+    }
+    delete[] buf;
+  }
+  close(fd);
+
+  if (!data) {
+    // corrupt or written for another source with the same hash and length
+    NODE_LOGW("%s, dropping invalid entry %s", __FUNCTION__, path.c_str());
+    unlink(path.c_str());
+    Forget(path);
+    s_errors++;
+    return NULL;
+  }
+
+  // the mtime keeps the use order across runs
+  utimes(path.c_str(), NULL);
+  Touch(path, st.st_size);
+  return data;
+}
+
+// A Store in flight on the eio thread pool
+struct CompileCacheWrite {
+  std::string path;
+  std::string tmp;
+  CompileCacheHeader header;
+  char* data;
+  int size;
+  int error;
+};
+
+// paths being written, a source compiled again meanwhile isn't stored twice
+static std::set<std::string> s_writing;
+static unsigned int s_tmpSerial = 0;
+
+// 0 or the error, a short write leaves errno alone and counts as EIO
+static int WriteAll(int fd, const void* data, size_t size) {
+  ssize_t written = write(fd, data, size);
+  if (written < 0) {
+    return errno;
+  }
+  return (size_t) written == size ? 0 : EIO;
+}
+
+// thread pool, written to a temporary and renamed, a crash never leaves a
+// torn entry (Scan() deletes the temporary)
+static int StoreWork(eio_req* req) {
+  CompileCacheWrite* w = static_cast<CompileCacheWrite*>(req->data);
+  int fd = open(w->tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) {
+    w->error = errno;
+    return 0;
+  }
+
+  w->error = WriteAll(fd, &w->header, sizeof(w->header));
+  if (!w->error) {
+    w->error = WriteAll(fd, w->data, w->size);
+  }
+  close(fd);
+
+  if (!w->error && rename(w->tmp.c_str(), w->path.c_str())) {
+    w->error = errno;
+  }
+  if (w->error) {
+    unlink(w->tmp.c_str());
+  }
+  return 0;
+}
+
+int CompileCache::AfterStore(eio_req* req) {
+  ev_unref(EV_DEFAULT_UC);
+  CompileCacheWrite* w = static_cast<CompileCacheWrite*>(req->data);
+  s_writing.erase(w->path);
+
+  if (w->error) {
+    NODE_LOGW("%s, unable to write %s (%s)", __FUNCTION__, w->path.c_str(), strerror(w->error));
+    s_errors++;
+  } else if (s_enabled) {
+    Touch(w->path, sizeof(w->header) + w->size);
+    Evict();
+  }
+
+  delete[] w->data;
+  delete w;
+  return 0;
+}
+
+// The entry is written on the thread pool at fs.PRIORITY_BACKGROUND, so the
+// file I/O of the pages goes first. data is copied, the caller keeps it
+void CompileCache::Store(const std::string& path, unsigned long long hash, int length,
+    ScriptData* data) {
+  if (!s_writing.insert(path).second) {
+    return;
+  }
+
+  char serial[16];
+  snprintf(serial, sizeof(serial), ".tmp%u", s_tmpSerial++);
+  CompileCacheWrite* w = new CompileCacheWrite();
+  w->path = path;
+  w->tmp = path + serial;
+  CompileCacheHeader header = { COMPILE_CACHE_MAGIC, length, hash };
+  w->header = header;
+  w->size = data->Length();
+  w->data = new char[w->size];
+  memcpy(w->data, data->Data(), w->size);
+
+  eio_custom(StoreWork, COMPILE_CACHE_PRIORITY, AfterStore, w);
+
+  // keeps the loop alive until the entry is written, as GetAddrInfo does
+  ev_ref(EV_DEFAULT_UC);
+}
+
+ScriptData* CompileCache::Get(Handle<String> source) {
+  if (!s_enabled || source->Length() < COMPILE_CACHE_MIN_SOURCE) {
+    return NULL;
+  }
+
+  unsigned long long hash;
+  std::string path = Path(source, &hash);
+  ScriptData* data = Load(path, hash, source->Length());
+  if (data) {
+    s_hits++;
+    return data;
+  }
+
+  s_misses++;
+  data = ScriptData::PreCompile(source);
+  if (!data || data->HasError()) {
+    // let the real compile report the syntax error
+    delete data;
+    return NULL;
+  }
+  Store(path, hash, source->Length(), data);
+  return data;
+}
+
+Handle<Value> CompileCache::Stats(const Arguments& args) {
+  HandleScope scope;
+  Local<Object> stats = Object::New();
+  stats->Set(String::NewSymbol("enabled"), Boolean::New(s_enabled));
+  stats->Set(String::NewSymbol("hits"), Integer::NewFromUnsigned(s_hits));
+  stats->Set(String::NewSymbol("misses"), Integer::NewFromUnsigned(s_misses));
+  stats->Set(String::NewSymbol("errors"), Integer::NewFromUnsigned(s_errors));
+  stats->Set(String::NewSymbol("entries"), Integer::NewFromUnsigned(s_entries.size()));
+  stats->Set(String::NewSymbol("size"), Number::New(s_size));
+  stats->Set(String::NewSymbol("limit"), Number::New(s_limit));
+  stats->Set(String::NewSymbol("evicted"), Integer::NewFromUnsigned(s_evicted));
+  stats->Set(String::NewSymbol("writing"), Integer::NewFromUnsigned(s_writing.size()));
+  return scope.Close(stats);
+}
+
+}  // namespace node
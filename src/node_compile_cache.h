@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NODE_COMPILE_CACHE_H_
+#define NODE_COMPILE_CACHE_H_
+
+#include <v8.h>
+#include <eio.h>
+#include <string>
+
+namespace node {
+
+/**
+ * Disk backed cache of V8 preparse data for script sources, used for the
+ * natives and for the module wrapper compile (downloaded proteus modules).
+ *
+ * Entries live in <moduleRootPath>/.compile-cache, one file per source,
+ * named after a hash of the source and the V8 version so an engine upgrade
+ * never picks up stale data. Entries of other V8 versions are deleted on
+ * startup, and the least recently used ones once the cache outgrows its
+ * limit. All calls are made on the main (V8) thread, new entries are
+ * written out on the eio thread pool at background priority.
+ */
+class CompileCache {
+  public:
+    // dir is created if missing, the cache stays disabled if that fails.
+    // limit is the total size of the entries in bytes
+    static void Initialize(const std::string& dir, bool enabled, size_t limit);
+
+    // Returns the preparse data for source, read from disk or precompiled
+    // and stored on a miss. NULL when disabled or the source is too small to
+    // be worth it. The caller owns the returned data and may delete it as
+    // soon as the script is compiled.
+    static v8::ScriptData* Get(v8::Handle<v8::String> source);
+
+    // JS API - process.compileCacheStats()
+    static v8::Handle<v8::Value> Stats(const v8::Arguments& args);
+
+    static unsigned int s_hits;
+    static unsigned int s_misses;
+    static unsigned int s_errors;
+    static unsigned int s_evicted;
+
+  private:
+    static std::string Path(v8::Handle<v8::String> source, unsigned long long* hash);
+    static v8::ScriptData* Load(const std::string& path, unsigned long long hash, int length);
+    static void Store(const std::string& path, unsigned long long hash, int length,
+        v8::ScriptData* data);
+    static int AfterStore(eio_req* req);
+
+    static void Scan();
+    static void Touch(const std::string& path, size_t size);
+    static void Forget(const std::string& path);
+    static void Evict();
+
+    static bool s_enabled;
+    static std::string s_dir;
+    static size_t s_limit;
+    static size_t s_size;
+};
+
+}  // namespace node
+
+#endif  // NODE_COMPILE_CACHE_H_
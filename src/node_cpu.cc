@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <node_cpu.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#if defined(__arm__)
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+
+namespace node {
+
+#if defined(__i386__) || defined(__x86_64__)
+static unsigned int cpuid_edx, cpuid_ecx;
+
+static void ReadCpuid() {
+  static bool read;
+  if (!read) {
+    unsigned int eax, ebx;
+    __get_cpuid(1, &eax, &ebx, &cpuid_ecx, &cpuid_edx);
+    read = true;
+  }
+}
+#endif
+
+bool cpu_has_sse2() {
+#if defined(__x86_64__)
+  return true;
+#elif defined(__i386__)
+  ReadCpuid();
+  return cpuid_edx & bit_SSE2;
+#else
+  return false;
+#endif
+}
+
+bool cpu_has_ssse3() {
+#if defined(__i386__) || defined(__x86_64__)
+  ReadCpuid();
+  return cpuid_ecx & bit_SSSE3;
+#else
+  return false;
+#endif
+}
+
+bool cpu_has_neon() {
+#if defined(__aarch64__)
+  return true;
+#elif defined(__arm__)
+  static int neon = -1;
+  if (neon >= 0) {
+    return neon;
+  }
+
+  // bionic has no getauxval, read the hwcaps from the aux vector
+  neon = 0;
+  int fd = open("/proc/self/auxv", O_RDONLY);
+  if (fd >= 0) {
+    Elf32_auxv_t aux;
+    while (read(fd, &aux, sizeof(aux)) == sizeof(aux) && aux.a_type != AT_NULL) {
+      if (aux.a_type == AT_HWCAP) {
+        neon = (aux.a_un.a_val & HWCAP_NEON) != 0;
+        break;
+      }
+    }
+    close(fd);
+  }
+  return neon;
+#else
+  return false;
+#endif
+}
+
+bool cpu_simd_enabled() {
+  const char *simd = getenv("NODE_SIMD");
+  return !simd || strcmp(simd, "0");
+}
+
+}  // namespace node
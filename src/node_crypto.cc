@@ -25,6 +25,7 @@
 
 #include <node.h>
 #include <node_buffer.h>
+#include <node_hex.h>
 #include <node_root_certs.h>
 
 #include <string.h>
@@ -1345,9 +1346,8 @@ static void HexEncode(unsigned char *md_value,
                       int* md_hex_len) {
   *md_hex_len = (2*(md_len));
   *md_hexdigest = new char[*md_hex_len + 1];
-  for (int i = 0; i < md_len; i++) {
-    snprintf((char *)(*md_hexdigest + (i*2)), 3, "%02x",  md_value[i]);
-  }
+  hex_encode((const char*) md_value, md_len, *md_hexdigest);
+  (*md_hexdigest)[*md_hex_len] = 0;
 }
 
 #define hex2i(c) ((c) <= '9' ? ((c) - '0') : (c) <= 'Z' ? ((c) - 'A' + 10) \
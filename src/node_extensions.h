@@ -40,6 +40,7 @@ NODE_EXT_LIST_ITEM(node_signal_watcher)
 #endif
 NODE_EXT_LIST_ITEM(node_stdio)
 NODE_EXT_LIST_ITEM(node_os)
+NODE_EXT_LIST_ITEM(node_string_decoder)
 
 // libuv rewrite
 NODE_EXT_LIST_ITEM(node_timer_wrap)
@@ -95,7 +95,7 @@ static inline bool SetCloseOnExec(int fd) {
  */
 class FileNodeModule : public ObjectWrap, public NodeModule {
   public:
-    FileNodeModule(Node *node) : m_node(node) {}
+    FileNodeModule(Node *node) : m_node(node), m_priority(EIO_PRI_DEFAULT) {}
     ~FileNodeModule() { NODE_LOGD("~FileNodeModule(%p)", this); release(); }
 
     Node *node() { return m_node; }
@@ -104,8 +104,14 @@ class FileNodeModule : public ObjectWrap, public NodeModule {
     ModuleId Module() { return MODULE_FS; }
     void release();
 
+    // eio priority of the async requests of this node, the eio workers pick
+    // higher priority requests first (e.g. page I/O over module updates)
+    int priority() { return m_priority; }
+    void setPriority(int priority) { m_priority = priority; }
+
   private:
     Node *m_node;
+    int m_priority;
     vector<eio_req*> m_eio_list;
     void erase_(eio_req* req);
 };
@@ -315,7 +321,7 @@ static int After(eio_req *req) {
   Handle<Object> moduleObject = args.Holder()->ToObject(); \
   FileNodeModule *module = static_cast<FileNodeModule *>(moduleObject->GetPointerFromInternalField(1)); \
   EioData *eio_data = new EioData(callback, module); \
-  eio_req *req = eio_##func(__VA_ARGS__, EIO_PRI_DEFAULT, After, eio_data); \
+  eio_req *req = eio_##func(__VA_ARGS__, module->priority(), After, eio_data); \
   NODE_LOGM("eio request (%p)", req); \
   eio_data->set_eio_req(req);           \
   assert(req);                                                    \
@@ -339,6 +345,31 @@ static Handle<Value> Release(const Arguments& args) {
 }
 
 
+// proteus: setPriority(priority), sets the eio priority of the async requests
+// issued from now on, clamped to [EIO_PRI_MIN, EIO_PRI_MAX]. Returns the
+// previous one
+static Handle<Value> SetPriority(const Arguments& args) {
+  HandleScope scope;
+
+  Handle<Object> moduleObject = args.Holder()->ToObject();
+  FileNodeModule *module =
+    static_cast<FileNodeModule *>(moduleObject->GetPointerFromInternalField(1));
+  NODE_ASSERT(module);
+
+  if (args.Length() < 1 || !args[0]->IsInt32()) {
+    return THROW_BAD_ARGS;
+  }
+
+  int priority = args[0]->Int32Value();
+  priority = priority < EIO_PRI_MIN ? EIO_PRI_MIN : priority;
+  priority = priority > EIO_PRI_MAX ? EIO_PRI_MAX : priority;
+
+  int previous = module->priority();
+  module->setPriority(priority);
+  return scope.Close(Integer::New(previous));
+}
+
+
 static Handle<Value> Close(const Arguments& args) {
   HandleScope scope;
 
@@ -1143,6 +1174,7 @@ void File::Initialize(Handle<Object> target) {
   // proteus: add release api, to be called on process.exit event
   // this should cleanup all the watchers that this module started..
   NODE_SET_METHOD(target, "release", Release);
+  NODE_SET_METHOD(target, "setPriority", SetPriority);
 
   if (errno_symbol.IsEmpty()) {
     errno_symbol = NODE_PSYMBOL("errno");
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <node_hex.h>
+#include <node_cpu.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define NODE_HEX_SSE2
+#endif
+
+namespace node {
+
+static const char hex_table[] = "0123456789abcdef";
+
+static inline int unhex(uint16_t c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+
+// no blocks, hex_encode/hex_decode do it all
+static size_t scalar_encode(const uint8_t *src, size_t len, char *dst) {
+  return 0;
+}
+
+static size_t scalar_decode(const uint16_t *src, size_t len, uint8_t *dst) {
+  return 0;
+}
+
+static const HexKernels s_scalar = { "scalar", scalar_encode, scalar_decode };
+
+
+#ifdef NODE_HEX_SSE2
+
+#define SSE2 __attribute__((target("sse2")))
+
+// nibbles to digits
+SSE2 static inline __m128i encode_translate(__m128i v) {
+  __m128i letter = _mm_cmpgt_epi8(v, _mm_set1_epi8(9));
+  return _mm_add_epi8(_mm_add_epi8(v, _mm_set1_epi8('0')),
+                      _mm_and_si128(letter, _mm_set1_epi8('a' - '0' - 10)));
+}
+
+// 16 bytes per 32 digits
+SSE2 static size_t sse2_encode(const uint8_t *src, size_t len, char *dst) {
+  const uint8_t *start = src;
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  while (len >= 16) {
+    __m128i in = _mm_loadu_si128((const __m128i*) src);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 4), nibble);
+    __m128i lo = _mm_and_si128(in, nibble);
+    _mm_storeu_si128((__m128i*) dst, encode_translate(_mm_unpacklo_epi8(hi, lo)));
+    _mm_storeu_si128((__m128i*) (dst + 16), encode_translate(_mm_unpackhi_epi8(hi, lo)));
+    src += 16;
+    dst += 32;
+    len -= 16;
+  }
+  return src - start;
+}
+
+SSE2 static inline __m128i in_range(__m128i c, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(lo - 1)),
+                       _mm_cmplt_epi8(c, _mm_set1_epi8(hi + 1)));
+}
+
+// 16 digits to nibbles, bad collects the non digits
+SSE2 static inline __m128i decode_translate(__m128i c, __m128i &bad) {
+  __m128i digit = in_range(c, '0', '9');
+  __m128i lower = in_range(c, 'a', 'f');
+  __m128i upper = in_range(c, 'A', 'F');
+  bad = _mm_or_si128(bad, _mm_andnot_si128(_mm_or_si128(digit, _mm_or_si128(lower, upper)),
+                                           _mm_set1_epi8(-1)));
+
+  __m128i v = _mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0')));
+  v = _mm_or_si128(v, _mm_and_si128(lower, _mm_sub_epi8(c, _mm_set1_epi8('a' - 10))));
+  v = _mm_or_si128(v, _mm_and_si128(upper, _mm_sub_epi8(c, _mm_set1_epi8('A' - 10))));
+  // the pair of a byte is in one 16 bit lane, high nibble first
+  return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0xff)), 4),
+                      _mm_srli_epi16(v, 8));
+}
+
+// 32 digits per 16 bytes. The characters are narrowed with saturation,
+// anything past latin1 becomes 0xff and fails the digit ranges
+SSE2 static size_t sse2_decode(const uint16_t *src, size_t len, uint8_t *dst) {
+  const uint16_t *start = src;
+  while (len >= 32) {
+    const __m128i *in = (const __m128i*) src;
+    __m128i c0 = _mm_packus_epi16(_mm_loadu_si128(in), _mm_loadu_si128(in + 1));
+    __m128i c1 = _mm_packus_epi16(_mm_loadu_si128(in + 2), _mm_loadu_si128(in + 3));
+    __m128i bad = _mm_setzero_si128();
+    __m128i b0 = decode_translate(c0, bad);
+    __m128i b1 = decode_translate(c1, bad);
+    if (_mm_movemask_epi8(bad)) {
+      break;
+    }
+    _mm_storeu_si128((__m128i*) dst, _mm_packus_epi16(b0, b1));
+    src += 32;
+    dst += 16;
+    len -= 32;
+  }
+  return src - start;
+}
+
+static const HexKernels s_sse2 = { "sse2", sse2_encode, sse2_decode };
+
+#undef SSE2
+
+#endif  // NODE_HEX_SSE2
+
+
+static const HexKernels *s_kernels;
+
+// Picked once, racing threads pick the same kernels
+static const HexKernels* Kernels() {
+  if (s_kernels) {
+    return s_kernels;
+  }
+
+  const HexKernels *kernels = &s_scalar;
+  if (cpu_simd_enabled()) {
+#ifdef NODE_HEX_SSE2
+    if (cpu_has_sse2()) {
+      kernels = &s_sse2;
+    }
+#endif
+    if (hex_neon_kernels()) {
+      kernels = hex_neon_kernels();
+    }
+  }
+  s_kernels = kernels;
+  return s_kernels;
+}
+
+const char* hex_impl() {
+  return Kernels()->name;
+}
+
+
+void hex_encode(const char *src, size_t len, char *dst) {
+  const uint8_t *in = (const uint8_t*) src;
+  size_t done = Kernels()->encode(in, len, dst);
+  dst += done * 2;
+  for (size_t i = done; i < len; i++) {
+    *dst++ = hex_table[in[i] >> 4];
+    *dst++ = hex_table[in[i] & 0x0f];
+  }
+}
+
+
+size_t hex_decode(const uint16_t *src, size_t len, char *dst) {
+  size_t done = Kernels()->decode(src, len, (uint8_t*) dst);
+  char *out = dst + done / 2;
+  for (size_t i = done; i + 1 < len; i += 2) {
+    int hi = unhex(src[i]);
+    int lo = unhex(src[i + 1]);
+    if (hi < 0 || lo < 0) {
+      break;
+    }
+    *out++ = (hi << 4) | lo;
+  }
+  return out - dst;
+}
+
+
+ssize_t hex_decode(v8::Handle<v8::String> string, char *dst, size_t max_length) {
+  // copied out of v8 a chunk at a time
+  uint16_t chars[1024];
+  size_t len = string->Length() / 2;
+  if (len > max_length) {
+    len = max_length;
+  }
+  len *= 2;
+
+  size_t written = 0;
+  for (size_t pos = 0; pos < len; pos += sizeof(chars) / sizeof(chars[0])) {
+    size_t chunk = len - pos;
+    if (chunk > sizeof(chars) / sizeof(chars[0])) {
+      chunk = sizeof(chars) / sizeof(chars[0]);
+    }
+    string->Write(chars, pos, chunk, v8::String::HINT_MANY_WRITES_EXPECTED);
+    size_t decoded = hex_decode(chars, chunk, dst + written);
+    written += decoded;
+    if (decoded < chunk / 2) {
+      return -1;
+    }
+  }
+  return written;
+}
+
+}  // namespace node
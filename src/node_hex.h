@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NODE_HEX_H_
+#define NODE_HEX_H_
+
+#include <v8.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace node {
+
+/**
+ * Vectorized kernels, whole blocks only, returning the number of input
+ * bytes (encode) or characters (decode) consumed. decode takes the two
+ * byte characters of a v8 string and stops at the first block holding
+ * anything but hex digits.
+ */
+struct HexKernels {
+  const char *name;
+  size_t (*encode)(const uint8_t *src, size_t len, char *dst);
+  size_t (*decode)(const uint16_t *src, size_t len, uint8_t *dst);
+};
+
+// NEON kernels, NULL if the cpu or the build has no NEON
+const HexKernels* hex_neon_kernels();
+
+/**
+ * Encodes len bytes as 2 * len lower case hex digits into dst.
+ */
+void hex_encode(const char *src, size_t len, char *dst);
+
+/**
+ * Decodes pairs of hex digits of either case, len is even. Returns the
+ * bytes written, less than len / 2 if an invalid digit stopped it.
+ */
+size_t hex_decode(const uint16_t *src, size_t len, char *dst);
+
+/**
+ * Decodes the first 2 * max_length characters of string into dst, without
+ * copying the whole string out of v8. Returns the bytes written or -1 for
+ * an invalid digit.
+ */
+ssize_t hex_decode(v8::Handle<v8::String> string, char *dst, size_t max_length);
+
+// name of the kernels in use: "neon", "sse2" or "scalar"
+const char* hex_impl();
+
+}  // namespace node
+
+#endif  // NODE_HEX_H_
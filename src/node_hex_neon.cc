@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Built with NEON enabled on ARM (see Android.libnode.mk), only used once
+// the cpu is known to have it. Empty on other targets.
+
+#include <node_hex.h>
+#include <node_cpu.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+namespace node {
+
+// nibbles to digits
+static inline uint8x16_t encode_translate(uint8x16_t v) {
+  uint8x16_t letter = vcgtq_u8(v, vdupq_n_u8(9));
+  return vaddq_u8(vaddq_u8(v, vdupq_n_u8('0')),
+                  vandq_u8(letter, vdupq_n_u8('a' - '0' - 10)));
+}
+
+// 16 bytes per 32 digits, interleaved by the store
+static size_t neon_encode(const uint8_t *src, size_t len, char *dst) {
+  const uint8_t *start = src;
+  while (len >= 16) {
+    uint8x16_t in = vld1q_u8(src);
+    uint8x16x2_t out;
+    out.val[0] = encode_translate(vshrq_n_u8(in, 4));
+    out.val[1] = encode_translate(vandq_u8(in, vdupq_n_u8(0x0f)));
+    vst2q_u8((uint8_t*) dst, out);
+    src += 16;
+    dst += 32;
+    len -= 16;
+  }
+  return src - start;
+}
+
+static inline uint8x16_t in_range(uint8x16_t c, uint8_t lo, uint8_t hi) {
+  return vandq_u8(vcgeq_u8(c, vdupq_n_u8(lo)), vcleq_u8(c, vdupq_n_u8(hi)));
+}
+
+// digits to nibbles, bad collects the non digits
+static inline uint8x16_t decode_translate(uint8x16_t c, uint8x16_t &bad) {
+  uint8x16_t digit = in_range(c, '0', '9');
+  uint8x16_t lower = in_range(c, 'a', 'f');
+  uint8x16_t upper = in_range(c, 'A', 'F');
+  bad = vorrq_u8(bad, vmvnq_u8(vorrq_u8(digit, vorrq_u8(lower, upper))));
+
+  uint8x16_t v = vandq_u8(digit, vsubq_u8(c, vdupq_n_u8('0')));
+  v = vorrq_u8(v, vandq_u8(lower, vsubq_u8(c, vdupq_n_u8('a' - 10))));
+  v = vorrq_u8(v, vandq_u8(upper, vsubq_u8(c, vdupq_n_u8('A' - 10))));
+  return v;
+}
+
+// 32 digits per 16 bytes, the loads split them into high and low nibbles.
+// The characters are narrowed with saturation, anything past latin1
+// becomes 0xff and fails the digit ranges
+static size_t neon_decode(const uint16_t *src, size_t len, uint8_t *dst) {
+  const uint16_t *start = src;
+  while (len >= 32) {
+    uint16x8x2_t a = vld2q_u16(src);
+    uint16x8x2_t b = vld2q_u16(src + 16);
+    uint8x16_t bad = vdupq_n_u8(0);
+    uint8x16_t hi = decode_translate(vcombine_u8(vqmovn_u16(a.val[0]), vqmovn_u16(b.val[0])), bad);
+    uint8x16_t lo = decode_translate(vcombine_u8(vqmovn_u16(a.val[1]), vqmovn_u16(b.val[1])), bad);
+    uint64x2_t bad64 = vreinterpretq_u64_u8(bad);
+    if (vgetq_lane_u64(bad64, 0) | vgetq_lane_u64(bad64, 1)) {
+      break;
+    }
+    vst1q_u8(dst, vorrq_u8(vshlq_n_u8(hi, 4), lo));
+    src += 32;
+    dst += 16;
+    len -= 32;
+  }
+  return src - start;
+}
+
+static const HexKernels s_neon = { "neon", neon_encode, neon_decode };
+
+const HexKernels* hex_neon_kernels() {
+  return cpu_has_neon() ? &s_neon : NULL;
+}
+
+}  // namespace node
+
+#else
+
+namespace node {
+
+const HexKernels* hex_neon_kernels() {
+  return NULL;
+}
+
+}  // namespace node
+
+#endif
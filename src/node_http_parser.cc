@@ -30,6 +30,10 @@
 #include <strings.h>  /* strcasecmp() */
 #include <string.h>  /* strdup() */
 #include <stdlib.h>  /* free() */
+#include <ctype.h>  /* tolower() */
+
+#include <string>
+#include <vector>
 
 // This is a binding to http_parser (http://github.com/ry/http-parser)
 // The goal is to decouple sockets from parsing for more javascript-level
@@ -41,6 +45,17 @@
 //     ...
 // No copying is performed when slicing the buffer, only small reference
 // allocations.
+//
+// The URL and the headers are the exception: they are collected here, across
+// execute() calls if need be, and handed over in one piece as info.url and
+// info.headers (a flat [field, value, ...] array with lowercased field names)
+// to parser.onHeadersComplete. Messages with more than MAX_HEADER_PAIRS
+// headers, and trailers, get the rest through parser.onHeaders(headers, url).
+// Without onHeaders the pairs past MAX_HEADER_PAIRS are set aside and still
+// arrive with onHeadersComplete.
+// onURL, onHeaderField and onHeaderValue are still called when set.
+
+#define MAX_HEADER_PAIRS 32
 
 
 namespace node {
@@ -55,6 +70,7 @@ static Persistent<String> on_fragment_sym;
 static Persistent<String> on_header_field_sym;
 static Persistent<String> on_header_value_sym;
 static Persistent<String> on_headers_complete_sym;
+static Persistent<String> on_headers_sym;
 static Persistent<String> on_body_sym;
 static Persistent<String> on_message_complete_sym;
 
@@ -90,6 +106,51 @@ static Persistent<String> version_major_sym;
 static Persistent<String> version_minor_sym;
 static Persistent<String> should_keep_alive_sym;
 static Persistent<String> upgrade_sym;
+static Persistent<String> headers_sym;
+static Persistent<String> url_sym;
+
+// Header names common enough to keep around as symbols, so they are neither
+// allocated nor hashed again for every message.
+static const char* common_header_names[] = {
+  "accept",
+  "accept-charset",
+  "accept-encoding",
+  "accept-language",
+  "authorization",
+  "cache-control",
+  "connection",
+  "content-encoding",
+  "content-length",
+  "content-type",
+  "cookie",
+  "date",
+  "etag",
+  "expect",
+  "expires",
+  "host",
+  "if-modified-since",
+  "if-none-match",
+  "keep-alive",
+  "last-modified",
+  "location",
+  "origin",
+  "pragma",
+  "range",
+  "referer",
+  "server",
+  "set-cookie",
+  "transfer-encoding",
+  "upgrade",
+  "user-agent",
+  "vary",
+  "x-forwarded-for",
+  "x-requested-with"
+};
+
+#define COMMON_HEADERS \
+  (sizeof(common_header_names) / sizeof(common_header_names[0]))
+
+static Persistent<String> common_header_syms[COMMON_HEADERS];
 
 static struct http_parser_settings settings;
 
@@ -103,10 +164,10 @@ static size_t current_buffer_len;
 
 
 // Callback prototype for http_cb
-#define DEFINE_HTTP_CB(name)                                             \
+#define DEFINE_HTTP_CB(name, sym)                                        \
   static int name(http_parser *p) {                                      \
     Parser *parser = static_cast<Parser*>(p->data);                      \
-    Local<Value> cb_value = parser->handle_->Get(name##_sym);            \
+    Local<Value> cb_value = parser->handle_->Get(sym);                   \
     if (!cb_value->IsFunction()) return 0;                               \
     Local<Function> cb = Local<Function>::Cast(cb_value);                \
     Local<Value> ret = cb->Call(parser->handle_, 0, NULL);               \
@@ -119,11 +180,11 @@ static size_t current_buffer_len;
   }
 
 // Callback prototype for http_data_cb
-#define DEFINE_HTTP_DATA_CB(name)                                        \
+#define DEFINE_HTTP_DATA_CB(name, sym)                                   \
   static int name(http_parser *p, const char *at, size_t length) {       \
     Parser *parser = static_cast<Parser*>(p->data);                      \
     assert(current_buffer);                                              \
-    Local<Value> cb_value = parser->handle_->Get(name##_sym);            \
+    Local<Value> cb_value = parser->handle_->Get(sym);                   \
     if (!cb_value->IsFunction()) return 0;                               \
     Local<Function> cb = Local<Function>::Cast(cb_value);                \
     Local<Value> argv[3] = { *current_buffer                             \
@@ -181,16 +242,70 @@ class Parser : public ObjectWrap {
   ~Parser() {
   }
 
-  DEFINE_HTTP_CB(on_message_begin)
-  DEFINE_HTTP_CB(on_message_complete)
+  DEFINE_HTTP_CB(message_begin, on_message_begin_sym)
+  DEFINE_HTTP_CB(message_complete, on_message_complete_sym)
+
+  DEFINE_HTTP_DATA_CB(on_path, on_path_sym)
+  DEFINE_HTTP_DATA_CB(url, on_url_sym)
+  DEFINE_HTTP_DATA_CB(on_fragment, on_fragment_sym)
+  DEFINE_HTTP_DATA_CB(on_query_string, on_query_string_sym)
+  DEFINE_HTTP_DATA_CB(header_field, on_header_field_sym)
+  DEFINE_HTTP_DATA_CB(header_value, on_header_value_sym)
+  DEFINE_HTTP_DATA_CB(on_body, on_body_sym)
+
+  static int on_message_begin(http_parser *p) {
+    Parser *parser = static_cast<Parser*>(p->data);
+    parser->url_.clear();
+    parser->spilled_.clear();
+    parser->num_fields_ = parser->num_values_ = 0;
+    return message_begin(p);
+  }
+
+  static int on_url(http_parser *p, const char *at, size_t length) {
+    Parser *parser = static_cast<Parser*>(p->data);
+    parser->url_.append(at, length);
+    return url(p, at, length);
+  }
+
+  static int on_header_field(http_parser *p, const char *at, size_t length) {
+    Parser *parser = static_cast<Parser*>(p->data);
+
+    if (parser->num_fields_ == parser->num_values_) {
+      // a new field
+      if (parser->num_fields_ == MAX_HEADER_PAIRS) {
+        if (!parser->FlushHeaders()) return -1;
+      }
+      parser->fields_[parser->num_fields_++].assign(at, length);
+    } else {
+      // the field continues in this chunk
+      parser->fields_[parser->num_fields_ - 1].append(at, length);
+    }
+
+    return header_field(p, at, length);
+  }
+
+  static int on_header_value(http_parser *p, const char *at, size_t length) {
+    Parser *parser = static_cast<Parser*>(p->data);
+
+    if (parser->num_values_ != parser->num_fields_) {
+      // a new value
+      parser->values_[parser->num_values_++].assign(at, length);
+    } else {
+      // the value continues in this chunk
+      parser->values_[parser->num_values_ - 1].append(at, length);
+    }
+
+    return header_value(p, at, length);
+  }
+
+  static int on_message_complete(http_parser *p) {
+    Parser *parser = static_cast<Parser*>(p->data);
+
+    // trailers
+    if (parser->num_fields_ > 0 && !parser->FlushHeaders()) return -1;
 
-  DEFINE_HTTP_DATA_CB(on_path)
-  DEFINE_HTTP_DATA_CB(on_url)
-  DEFINE_HTTP_DATA_CB(on_fragment)
-  DEFINE_HTTP_DATA_CB(on_query_string)
-  DEFINE_HTTP_DATA_CB(on_header_field)
-  DEFINE_HTTP_DATA_CB(on_header_value)
-  DEFINE_HTTP_DATA_CB(on_body)
+    return message_complete(p);
+  }
 
   static int on_headers_complete(http_parser *p) {
     Parser *parser = static_cast<Parser*>(p->data);
@@ -202,6 +317,12 @@ class Parser : public ObjectWrap {
 
     Local<Object> message_info = Object::New();
 
+    // HEADERS and URL, whatever was not flushed through onHeaders already
+    message_info->Set(headers_sym, parser->CreateHeaders());
+    if (p->type == HTTP_REQUEST) {
+      message_info->Set(url_sym, parser->CreateUrl());
+    }
+
     // METHOD
     if (p->type == HTTP_REQUEST) {
       message_info->Set(method_sym, method_to_str(p->method));
@@ -366,10 +487,110 @@ class Parser : public ObjectWrap {
   void Init (enum http_parser_type type) {
     http_parser_init(&parser_, type);
     parser_.data = this;
+    url_.clear();
+    spilled_.clear();
+    num_fields_ = num_values_ = 0;
+  }
+
+  // Lowercased field name, a symbol for the common ones.
+  static Local<String> FieldName(std::string& field) {
+    for (size_t i = 0; i < field.size(); i++) {
+      field[i] = tolower((unsigned char) field[i]);
+    }
+    for (size_t i = 0; i < COMMON_HEADERS; i++) {
+      const char* name = common_header_names[i];
+      if (field.size() == strlen(name) &&
+          !memcmp(field.data(), name, field.size())) {
+        return Local<String>::New(common_header_syms[i]);
+      }
+    }
+    return String::New(field.data(), field.size());
+  }
+
+  // [field, value, ...] for the pairs collected so far, which are dropped.
+  Local<Array> CreateHeaders() {
+    // a field without a value yet stays for the next round
+    int pairs = num_values_;
+    int spilled = spilled_.size() / 2;
+    Local<Array> headers = Array::New(2 * (spilled + pairs));
+
+    for (int i = 0; i < spilled; i++) {
+      headers->Set(2 * i, FieldName(spilled_[2 * i]));
+      headers->Set(2 * i + 1, String::New(spilled_[2 * i + 1].data(),
+                                          spilled_[2 * i + 1].size()));
+    }
+    spilled_.clear();
+
+    for (int i = 0; i < pairs; i++) {
+      headers->Set(2 * (spilled + i), FieldName(fields_[i]));
+      headers->Set(2 * (spilled + i) + 1,
+                   String::New(values_[i].data(), values_[i].size()));
+    }
+    DropPairs(pairs);
+
+    return headers;
+  }
+
+  // Moves the complete pairs out of fields_ and values_ so collecting can go
+  // on, CreateHeaders() picks them up first.
+  void SpillHeaders() {
+    int pairs = num_values_;
+    for (int i = 0; i < pairs; i++) {
+      spilled_.push_back(std::string());
+      spilled_.back().swap(fields_[i]);
+      spilled_.push_back(std::string());
+      spilled_.back().swap(values_[i]);
+    }
+    DropPairs(pairs);
+  }
+
+  void DropPairs(int pairs) {
+    if (num_fields_ > pairs) {
+      fields_[0].swap(fields_[pairs]);
+      num_fields_ = 1;
+    } else {
+      num_fields_ = 0;
+    }
+    num_values_ = 0;
+  }
+
+  Local<String> CreateUrl() {
+    Local<String> url = String::New(url_.data(), url_.size());
+    url_.clear();
+    return url;
+  }
+
+  // Hands what has been collected to parser.onHeaders(headers, url).
+  bool FlushHeaders() {
+    HandleScope scope;
+
+    Local<Value> cb_value = handle_->Get(on_headers_sym);
+    if (!cb_value->IsFunction()) {
+      // everything goes to onHeadersComplete then, the url stays in url_
+      SpillHeaders();
+      return true;
+    }
+    Local<Function> cb = Local<Function>::Cast(cb_value);
+
+    Local<Value> argv[2] = { CreateHeaders(), CreateUrl() };
+    Local<Value> ret = cb->Call(handle_, 2, argv);
+
+    if (ret.IsEmpty()) {
+      got_exception_ = true;
+      return false;
+    }
+    return true;
   }
 
   bool got_exception_;
   http_parser parser_;
+  std::string url_;
+  // [field, value, ...] set aside by SpillHeaders()
+  std::vector<std::string> spilled_;
+  std::string fields_[MAX_HEADER_PAIRS];
+  std::string values_[MAX_HEADER_PAIRS];
+  int num_fields_;
+  int num_values_;
 };
 
 
@@ -395,6 +616,7 @@ void InitHttpParser(Handle<Object> target) {
     on_header_field_sym     = NODE_PSYMBOL("onHeaderField");
     on_header_value_sym     = NODE_PSYMBOL("onHeaderValue");
     on_headers_complete_sym = NODE_PSYMBOL("onHeadersComplete");
+    on_headers_sym          = NODE_PSYMBOL("onHeaders");
     on_body_sym             = NODE_PSYMBOL("onBody");
     on_message_complete_sym = NODE_PSYMBOL("onMessageComplete");
 
@@ -430,6 +652,12 @@ void InitHttpParser(Handle<Object> target) {
     version_minor_sym = NODE_PSYMBOL("versionMinor");
     should_keep_alive_sym = NODE_PSYMBOL("shouldKeepAlive");
     upgrade_sym = NODE_PSYMBOL("upgrade");
+    headers_sym = NODE_PSYMBOL("headers");
+    url_sym = NODE_PSYMBOL("url");
+
+    for (size_t i = 0; i < COMMON_HEADERS; i++) {
+      common_header_syms[i] = NODE_PSYMBOL(common_header_names[i]);
+    }
   }
 
   settings.on_message_begin    = Parser::on_message_begin;
@@ -34,6 +34,15 @@ Handle<String> MainSource() {
   return BUILTIN_ASCII_ARRAY(node_native, sizeof(node_native)-1);
 }
 
+Handle<String> ModuleSource(const char* id) {
+  for (int i = 0; natives[i].name; i++) {
+    if (natives[i].source != node_native && strcmp(natives[i].name, id) == 0) {
+      return BUILTIN_ASCII_ARRAY(natives[i].source, natives[i].source_len);
+    }
+  }
+  return Handle<String>();
+}
+
 void DefineJavaScript(v8::Handle<v8::Object> target, Node *n) {
   HandleScope scope;
 
@@ -25,5 +25,7 @@ namespace node {
 class Node;
 void DefineJavaScript(v8::Handle<v8::Object> target, Node *n);
 v8::Handle<v8::String> MainSource();
+// source of the builtin module id, empty if there is none
+v8::Handle<v8::String> ModuleSource(const char* id);
 
 }  // namespace node
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NODE_MPSC_QUEUE_H_
+#define NODE_MPSC_QUEUE_H_
+
+#include <stddef.h>
+
+namespace node {
+
+/**
+ * Intrusive, unbounded, multi producer single consumer queue
+ * (Vyukov's algorithm). push() is wait-free and may be called from any
+ * thread, pop() must only ever be called from one (consumer) thread.
+ *
+ * Elements embed an MPSCNode and are handed back as such, the owner
+ * is responsible for the node memory.
+ */
+struct MPSCNode {
+  MPSCNode* volatile next;
+};
+
+class MPSCQueue {
+  public:
+    MPSCQueue() : m_head(&m_stub), m_tail(&m_stub) {
+      m_stub.next = NULL;
+    }
+
+    void push(MPSCNode* n) {
+      n->next = NULL;
+      // release the node contents before publishing it
+      __sync_synchronize();
+      MPSCNode* prev = __sync_lock_test_and_set(&m_head, n);
+      prev->next = n;
+    }
+
+    // Returns NULL when empty, or when a producer is in the middle of a
+    // push, in which case the element will be seen on the next pop().
+    MPSCNode* pop() {
+      MPSCNode* tail = m_tail;
+      MPSCNode* next = tail->next;
+      if (tail == &m_stub) {
+        if (!next) {
+          return NULL;
+        }
+        m_tail = next;
+        tail = next;
+        next = next->next;
+      }
+
+      if (next) {
+        m_tail = next;
+        return tail;
+      }
+
+      if (tail != m_head) {
+        return NULL;
+      }
+
+      push(&m_stub);
+      next = tail->next;
+      if (next) {
+        m_tail = next;
+        return tail;
+      }
+      return NULL;
+    }
+
+    // Only meaningful on the consumer thread
+    bool empty() {
+      return m_tail == &m_stub && !m_stub.next;
+    }
+
+  private:
+    MPSCNode* volatile m_head;
+    MPSCNode* m_tail;
+    MPSCNode m_stub;
+};
+
+}  // namespace node
+
+#endif  // NODE_MPSC_QUEUE_H_
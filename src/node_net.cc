@@ -25,6 +25,7 @@
 #include <node_net.h>
 
 #include <v8.h>
+#include <uv.h>
 
 #include <errno.h>
 #include <string.h>
@@ -51,6 +52,7 @@
 
 #ifdef __linux__
 # include <linux/sockios.h> /* For the SIOCINQ / FIONREAD ioctl */
+# include <sys/syscall.h>
 #endif
 
 /* Non-linux platforms like OS X define this ioctl elsewhere */
@@ -86,6 +88,26 @@
 
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof(*(a)))
 
+// Datagrams moved by one recvmmsg/sendmmsg call at most.
+#define MMSG_MAX 64
+
+// recvmmsg and sendmmsg are called through syscall(), not every libc we
+// build against wraps them. Kernels without them return ENOSYS and we fall
+// back to a recvfrom/sendto loop. Headers can have recvmmsg without
+// sendmmsg, each one is used when it is there.
+#if defined(__linux__) && defined(__NR_recvmmsg)
+# define HAVE_RECVMMSG 1
+#endif
+#if defined(__linux__) && defined(__NR_sendmmsg)
+# define HAVE_SENDMMSG 1
+#endif
+#if defined(HAVE_RECVMMSG) || defined(HAVE_SENDMMSG)
+struct node_mmsghdr {
+  struct msghdr msg_hdr;
+  unsigned int msg_len;
+};
+#endif
+
 
 namespace node {
 
@@ -656,7 +678,7 @@ static Handle<Value> Accept(const Arguments& args) {
   socklen_t len = sizeof(struct sockaddr_storage);
 
 #ifdef __POSIX__
-  int peer_fd = accept(fd, (struct sockaddr*) &address_storage, &len);
+  int peer_fd = uv_accept_fd(fd, (struct sockaddr*) &address_storage, &len);
 
   if (peer_fd < 0) {
     if (errno == EAGAIN) return scope.Close(Null());
@@ -673,17 +695,13 @@ static Handle<Value> Accept(const Arguments& args) {
   }
 
   int peer_fd = _open_osfhandle(peer_handle, 0);
-#endif // __MINGW32__
 
   if (!SetSockFlags(peer_fd)) {
-#ifdef __POSIX__
-    int fcntl_errno = errno;
-#else // __MINGW32__
     int fcntl_errno = WSAGetLastError();
-#endif // __MINGW32__
     close(peer_fd);
     return ThrowException(ErrnoException(fcntl_errno, "fcntl"));
   }
+#endif // __MINGW32__
 
   Local<Object> peer_info = Object::New();
 
@@ -695,6 +713,83 @@ static Handle<Value> Accept(const Arguments& args) {
 }
 
 
+#ifdef __POSIX__
+
+//  var peers = t.acceptMany(fd, max);
+//    peers[i].fd // the accepted connections, as t.accept() returns them
+//    peers.emfile // set when it ran out of file descriptors
+//    peers.pause // set when the listener should stop for a while
+//  Accepts up to max pending connections. Out of file descriptors, the
+//  connections still pending are closed with the fd held in reserve, see
+//  uv_accept_shed(). raises an exception on other errors, unless some
+//  connections were accepted first.
+static Handle<Value> AcceptMany(const Arguments& args) {
+  HandleScope scope;
+
+  FD_ARG(args[0])
+
+  int max = args[1]->Int32Value();
+  if (max < 1) max = 1;
+
+  Local<Array> peers = Array::New();
+  int n = 0;
+
+  while (n < max) {
+    struct sockaddr_storage address_storage;
+    socklen_t len = sizeof(struct sockaddr_storage);
+
+    int peer_fd = uv_accept_fd(fd, (struct sockaddr*) &address_storage, &len);
+
+    if (peer_fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      if (errno == EMFILE || errno == ENFILE) {
+        int shed = uv_accept_shed(fd);
+        peers->Set(String::NewSymbol("emfile"), True());
+        peers->Set(String::NewSymbol("pause"),
+                   Boolean::New(shed < 0 || shed == UV_ACCEPT_SHED_MAX));
+        break;
+      }
+      if (n) break; // report it on the next call
+      return ThrowException(ErrnoException(errno, "accept"));
+    }
+
+    Local<Object> peer_info = Object::New();
+    peer_info->Set(fd_symbol, Integer::New(peer_fd));
+    ADDRESS_TO_JS(peer_info, address_storage, len);
+    peers->Set(n++, peer_info);
+  }
+
+  uv_accept_stats_add(n);
+
+  return scope.Close(peers);
+}
+
+#endif // __POSIX__
+
+
+Handle<Value> AcceptStats(const Arguments& args) {
+  HandleScope scope;
+
+  uv_accept_stats_t* s = uv_accept_stats();
+
+  Local<Array> batch = Array::New(ARRAY_SIZE(s->batch));
+  for (size_t i = 0; i < ARRAY_SIZE(s->batch); i++) {
+    batch->Set(i, Number::New(s->batch[i]));
+  }
+
+  Local<Object> o = Object::New();
+  o->Set(String::NewSymbol("wakeups"), Number::New(s->wakeups));
+  o->Set(String::NewSymbol("accepted"), Number::New(s->accepted));
+  o->Set(String::NewSymbol("batch"), batch);
+  o->Set(String::NewSymbol("maxBatch"), Number::New(s->max_batch));
+  o->Set(String::NewSymbol("emfile"), Number::New(s->emfile));
+  o->Set(String::NewSymbol("rejected"), Number::New(s->rejected));
+  o->Set(String::NewSymbol("paused"), Number::New(s->paused));
+  return scope.Close(o);
+}
+
+
 static Handle<Value> SocketError(const Arguments& args) {
   HandleScope scope;
 
@@ -850,6 +945,144 @@ static Handle<Value> RecvFrom(const Arguments& args) {
 }
 
 
+#ifdef __POSIX__
+
+// set on ENOSYS, each call can be missing on its own (recvmmsg came in
+// 2.6.33, sendmmsg only in 3.0)
+#ifdef HAVE_RECVMMSG
+static bool recvmmsg_missing = false;
+#endif
+#ifdef HAVE_SENDMMSG
+static bool sendmmsg_missing = false;
+#endif
+
+//  var infos = t.recvmmsg(fd, buffer, offset, length, count, flags);
+//    infos[i].size // bytes in the i-th datagram
+//    infos[i].port // from port
+//    infos[i].address // from address
+//  Receives up to count datagrams of at most length / count bytes each with
+//  one recvmmsg. They are packed one after the other from offset.
+//  returns null on EAGAIN or EINTR, raises an exception on all other errors
+//  returns the array of infos otherwise
+static Handle<Value> RecvMmsg(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() < 6) {
+    return ThrowException(Exception::TypeError(
+          String::New("Takes 6 parameters")));
+  }
+
+  FD_ARG(args[0])
+
+  if (!Buffer::HasInstance(args[1])) {
+    return ThrowException(Exception::TypeError(
+          String::New("Second argument should be a buffer")));
+  }
+
+  Local<Object> buffer_obj = args[1]->ToObject();
+  char *buffer_data = Buffer::Data(buffer_obj);
+  size_t buffer_length = Buffer::Length(buffer_obj);
+
+  size_t off = args[2]->Int32Value();
+  if (off >= buffer_length) {
+    return ThrowException(Exception::Error(
+          String::New("Offset is out of bounds")));
+  }
+
+  size_t len = args[3]->Int32Value();
+  if (off + len > buffer_length) {
+    return ThrowException(Exception::Error(
+          String::New("Length is extends beyond buffer")));
+  }
+
+  int count = args[4]->Int32Value();
+  if (count < 1 || count > MMSG_MAX || len / count == 0) {
+    return ThrowException(Exception::RangeError(
+          String::New("Bad datagram count")));
+  }
+
+  int flags = args[5]->Int32Value();
+
+  size_t slot = len / count;
+  char *base = buffer_data + off;
+
+  struct sockaddr_storage address_storage[MMSG_MAX];
+  socklen_t addrlens[MMSG_MAX];
+  ssize_t sizes[MMSG_MAX];
+  int received = -1;
+
+#ifdef HAVE_RECVMMSG
+  if (!recvmmsg_missing) {
+    struct iovec iov[MMSG_MAX];
+    struct node_mmsghdr msgs[MMSG_MAX];
+
+    memset(msgs, 0, count * sizeof(msgs[0]));
+    for (int i = 0; i < count; i++) {
+      iov[i].iov_base = base + i * slot;
+      iov[i].iov_len = slot;
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      msgs[i].msg_hdr.msg_name = &address_storage[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(address_storage[i]);
+    }
+
+    received = syscall(__NR_recvmmsg, fd, msgs, count, flags | MSG_DONTWAIT,
+                       NULL);
+
+    if (received < 0) {
+      if (errno == EAGAIN || errno == EINTR) return Null();
+      if (errno != ENOSYS) {
+        return ThrowException(ErrnoException(errno, "recvmmsg"));
+      }
+      recvmmsg_missing = true;
+    }
+
+    for (int i = 0; i < received; i++) {
+      sizes[i] = msgs[i].msg_len;
+      addrlens[i] = msgs[i].msg_hdr.msg_namelen;
+    }
+  }
+#endif
+
+  if (received < 0) {
+    received = 0;
+    while (received < count) {
+      addrlens[received] = sizeof(address_storage[received]);
+      ssize_t bytes_read = recvfrom(fd, base + received * slot, slot, flags,
+          (struct sockaddr*) &address_storage[received], &addrlens[received]);
+
+      if (bytes_read < 0) {
+        if (errno == EAGAIN || errno == EINTR) break;
+        if (received) break; // report it on the next call
+        return ThrowException(ErrnoException(errno, "recvfrom"));
+      }
+      sizes[received++] = bytes_read;
+    }
+    if (received == 0) return Null();
+  }
+
+  // Pack the datagrams so that the caller only uses what was received.
+  Local<Array> infos = Array::New(received);
+  size_t packed = 0;
+
+  for (int i = 0; i < received; i++) {
+    if (packed != i * slot) {
+      memmove(base + packed, base + i * slot, sizes[i]);
+    }
+    packed += sizes[i];
+
+    Local<Object> info = Object::New();
+    info->Set(size_symbol, Integer::New(sizes[i]));
+    ADDRESS_TO_JS(info, address_storage[i], addrlens[i]);
+    infos->Set(i, info);
+  }
+
+  return scope.Close(infos);
+}
+
+#endif // __POSIX__
+
+
 #ifdef __POSIX__
 
 // bytesRead = t.recvMsg(fd, buffer, offset, length)
@@ -1242,6 +1475,107 @@ static Handle<Value> SendTo(const Arguments& args) {
 }
 
 
+#ifdef __POSIX__
+
+// var sent = t.sendmmsg(fd, buffers, flags, port, address)
+// var sent = t.sendmmsg(fd, buffers, flags, path)
+//
+// Sends each buffer of the array as one datagram to the same destination,
+// up to MMSG_MAX of them with one sendmmsg. Returns the number of datagrams
+// sent, which may be fewer than given.
+//
+// Returns null on EAGAIN or EINTR, raises an exception on all other errors
+static Handle<Value> SendMmsg(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() < 4) {
+    return ThrowException(Exception::TypeError(
+          String::New("Takes 4 or 5 parameters")));
+  }
+
+  // The first argument should be a file descriptor
+  FD_ARG(args[0])
+
+  if (!args[1]->IsArray()) {
+    return ThrowException(Exception::TypeError(
+      String::New("Expected an array of buffers")));
+  }
+
+  Local<Array> buffers = Local<Array>::Cast(args[1]);
+  int count = buffers->Length();
+  if (count > MMSG_MAX) count = MMSG_MAX;
+
+  struct iovec iov[MMSG_MAX];
+  for (int i = 0; i < count; i++) {
+    Local<Value> buffer = buffers->Get(i);
+    if (!Buffer::HasInstance(buffer)) {
+      return ThrowException(Exception::TypeError(
+        String::New("Expected an array of buffers")));
+    }
+    iov[i].iov_base = Buffer::Data(buffer->ToObject());
+    iov[i].iov_len = Buffer::Length(buffer->ToObject());
+  }
+
+  int flags = 0;
+  if (!args[2]->IsUndefined()) {
+    if (!args[2]->IsUint32()) {
+      return ThrowException(Exception::TypeError(
+        String::New("Expected unsigned integer for a flags argument")));
+    }
+
+    flags = args[2]->Uint32Value();
+  }
+
+  Handle<Value> error = ParseAddressArgs(args[3], args[4], false);
+  if (!error.IsEmpty()) return ThrowException(error);
+
+  if (count == 0) return scope.Close(Integer::New(0));
+
+  int sent = -1;
+
+#ifdef HAVE_SENDMMSG
+  if (!sendmmsg_missing) {
+    struct node_mmsghdr msgs[MMSG_MAX];
+
+    memset(msgs, 0, count * sizeof(msgs[0]));
+    for (int i = 0; i < count; i++) {
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      msgs[i].msg_hdr.msg_name = addr;
+      msgs[i].msg_hdr.msg_namelen = addrlen;
+    }
+
+    sent = syscall(__NR_sendmmsg, fd, msgs, count, flags);
+
+    if (sent < 0) {
+      if (errno == EAGAIN || errno == EINTR) return Null();
+      if (errno != ENOSYS) {
+        return ThrowException(ErrnoException(errno, "sendmmsg"));
+      }
+      sendmmsg_missing = true;
+    }
+  }
+#endif
+
+  if (sent < 0) {
+    for (sent = 0; sent < count; sent++) {
+      ssize_t written = sendto(fd, iov[sent].iov_base, iov[sent].iov_len,
+          flags, addr, addrlen);
+
+      if (written < 0) {
+        if (sent) break; // report it on the next call
+        if (errno == EAGAIN || errno == EINTR) return Null();
+        return ThrowException(ErrnoException(errno, "sendto"));
+      }
+    }
+  }
+
+  return scope.Close(Integer::New(sent));
+}
+
+#endif // __POSIX__
+
+
 // Probably only works for Linux TCP sockets?
 // Returns the amount of data on the read queue.
 static Handle<Value> ToRead(const Arguments& args) {
@@ -1723,6 +2057,8 @@ void InitNet(Handle<Object> target) {
   NODE_SET_METHOD(target, "recvfrom", RecvFrom);
 
 #ifdef __POSIX__
+  NODE_SET_METHOD(target, "sendmmsg", SendMmsg);
+  NODE_SET_METHOD(target, "recvmmsg", RecvMmsg);
   NODE_SET_METHOD(target, "sendMsg", SendMsg);
 
   recv_msg_template =
@@ -1743,6 +2079,9 @@ void InitNet(Handle<Object> target) {
   NODE_SET_METHOD(target, "bind", Bind);
   NODE_SET_METHOD(target, "listen", Listen);
   NODE_SET_METHOD(target, "accept", Accept);
+#ifdef __POSIX__
+  NODE_SET_METHOD(target, "acceptMany", AcceptMany);
+#endif
   NODE_SET_METHOD(target, "socketError", SocketError);
   NODE_SET_METHOD(target, "toRead", ToRead);
   NODE_SET_METHOD(target, "setNoDelay", SetNoDelay);
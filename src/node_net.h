@@ -28,6 +28,9 @@ namespace node {
 
 void InitNet(v8::Handle<v8::Object> target);
 
+// process.acceptStats()
+v8::Handle<v8::Value> AcceptStats(const v8::Arguments& args);
+
 }
 
 #endif  // NODE_NET
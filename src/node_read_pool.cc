@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <node.h>
+#include <node_buffer.h>
+#include <node_read_pool.h>
+
+#include <assert.h>
+
+using namespace v8;
+
+namespace node {
+
+struct ReadSlab {
+  Persistent<Object> buffer; // weak, the holder keeps the current one alive
+  ReadPool* pool;            // while current, NULL once retired
+  char* data;
+  size_t used;   // reserved or handed out, from the start
+  size_t handed; // bytes given to JS as slices
+};
+
+// for all pools, see process.readPoolStats()
+static struct {
+  size_t slabs;          // live slabs, current and retired
+  double pinned;         // their bytes
+  double used;           // bytes of theirs handed to JS
+  double allocs;         // reservations
+  double reserved;       // bytes reserved by them
+  double reads;          // reads handed to JS
+  double compacted;      // of these, copied out of the slab
+  double compactedBytes;
+} s_stats;
+
+static Persistent<String> pool_sym;
+static Persistent<String> slab_sym;
+static Persistent<ObjectTemplate> holder_template;
+
+ReadPool::ReadPool()
+  : m_slab(NULL)
+  , m_refs(0) {
+}
+
+ReadPool::~ReadPool() {
+  Retire();
+}
+
+ReadPool* ReadPool::ForContext() {
+  HandleScope scope;
+
+  if (pool_sym.IsEmpty()) {
+    pool_sym = NODE_PSYMBOL("readPool");
+    slab_sym = NODE_PSYMBOL("readSlab");
+    holder_template = Persistent<ObjectTemplate>::New(ObjectTemplate::New());
+    holder_template->SetInternalFieldCount(1);
+  }
+
+  Local<Object> global = Context::GetCurrent()->Global();
+  Local<Value> holder_v = global->GetHiddenValue(pool_sym);
+  ReadPool* pool;
+
+  if (holder_v.IsEmpty()) {
+    // the global holds a reference until it is collected
+    pool = new ReadPool();
+    pool->Ref();
+    Local<Object> holder = holder_template->NewInstance();
+    holder->SetPointerInInternalField(0, pool);
+    global->SetHiddenValue(pool_sym, holder);
+    pool->m_holder = Persistent<Object>::New(holder);
+    pool->m_holder.MakeWeak(pool, OnGlobalGone);
+  } else {
+    pool = static_cast<ReadPool*>(
+        holder_v->ToObject()->GetPointerFromInternalField(0));
+  }
+
+  pool->Ref();
+  return pool;
+}
+
+void ReadPool::OnGlobalGone(Persistent<Value> object, void* data) {
+  ReadPool* pool = static_cast<ReadPool*>(data);
+  object.Dispose();
+  pool->m_holder.Clear();
+  pool->Unref();
+}
+
+void ReadPool::Ref() {
+  m_refs++;
+}
+
+void ReadPool::Unref() {
+  assert(m_refs > 0);
+  if (--m_refs == 0) {
+    delete this;
+  }
+}
+
+bool ReadPool::NewSlab() {
+  HandleScope scope;
+  Buffer* b = Buffer::New(kSlabSize);
+  if (!b || Buffer::Length(b->handle_) != kSlabSize) {
+    return false;
+  }
+
+  m_slab = new ReadSlab;
+  m_slab->buffer = Persistent<Object>::New(b->handle_);
+  m_slab->buffer.MakeWeak(m_slab, OnSlabGone);
+  m_slab->pool = this;
+  m_slab->data = Buffer::Data(b);
+  m_slab->used = 0;
+  m_slab->handed = 0;
+
+  if (!m_holder.IsEmpty()) {
+    m_holder->SetHiddenValue(slab_sym, b->handle_);
+  }
+
+  s_stats.slabs++;
+  s_stats.pinned += kSlabSize;
+  return true;
+}
+
+// The current slab is left to the slices JS holds, it is accounted for
+// until V8 collects it.
+void ReadPool::Retire() {
+  if (!m_slab) {
+    return;
+  }
+  if (!m_holder.IsEmpty()) {
+    HandleScope scope;
+    m_holder->DeleteHiddenValue(slab_sym);
+  }
+  m_slab->pool = NULL;
+  m_slab = NULL;
+}
+
+// Also the current slab once the context global is gone, the next read
+// starts a new one.
+void ReadPool::OnSlabGone(Persistent<Value> object, void* data) {
+  ReadSlab* slab = static_cast<ReadSlab*>(data);
+  if (slab->pool) {
+    slab->pool->m_slab = NULL;
+  }
+  s_stats.slabs--;
+  s_stats.pinned -= kSlabSize;
+  s_stats.used -= slab->handed;
+  object.Dispose();
+  delete slab;
+}
+
+uv_buf_t ReadPool::Alloc(size_t size) {
+  assert(size <= kSlabSize);
+
+  if (!m_slab || kSlabSize - m_slab->used < size) {
+    if (m_slab && m_slab->handed == 0) {
+      // JS holds nothing of it, start over
+      m_slab->used = 0;
+    } else {
+      Retire();
+      if (!NewSlab()) {
+        uv_buf_t buf = { NULL, 0 };
+        return buf;
+      }
+    }
+  }
+
+  uv_buf_t buf;
+  buf.base = m_slab->data + m_slab->used;
+  buf.len = size;
+  m_slab->used += size;
+
+  s_stats.allocs++;
+  s_stats.reserved += size;
+  return buf;
+}
+
+// Unreserves buf but its first keep bytes, if it is the latest reservation.
+void ReadPool::GiveBack(uv_buf_t buf, size_t keep) {
+  if (m_slab && buf.base + buf.len == m_slab->data + m_slab->used) {
+    m_slab->used -= buf.len - keep;
+  }
+}
+
+void ReadPool::Release(uv_buf_t buf) {
+  GiveBack(buf, 0);
+}
+
+Local<Object> ReadPool::Claim(uv_buf_t buf, size_t nread, size_t* offset) {
+  HandleScope scope;
+  assert(nread > 0 && nread <= buf.len);
+  s_stats.reads++;
+
+  // the slab may only be held weakly, keep it while copying out of it
+  Local<Object> slab;
+  if (m_slab) {
+    slab = Local<Object>::New(m_slab->buffer);
+  }
+
+  bool in_slab = m_slab && buf.base >= m_slab->data &&
+                 buf.base < m_slab->data + kSlabSize;
+
+  if (nread <= kCompactSize || !in_slab) {
+    // small enough to copy rather than pin the slab with
+    Buffer* b = Buffer::New(buf.base, nread);
+    GiveBack(buf, 0);
+    s_stats.compacted++;
+    s_stats.compactedBytes += nread;
+    *offset = 0;
+    return scope.Close(Local<Object>::New(b->handle_));
+  }
+
+  GiveBack(buf, nread);
+  m_slab->handed += nread;
+  s_stats.used += nread;
+  *offset = buf.base - m_slab->data;
+  return scope.Close(slab);
+}
+
+// Twice what the handle read lately, so a read rarely comes back full, in
+// kMinReserve .. kMaxReserve and 16 byte steps to keep the slices aligned.
+size_t ReadPool::ReserveSize(size_t hint, size_t suggested) {
+  size_t size = hint ? 2 * hint : kMaxReserve / 4;
+  size_t max = suggested < kMaxReserve ? suggested : kMaxReserve;
+  if (size < kMinReserve) size = kMinReserve;
+  if (size > max) size = max;
+  return (size + 15) & ~(size_t) 15;
+}
+
+void ReadPool::Update(size_t* hint, size_t nread, size_t reserved) {
+  if (nread >= reserved) {
+    // came back full, there is probably more
+    *hint = reserved;
+  } else if (nread > *hint) {
+    *hint = nread;
+  } else {
+    // decay towards the recent sizes
+    *hint -= (*hint - nread) / 4;
+  }
+}
+
+Handle<Value> ReadPool::Stats(const Arguments& args) {
+  HandleScope scope;
+
+  Local<Object> o = Object::New();
+  o->Set(String::NewSymbol("slabSize"), Integer::NewFromUnsigned(kSlabSize));
+  o->Set(String::NewSymbol("slabs"), Integer::NewFromUnsigned(s_stats.slabs));
+  o->Set(String::NewSymbol("pinned"), Number::New(s_stats.pinned));
+  o->Set(String::NewSymbol("used"), Number::New(s_stats.used));
+  o->Set(String::NewSymbol("allocs"), Number::New(s_stats.allocs));
+  o->Set(String::NewSymbol("reserved"), Number::New(s_stats.reserved));
+  o->Set(String::NewSymbol("reads"), Number::New(s_stats.reads));
+  o->Set(String::NewSymbol("compacted"), Number::New(s_stats.compacted));
+  o->Set(String::NewSymbol("compactedBytes"), Number::New(s_stats.compactedBytes));
+  return scope.Close(o);
+}
+
+}  // namespace node
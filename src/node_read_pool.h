@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NODE_READ_POOL_H_
+#define NODE_READ_POOL_H_
+
+#include <v8.h>
+#include <uv.h>
+#include <stddef.h>
+
+namespace node {
+
+struct ReadSlab;
+
+/**
+ * Read buffers for the TCP handles of one context.
+ *
+ * Reads are carved out of kSlabSize Buffers and handed to JS as slices, so
+ * a socket read costs no allocation. A slice that JS keeps alive pins its
+ * whole slab though, which hurts with many idle keep-alive sockets that
+ * each read a few hundred bytes now and then. So:
+ *
+ *  - each handle reserves what its recent reads suggest (ReserveSize and
+ *    Update keep the hint) instead of the 64KB libuv asks for;
+ *  - reads of up to kCompactSize bytes are copied into a Buffer of their
+ *    own and the slab space is reused at once, only larger reads are
+ *    handed out as slab slices;
+ *  - retired slabs are tracked until V8 collects them, which is what
+ *    process.readPoolStats() reports as pinned against used bytes.
+ *
+ * The pool is found through a hidden value on the context global once per
+ * handle (ForContext) and reference counted by the handles and the global.
+ * The current slab hangs off the same holder, native code only keeps weak
+ * handles, a Buffer roots its creation context and a strong one would keep
+ * the global (and with it the pool) alive for good.
+ * All calls are made on the main (V8) thread.
+ */
+class ReadPool {
+  public:
+    static const size_t kSlabSize = 1024 * 1024;
+    static const size_t kCompactSize = 2 * 1024;
+    static const size_t kMinReserve = 4 * 1024;
+    static const size_t kMaxReserve = 64 * 1024;
+
+    // The pool of the current context, with a reference for the caller
+    static ReadPool* ForContext();
+
+    void Ref();
+    void Unref();
+
+    // Reserves up to size bytes for the read about to happen
+    uv_buf_t Alloc(size_t size);
+
+    // The read into buf got nread (> 0) bytes: the Buffer holding them,
+    // with their offset, and the rest of the reservation back to the pool
+    v8::Local<v8::Object> Claim(uv_buf_t buf, size_t nread, size_t* offset);
+
+    // Nothing was read into buf
+    void Release(uv_buf_t buf);
+
+    // Per handle reservation size: hint is the handle's, suggested libuv's
+    static size_t ReserveSize(size_t hint, size_t suggested);
+    static void Update(size_t* hint, size_t nread, size_t reserved);
+
+    // JS API - process.readPoolStats(), for all contexts
+    static v8::Handle<v8::Value> Stats(const v8::Arguments& args);
+
+  private:
+    ReadPool();
+    ~ReadPool();
+
+    bool NewSlab();
+    void Retire();
+    void GiveBack(uv_buf_t buf, size_t keep);
+    static void OnGlobalGone(v8::Persistent<v8::Value> object, void* data);
+    static void OnSlabGone(v8::Persistent<v8::Value> object, void* data);
+
+    ReadSlab* m_slab;   // current slab, NULL until the first read
+    v8::Persistent<v8::Object> m_holder; // weak, empty once the global is gone
+    int m_refs;
+};
+
+}  // namespace node
+
+#endif  // NODE_READ_POOL_H_
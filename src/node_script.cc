@@ -21,6 +21,7 @@
 
 #include <node.h>
 #include <node_script.h>
+#include <node_compile_cache.h>
 #include <assert.h>
 
 namespace node {
@@ -54,7 +55,7 @@ class WrappedScript : ObjectWrap {
  public:
   static void Initialize(Handle<Object> target);
 
-  enum EvalInputFlags { compileCode, unwrapExternal };
+  enum EvalInputFlags { compileCode, compileCachedCode, unwrapExternal };
   enum EvalContextFlags { thisContext, newContext, userContext };
   enum EvalOutputFlags { returnResult, wrapExternal };
 
@@ -76,6 +77,7 @@ class WrappedScript : ObjectWrap {
   static Handle<Value> RunInNewContext(const Arguments& args);
   static Handle<Value> CompileRunInContext(const Arguments& args);
   static Handle<Value> CompileRunInThisContext(const Arguments& args);
+  static Handle<Value> CompileCachedRunInThisContext(const Arguments& args);
   static Handle<Value> CompileRunInNewContext(const Arguments& args);
 
   Persistent<Script> script_;
@@ -182,6 +184,12 @@ void WrappedScript::Initialize(Handle<Object> target) {
                   "runInThisContext",
                   WrappedScript::CompileRunInThisContext);
 
+  // proteus: same as runInThisContext, compiled with the preparse data from
+  // the on disk compile cache, used for the module wrappers
+  NODE_SET_METHOD(constructor_template->GetFunction(),
+                  "runInThisContextCached",
+                  WrappedScript::CompileCachedRunInThisContext);
+
   NODE_SET_METHOD(constructor_template->GetFunction(),
                   "runInNewContext",
                   WrappedScript::CompileRunInNewContext);
@@ -263,6 +271,12 @@ Handle<Value> WrappedScript::CompileRunInThisContext(const Arguments& args) {
 }
 
 
+Handle<Value> WrappedScript::CompileCachedRunInThisContext(const Arguments& args) {
+  return
+    WrappedScript::EvalMachine<compileCachedCode, thisContext, returnResult>(args);
+}
+
+
 Handle<Value> WrappedScript::CompileRunInNewContext(const Arguments& args) {
   return
     WrappedScript::EvalMachine<compileCode, newContext, returnResult>(args);
@@ -275,12 +289,12 @@ template <WrappedScript::EvalInputFlags input_flag,
 Handle<Value> WrappedScript::EvalMachine(const Arguments& args) {
   HandleScope scope;
 
-  if (input_flag == compileCode && args.Length() < 1) {
+  if (input_flag != unwrapExternal && args.Length() < 1) {
     return ThrowException(Exception::TypeError(
           String::New("needs at least 'code' argument.")));
   }
 
-  const int sandbox_index = input_flag == compileCode ? 1 : 0;
+  const int sandbox_index = input_flag != unwrapExternal ? 1 : 0;
   if (context_flag == userContext
     && !WrappedContext::InstanceOf(args[sandbox_index]))
   {
@@ -290,7 +304,7 @@ Handle<Value> WrappedScript::EvalMachine(const Arguments& args) {
 
 
   Local<String> code;
-  if (input_flag == compileCode) code = args[0]->ToString();
+  if (input_flag != unwrapExternal) code = args[0]->ToString();
 
   Local<Object> sandbox;
   if (context_flag == newContext) {
@@ -352,7 +366,16 @@ Handle<Value> WrappedScript::EvalMachine(const Arguments& args) {
   Handle<Value> result;
   Handle<Script> script;
 
-  if (input_flag == compileCode) {
+  if (input_flag == compileCachedCode) {
+    ScriptOrigin origin(filename);
+    ScriptData* pre_data = CompileCache::Get(code);
+    script = Script::Compile(code, &origin, pre_data);
+    delete pre_data;
+    if (script.IsEmpty()) {
+      if (display_error) Node::DisplayExceptionLine(try_catch);
+      return try_catch.ReThrow();
+    }
+  } else if (input_flag == compileCode) {
     // well, here WrappedScript::New would suffice in all cases, but maybe
     // Compile has a little better performance where possible
     script = output_flag == returnResult ? Script::Compile(code, filename)
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <node_search.h>
+#include <node_cpu.h>
+
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define NODE_SEARCH_SSE2
+#endif
+
+namespace node {
+
+// needles this long skip ahead with Horspool, the filter checks every
+// position and gets no faster for them
+#define HORSPOOL_MIN 16
+
+
+// no blocks, search_forward does it all
+static ssize_t scalar_find(const uint8_t *hay, size_t len,
+                           const uint8_t *needle, size_t nlen, size_t *scanned) {
+  *scanned = 0;
+  return -1;
+}
+
+static const SearchKernels s_scalar = { "scalar", scalar_find };
+
+
+#ifdef NODE_SEARCH_SSE2
+
+#define SSE2 __attribute__((target("sse2")))
+
+// 16 positions at a time, compares the first and the last byte of the
+// needle and only memcmp()s where both match
+SSE2 static ssize_t sse2_find(const uint8_t *hay, size_t len,
+                              const uint8_t *needle, size_t nlen, size_t *scanned) {
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[nlen - 1]);
+  size_t i = 0;
+  for (; i + nlen - 1 + 16 <= len; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i*) (hay + i));
+    __m128i b = _mm_loadu_si128((const __m128i*) (hay + i + nlen - 1));
+    unsigned int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+                                                        _mm_cmpeq_epi8(b, last)));
+    while (mask) {
+      unsigned int bit = __builtin_ctz(mask);
+      if (!memcmp(hay + i + bit + 1, needle + 1, nlen - 2)) {
+        return i + bit;
+      }
+      mask &= mask - 1;
+    }
+  }
+  *scanned = i;
+  return -1;
+}
+
+static const SearchKernels s_sse2 = { "sse2", sse2_find };
+
+#undef SSE2
+
+#endif  // NODE_SEARCH_SSE2
+
+
+static const SearchKernels *s_kernels;
+
+// Picked once, racing threads pick the same kernels
+static const SearchKernels* Kernels() {
+  if (s_kernels) {
+    return s_kernels;
+  }
+
+  const SearchKernels *kernels = &s_scalar;
+  if (cpu_simd_enabled()) {
+#ifdef NODE_SEARCH_SSE2
+    if (cpu_has_sse2()) {
+      kernels = &s_sse2;
+    }
+#endif
+    if (search_neon_kernels()) {
+      kernels = search_neon_kernels();
+    }
+  }
+  s_kernels = kernels;
+  return s_kernels;
+}
+
+const char* search_impl() {
+  return Kernels()->name;
+}
+
+
+// memchr for the first byte, memcmp for the rest
+static ssize_t find_scalar(const uint8_t *hay, size_t len,
+                           const uint8_t *needle, size_t nlen) {
+  const uint8_t *p = hay;
+  const uint8_t *end = hay + len - nlen + 1;
+  while (p < end) {
+    p = (const uint8_t*) memchr(p, needle[0], end - p);
+    if (!p) {
+      return -1;
+    }
+    if (!memcmp(p + 1, needle + 1, nlen - 1)) {
+      return p - hay;
+    }
+    p++;
+  }
+  return -1;
+}
+
+static ssize_t horspool_forward(const uint8_t *hay, size_t len,
+                                const uint8_t *needle, size_t nlen) {
+  size_t skip[256];
+  for (int i = 0; i < 256; i++) {
+    skip[i] = nlen;
+  }
+  for (size_t i = 0; i < nlen - 1; i++) {
+    skip[needle[i]] = nlen - 1 - i;
+  }
+
+  uint8_t last = needle[nlen - 1];
+  for (size_t i = 0; i <= len - nlen; ) {
+    uint8_t c = hay[i + nlen - 1];
+    if (c == last && !memcmp(hay + i, needle, nlen - 1)) {
+      return i;
+    }
+    i += skip[c];
+  }
+  return -1;
+}
+
+static ssize_t horspool_backward(const uint8_t *hay, size_t len,
+                                 const uint8_t *needle, size_t nlen) {
+  size_t skip[256];
+  for (int i = 0; i < 256; i++) {
+    skip[i] = nlen;
+  }
+  for (size_t i = nlen - 1; i > 0; i--) {
+    skip[needle[i]] = i;
+  }
+
+  uint8_t first = needle[0];
+  for (ssize_t i = len - nlen; i >= 0; ) {
+    uint8_t c = hay[i];
+    if (c == first && !memcmp(hay + i + 1, needle + 1, nlen - 1)) {
+      return i;
+    }
+    i -= skip[c];
+  }
+  return -1;
+}
+
+ssize_t search_forward(const char *hay, size_t len, const char *needle, size_t nlen) {
+  if (nlen == 0) {
+    return 0;
+  }
+  if (nlen > len) {
+    return -1;
+  }
+
+  const uint8_t *h = (const uint8_t*) hay;
+  const uint8_t *n = (const uint8_t*) needle;
+  if (nlen == 1) {
+    const void *p = memchr(h, n[0], len);
+    return p ? (const uint8_t*) p - h : -1;
+  }
+  if (nlen >= HORSPOOL_MIN) {
+    return horspool_forward(h, len, n, nlen);
+  }
+
+  size_t scanned;
+  ssize_t found = Kernels()->find(h, len, n, nlen, &scanned);
+  if (found >= 0) {
+    return found;
+  }
+  found = find_scalar(h + scanned, len - scanned, n, nlen);
+  return found >= 0 ? found + scanned : -1;
+}
+
+ssize_t search_backward(const char *hay, size_t len, const char *needle, size_t nlen) {
+  if (nlen == 0) {
+    return len;
+  }
+  if (nlen > len) {
+    return -1;
+  }
+
+  const uint8_t *h = (const uint8_t*) hay;
+  const uint8_t *n = (const uint8_t*) needle;
+  if (nlen >= HORSPOOL_MIN) {
+    return horspool_backward(h, len, n, nlen);
+  }
+
+  // no memrchr in bionic
+  for (ssize_t i = len - nlen; i >= 0; i--) {
+    if (h[i] == n[0] && !memcmp(h + i + 1, n + 1, nlen - 1)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+}  // namespace node
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NODE_SEARCH_H_
+#define NODE_SEARCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace node {
+
+/**
+ * Vectorized first/last byte filter for needles of 2 bytes and more.
+ * Checks the candidate positions of hay a block at a time, returning the
+ * first match or -1 with *scanned set to the positions ruled out, the
+ * caller goes on from there.
+ */
+struct SearchKernels {
+  const char *name;
+  ssize_t (*find)(const uint8_t *hay, size_t len,
+                  const uint8_t *needle, size_t nlen, size_t *scanned);
+};
+
+// NEON kernels, NULL if the cpu or the build has no NEON
+const SearchKernels* search_neon_kernels();
+
+/**
+ * Offset of the first occurrence of needle in hay, -1 if there is none.
+ * An empty needle is found at 0. Single bytes go to memchr, short needles
+ * through the kernels and long ones through Boyer-Moore-Horspool.
+ */
+ssize_t search_forward(const char *hay, size_t len, const char *needle, size_t nlen);
+
+/**
+ * Offset of the last occurrence of needle in hay, -1 if there is none.
+ * An empty needle is found at len.
+ */
+ssize_t search_backward(const char *hay, size_t len, const char *needle, size_t nlen);
+
+// name of the kernels in use: "neon", "sse2" or "scalar"
+const char* search_impl();
+
+}  // namespace node
+
+#endif  // NODE_SEARCH_H_
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Built with NEON enabled on ARM (see Android.libnode.mk), only used once
+// the cpu is known to have it. Empty on other targets.
+
+#include <node_search.h>
+#include <node_cpu.h>
+
+#include <string.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+namespace node {
+
+// 16 positions at a time, compares the first and the last byte of the
+// needle. There is no movemask, the candidates are checked one by one once
+// the block has any
+static ssize_t neon_find(const uint8_t *hay, size_t len,
+                         const uint8_t *needle, size_t nlen, size_t *scanned) {
+  const uint8x16_t first = vdupq_n_u8(needle[0]);
+  const uint8x16_t last = vdupq_n_u8(needle[nlen - 1]);
+  size_t i = 0;
+  for (; i + nlen - 1 + 16 <= len; i += 16) {
+    uint8x16_t a = vld1q_u8(hay + i);
+    uint8x16_t b = vld1q_u8(hay + i + nlen - 1);
+    uint8x16_t eq = vandq_u8(vceqq_u8(a, first), vceqq_u8(b, last));
+    uint64x2_t eq64 = vreinterpretq_u64_u8(eq);
+    if (!(vgetq_lane_u64(eq64, 0) | vgetq_lane_u64(eq64, 1))) {
+      continue;
+    }
+    uint8_t lanes[16];
+    vst1q_u8(lanes, eq);
+    for (int j = 0; j < 16; j++) {
+      if (lanes[j] && !memcmp(hay + i + j + 1, needle + 1, nlen - 2)) {
+        return i + j;
+      }
+    }
+  }
+  *scanned = i;
+  return -1;
+}
+
+static const SearchKernels s_neon = { "neon", neon_find };
+
+const SearchKernels* search_neon_kernels() {
+  return cpu_has_neon() ? &s_neon : NULL;
+}
+
+}  // namespace node
+
+#else
+
+namespace node {
+
+const SearchKernels* search_neon_kernels() {
+  return NULL;
+}
+
+}  // namespace node
+
+#endif
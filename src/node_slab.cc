@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <node.h>
+#include <node_slab.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+using namespace v8;
+
+namespace node {
+
+// Header at the start of every chunk, the blocks follow at kBlockOffset
+struct SlabChunk {
+  SlabHeap* heap;
+  SlabChunk* prev; // in the heap's partial list of the class
+  SlabChunk* next;
+  char* free;      // freed blocks, linked through their first word
+  char* carve;     // blocks never handed out start here
+  unsigned int live;
+  unsigned int capacity;
+  int cls;
+  bool partial;
+};
+
+static const size_t kBlockOffset = 64;
+
+static inline size_t ClassSize(int cls) {
+  return SlabHeap::kMinClassSize << cls;
+}
+
+static inline int SizeClass(size_t length) {
+  int cls = 0;
+  while (ClassSize(cls) < length) {
+    cls++;
+  }
+  return cls;
+}
+
+static inline void Unlink(SlabChunk** list, SlabChunk* chunk) {
+  if (chunk->prev) {
+    chunk->prev->next = chunk->next;
+  } else {
+    *list = chunk->next;
+  }
+  if (chunk->next) {
+    chunk->next->prev = chunk->prev;
+  }
+  chunk->prev = chunk->next = NULL;
+  chunk->partial = false;
+}
+
+static inline void Push(SlabChunk** list, SlabChunk* chunk) {
+  chunk->prev = NULL;
+  chunk->next = *list;
+  if (*list) {
+    (*list)->prev = chunk;
+  }
+  *list = chunk;
+  chunk->partial = true;
+}
+
+SlabHeap::SlabHeap()
+  : m_blocks(0)
+  , m_used(0)
+  , m_large(0)
+  , m_reported(0)
+  , m_unreported(0)
+  , m_released(false)
+{
+  for (int i = 0; i < kClasses; i++) {
+    m_partial[i] = NULL;
+    m_chunks[i] = 0;
+    m_allocs[i] = 0;
+  }
+}
+
+SlabHeap::~SlabHeap() {
+  // only the last empty chunk of each class can be left
+  for (int i = 0; i < kClasses; i++) {
+    while (m_partial[i]) {
+      SlabChunk* chunk = m_partial[i];
+      Unlink(&m_partial[i], chunk);
+      FreeChunk(chunk);
+    }
+  }
+  Flush();
+}
+
+char* SlabHeap::Alloc(size_t length) {
+  if (length > kMaxClassSize) {
+    char* data = (char*) malloc(length);
+    if (data) {
+      m_blocks++;
+      m_large += length;
+      Report(length);
+    }
+    return data;
+  }
+  return AllocSmall(SizeClass(length));
+}
+
+void SlabHeap::Free(char* data, size_t length) {
+  if (length > kMaxClassSize) {
+    free(data);
+    m_blocks--;
+    m_large -= length;
+    Report(-(ssize_t) length);
+  } else {
+    FreeSmall((SlabChunk*) ((uintptr_t) data & ~(uintptr_t) (kChunkSize - 1)), data);
+  }
+
+  if (m_released && m_blocks == 0) {
+    delete this;
+  }
+}
+
+void SlabHeap::Release() {
+  m_released = true;
+  if (m_blocks == 0) {
+    delete this;
+  } else {
+    // buffers still alive, drop the empty chunks kept for reuse
+    for (int i = 0; i < kClasses; i++) {
+      SlabChunk* chunk = m_partial[i];
+      while (chunk) {
+        SlabChunk* next = chunk->next;
+        if (chunk->live == 0) {
+          Unlink(&m_partial[i], chunk);
+          FreeChunk(chunk);
+        }
+        chunk = next;
+      }
+    }
+    Flush();
+  }
+}
+
+char* SlabHeap::AllocSmall(int cls) {
+  SlabChunk* chunk = m_partial[cls];
+  if (!chunk && !(chunk = NewChunk(cls))) {
+    return NULL;
+  }
+
+  char* data = chunk->free;
+  if (data) {
+    chunk->free = *(char**) data;
+  } else {
+    data = chunk->carve;
+    chunk->carve += ClassSize(cls);
+  }
+
+  if (++chunk->live == chunk->capacity) {
+    Unlink(&m_partial[cls], chunk);
+  }
+  m_blocks++;
+  m_used += ClassSize(cls);
+  m_allocs[cls]++;
+  return data;
+}
+
+void SlabHeap::FreeSmall(SlabChunk* chunk, char* data) {
+  int cls = chunk->cls;
+  *(char**) data = chunk->free;
+  chunk->free = data;
+  m_blocks--;
+  m_used -= ClassSize(cls);
+
+  if (!chunk->partial) {
+    Push(&m_partial[cls], chunk);
+  }
+
+  // keep one empty chunk per class so a buffer freed and allocated again
+  // doesn't map and unmap a chunk each time
+  if (--chunk->live == 0 && (m_released || chunk->prev || chunk->next)) {
+    Unlink(&m_partial[cls], chunk);
+    FreeChunk(chunk);
+  }
+}
+
+SlabChunk* SlabHeap::NewChunk(int cls) {
+  void* p;
+  if (posix_memalign(&p, kChunkSize, kChunkSize)) {
+    return NULL;
+  }
+
+  SlabChunk* chunk = (SlabChunk*) p;
+  chunk->heap = this;
+  chunk->free = NULL;
+  chunk->carve = (char*) p + kBlockOffset;
+  chunk->live = 0;
+  chunk->capacity = (kChunkSize - kBlockOffset) / ClassSize(cls);
+  chunk->cls = cls;
+  Push(&m_partial[cls], chunk);
+
+  m_chunks[cls]++;
+  Report(kChunkSize);
+  return chunk;
+}
+
+void SlabHeap::FreeChunk(SlabChunk* chunk) {
+  m_chunks[chunk->cls]--;
+  free(chunk);
+  Report(-(ssize_t) kChunkSize);
+}
+
+void SlabHeap::Report(ssize_t bytes) {
+  m_unreported += bytes;
+  if (m_unreported >= (ssize_t) kReportBatch || m_unreported <= -(ssize_t) kReportBatch) {
+    Flush();
+  }
+}
+
+void SlabHeap::Flush() {
+  if (m_unreported) {
+    V8::AdjustAmountOfExternalAllocatedMemory(m_unreported);
+    m_reported += m_unreported;
+    m_unreported = 0;
+  }
+}
+
+Handle<Value> SlabHeap::Stats(const Arguments& args) {
+  HandleScope scope;
+  SlabHeap* heap = Node::GetCurrentNode()->slab();
+
+  Local<Object> o = Object::New();
+  o->Set(String::NewSymbol("enabled"), Boolean::New(heap != NULL));
+  if (!heap) {
+    return scope.Close(o);
+  }
+
+  size_t chunks = 0;
+  Local<Array> classes = Array::New(kClasses);
+  for (int i = 0; i < kClasses; i++) {
+    Local<Object> c = Object::New();
+    c->Set(String::NewSymbol("size"), Integer::NewFromUnsigned(ClassSize(i)));
+    c->Set(String::NewSymbol("chunks"), Integer::NewFromUnsigned(heap->m_chunks[i]));
+    c->Set(String::NewSymbol("allocs"), Number::New(heap->m_allocs[i]));
+    classes->Set(i, c);
+    chunks += heap->m_chunks[i];
+  }
+
+  o->Set(String::NewSymbol("chunkSize"), Integer::NewFromUnsigned(kChunkSize));
+  o->Set(String::NewSymbol("chunks"), Integer::NewFromUnsigned(chunks));
+  o->Set(String::NewSymbol("blocks"), Integer::NewFromUnsigned(heap->m_blocks));
+  o->Set(String::NewSymbol("used"), Number::New(heap->m_used));
+  o->Set(String::NewSymbol("large"), Number::New(heap->m_large));
+  o->Set(String::NewSymbol("reported"), Number::New(heap->m_reported));
+  o->Set(String::NewSymbol("classes"), classes);
+  return scope.Close(o);
+}
+
+}  // namespace node
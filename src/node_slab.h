@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NODE_SLAB_H_
+#define NODE_SLAB_H_
+
+#include <v8.h>
+#include <stddef.h>
+
+namespace node {
+
+struct SlabChunk;
+
+/**
+ * Size class slab allocator for the Buffer backing stores of one Node
+ * instance, so small buffer churn from net and http stays out of the
+ * malloc heap.
+ *
+ * Requests up to kMaxClassSize are rounded up to a power of two and carved
+ * from kChunkSize chunks, each chunk serving a single class. The chunks are
+ * aligned to their size so a block finds its chunk header by masking its
+ * address, and a chunk is returned to the system as soon as it is empty
+ * and not the last one of its class. Larger requests go to malloc but are
+ * still accounted here.
+ *
+ * The memory is reported to V8 in steps of kReportBatch bytes rather than
+ * per buffer. When the Node goes away Release() hands back all chunks at
+ * once; the Buffers of the page that V8 has not collected yet keep the heap
+ * (and their chunks) alive until their weak callbacks run.
+ *
+ * All calls are made on the main (V8) thread.
+ */
+class SlabHeap {
+  public:
+    static const size_t kChunkSize = 64 * 1024;
+    static const size_t kMinClassSize = 16;
+    static const size_t kMaxClassSize = 8 * 1024;
+    static const int kClasses = 10; // 16 .. 8192
+    static const size_t kReportBatch = 256 * 1024;
+
+    SlabHeap();
+
+    char* Alloc(size_t length);
+    void Free(char* data, size_t length);
+
+    // Owner (Node) is gone, frees the heap now or with its last block
+    void Release();
+
+    // JS API - process.slabStats(), for the current node instance
+    static v8::Handle<v8::Value> Stats(const v8::Arguments& args);
+
+  private:
+    ~SlabHeap();
+
+    char* AllocSmall(int cls);
+    void FreeSmall(SlabChunk* chunk, char* data);
+    SlabChunk* NewChunk(int cls);
+    void FreeChunk(SlabChunk* chunk);
+    void Report(ssize_t bytes);
+    void Flush();
+
+    SlabChunk* m_partial[kClasses]; // chunks with free blocks, per class
+    size_t m_chunks[kClasses];      // chunks per class
+    size_t m_allocs[kClasses];      // allocations served per class
+    size_t m_blocks;                // live blocks, small and large
+    size_t m_used;                  // bytes handed out, rounded to the class
+    size_t m_large;                 // bytes malloc'ed for large blocks
+    size_t m_reported;              // bytes V8 knows about
+    ssize_t m_unreported;           // pending report to V8
+    bool m_released;
+};
+
+}  // namespace node
+
+#endif  // NODE_SLAB_H_
@@ -33,6 +33,7 @@ namespace node {
 using namespace v8;
 
 Persistent<FunctionTemplate> StatWatcher::constructor_template;
+std::set<StatWatcher*> StatWatcher::s_watchers;
 
 void StatWatcher::Initialize(Handle<Object> target) {
   HandleScope scope;
@@ -97,6 +98,13 @@ Handle<Value> StatWatcher::Start(const Arguments& args) {
   ev_stat_start(EV_DEFAULT_UC_ &handler->watcher_);
 
   handler->persistent_ = args[1]->IsTrue();
+  if (!handler->node_) {
+    handler->node_ = Node::GetCurrentNode();
+    s_watchers.insert(handler);
+  }
+  if (handler->node_->paused()) {
+    handler->Suspend();
+  }
 
   if (!handler->persistent_) {
     ev_unref(EV_DEFAULT_UC);
@@ -118,6 +126,12 @@ Handle<Value> StatWatcher::Stop(const Arguments& args) {
 
 
 void StatWatcher::Stop () {
+  if (suspended_) {
+    // restart so that the stop below keeps the loop refs balanced
+    suspended_ = false;
+    ev_stat_start(EV_DEFAULT_UC_ &watcher_);
+    if (!persistent_) ev_unref(EV_DEFAULT_UC);
+  }
   if (watcher_.active) {
     if (!persistent_) ev_ref(EV_DEFAULT_UC);
     ev_stat_stop(EV_DEFAULT_UC_ &watcher_);
@@ -128,4 +142,51 @@ void StatWatcher::Stop () {
 }
 
 
+void StatWatcher::Suspend() {
+  if (suspended_ || !watcher_.active) {
+    return;
+  }
+  suspendedAttr_ = watcher_.attr;
+  if (!persistent_) ev_ref(EV_DEFAULT_UC);
+  ev_stat_stop(EV_DEFAULT_UC_ &watcher_);
+  suspended_ = true;
+}
+
+
+void StatWatcher::Resume() {
+  if (!suspended_) {
+    return;
+  }
+  suspended_ = false;
+  ev_stat_start(EV_DEFAULT_UC_ &watcher_);
+  if (!persistent_) ev_unref(EV_DEFAULT_UC);
+
+  // same fields libev compares when polling
+  const ev_statdata &a = watcher_.attr, &b = suspendedAttr_;
+  if (a.st_dev != b.st_dev || a.st_ino != b.st_ino || a.st_mode != b.st_mode ||
+      a.st_nlink != b.st_nlink || a.st_uid != b.st_uid || a.st_gid != b.st_gid ||
+      a.st_rdev != b.st_rdev || a.st_size != b.st_size || a.st_atime != b.st_atime ||
+      a.st_mtime != b.st_mtime || a.st_ctime != b.st_ctime) {
+    watcher_.prev = suspendedAttr_;
+    Callback(EV_DEFAULT_UC_ &watcher_, EV_STAT);
+  }
+}
+
+
+void StatWatcher::Background(Node *node, bool background) {
+  // callbacks may stop (and delete) watchers, walk a copy
+  std::set<StatWatcher*> watchers(s_watchers);
+  for (std::set<StatWatcher*>::iterator it = watchers.begin(); it != watchers.end(); it++) {
+    if ((*it)->node_ != node || !s_watchers.count(*it)) {
+      continue;
+    }
+    if (background) {
+      (*it)->Suspend();
+    } else {
+      (*it)->Resume();
+    }
+  }
+}
+
+
 }  // namespace node
@@ -24,6 +24,7 @@
 
 #include <node.h>
 #include <ev.h>
+#include <set>
 
 namespace node {
 
@@ -32,11 +33,17 @@ class StatWatcher : ObjectWrap {
  public:
   static void Initialize(v8::Handle<v8::Object> target);
 
+  // proteus: stops polling while the node is paused. On resume a change
+  // that happened in between is reported as a single change event
+  static void Background(Node *node, bool background);
+
  protected:
   static v8::Persistent<v8::FunctionTemplate> constructor_template;
 
   StatWatcher() : ObjectWrap() {
     persistent_ = false;
+    suspended_ = false;
+    node_ = NULL;
     path_ = NULL;
     ev_init(&watcher_, StatWatcher::Callback);
     watcher_.data = this;
@@ -44,6 +51,7 @@ class StatWatcher : ObjectWrap {
 
   ~StatWatcher() {
     Stop();
+    s_watchers.erase(this);
     assert(path_ == NULL);
   }
 
@@ -55,10 +63,18 @@ class StatWatcher : ObjectWrap {
   static void Callback(EV_P_ ev_stat *watcher, int revents);
 
   void Stop();
+  void Suspend();
+  void Resume();
 
   ev_stat watcher_;
   bool persistent_;
   char *path_;
+
+  // node that started the watcher, and the stat it had when suspended
+  Node *node_;
+  bool suspended_;
+  ev_statdata suspendedAttr_;
+  static std::set<StatWatcher*> s_watchers;
 };
 
 }  // namespace node
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <node.h>
+#include <node_buffer.h>
+#include <node_base64.h>
+
+#include <ctype.h>
+#include <string.h>
+
+namespace node {
+
+using namespace v8;
+
+/**
+ * Incremental decoder behind require('string_decoder'). The bytes of a
+ * character split across writes are kept inline until the rest arrives,
+ * utf8 goes through the decoding paths of Buffer::toString('utf8') and
+ * ucs2 keeps surrogate pairs together. Other encodings have no state.
+ */
+class StringDecoder : public ObjectWrap {
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    Local<FunctionTemplate> t = FunctionTemplate::New(New);
+    t->InstanceTemplate()->SetInternalFieldCount(1);
+    t->SetClassName(String::NewSymbol("StringDecoder"));
+
+    NODE_SET_PROTOTYPE_METHOD(t, "write", Write);
+
+    target->Set(String::NewSymbol("StringDecoder"), t->GetFunction());
+  }
+
+ private:
+  StringDecoder(enum encoding encoding)
+    : ObjectWrap(), encoding_(encoding), have_(0), need_(0) {
+  }
+
+  static Handle<Value> New(const Arguments& args) {
+    HandleScope scope;
+
+    if (!args.IsConstructCall()) {
+      return ThrowException(Exception::TypeError(String::New(
+              "Use the new operator to create a StringDecoder")));
+    }
+
+    // same spelling as before: lower case, first '-' or '_' dropped
+    char name[16] = "utf8";
+    if (args[0]->IsString()) {
+      String::AsciiValue value(args[0]);
+      size_t n = 0;
+      bool dropped = false;
+      for (const char *p = *value; *p && n < sizeof(name) - 1; p++) {
+        if (!dropped && (*p == '-' || *p == '_')) {
+          dropped = true;
+          continue;
+        }
+        name[n++] = tolower(*p);
+      }
+      name[n] = '\0';
+    }
+
+    Local<String> encoding = String::New(name);
+    StringDecoder *decoder = new StringDecoder(Node::ParseEncoding(encoding, UTF8));
+    decoder->Wrap(args.This());
+    args.This()->Set(String::NewSymbol("encoding"), encoding);
+    return args.This();
+  }
+
+  // decoder.write(buffer), a Buffer or a SlowBuffer
+  static Handle<Value> Write(const Arguments& args) {
+    HandleScope scope;
+    StringDecoder *decoder = ObjectWrap::Unwrap<StringDecoder>(args.This());
+
+    if (!args[0]->IsObject()) {
+      return ThrowException(Exception::TypeError(String::New(
+              "Argument must be a Buffer")));
+    }
+    Local<Object> buffer = args[0]->ToObject();
+    const char *data = Buffer::Data(buffer);
+    size_t length = Buffer::Length(buffer);
+
+    switch (decoder->encoding_) {
+      case UTF8:
+        return scope.Close(decoder->WriteUtf8(data, length));
+      case UCS2:
+        return scope.Close(decoder->WriteUcs2(data, length));
+      case BASE64: {
+        size_t n = base64_encoded_size(length);
+        char *out = new char[n];
+        base64_encode(data, length, out);
+        Local<String> string = String::New(out, n);
+        delete [] out;
+        return scope.Close(string);
+      }
+      default:
+        return scope.Close(Node::Encode(data, length, decoder->encoding_));
+    }
+  }
+
+  // Bytes of an incomplete character at the end of data, need_ is set to
+  // the ones still missing
+  size_t Utf8Tail(const char *data, size_t length) {
+    size_t i = length >= 3 ? 3 : length;
+    for (; i > 0; i--) {
+      unsigned char c = data[length - i];
+      // 110XXXXX
+      if (i == 1 && c >> 5 == 0x06) {
+        need_ = 2 - i;
+        return i;
+      }
+      // 1110XXXX
+      if (i <= 2 && c >> 4 == 0x0E) {
+        need_ = 3 - i;
+        return i;
+      }
+      // 11110XXX
+      if (i <= 3 && c >> 3 == 0x1E) {
+        need_ = 4 - i;
+        return i;
+      }
+    }
+    return 0;
+  }
+
+  Local<String> WriteUtf8(const char *data, size_t length) {
+    HandleScope scope;
+    Local<String> head;
+
+    // complete the character left over by the last write
+    if (need_) {
+      size_t n = length < need_ ? length : need_;
+      memcpy(carry_ + have_, data, n);
+      have_ += n;
+      need_ -= n;
+      data += n;
+      length -= n;
+      if (need_) {
+        return scope.Close(String::Empty());
+      }
+      head = Buffer::Utf8String(carry_, have_);
+      have_ = 0;
+      if (!length) {
+        return scope.Close(head);
+      }
+    }
+
+    size_t tail = Utf8Tail(data, length);
+    Local<String> body = Buffer::Utf8String(data, length - tail);
+    memcpy(carry_, data + length - tail, tail);
+    have_ = tail;
+
+    if (head.IsEmpty()) {
+      return scope.Close(body);
+    }
+    return scope.Close(String::Concat(head, body));
+  }
+
+  static bool HighSurrogate(const char *unit) {
+    uint16_t c;
+    memcpy(&c, unit, 2);
+    return c >= 0xD800 && c <= 0xDBFF;
+  }
+
+  // the carry holds an odd byte or a high surrogate, with the byte
+  // after it if any
+  bool Ucs2Complete() {
+    return have_ >= 2 && !(have_ & 1) && !HighSurrogate(carry_ + have_ - 2);
+  }
+
+  static Local<String> Ucs2String(const char *data, size_t length) {
+    // the units may be unaligned within the buffer
+    if ((uintptr_t) data & 1) {
+      uint16_t *units = new uint16_t[length / 2];
+      memcpy(units, data, length & ~1);
+      Local<String> string = String::New(units, length / 2);
+      delete [] units;
+      return string;
+    }
+    return String::New((const uint16_t*) data, length / 2);
+  }
+
+  Local<String> WriteUcs2(const char *data, size_t length) {
+    HandleScope scope;
+    Local<String> head;
+
+    if (have_) {
+      while (length && have_ < sizeof(carry_) && !Ucs2Complete()) {
+        carry_[have_++] = *data++;
+        length--;
+      }
+      if (!Ucs2Complete() && have_ < sizeof(carry_)) {
+        return scope.Close(String::Empty());
+      }
+      head = Ucs2String(carry_, have_);
+      have_ = 0;
+      if (!length) {
+        return scope.Close(head);
+      }
+    }
+
+    size_t tail = length & 1;
+    if (length - tail >= 2 && HighSurrogate(data + length - tail - 2)) {
+      tail += 2;
+    }
+    Local<String> body = Ucs2String(data, length - tail);
+    memcpy(carry_, data + length - tail, tail);
+    have_ = tail;
+
+    if (head.IsEmpty()) {
+      return scope.Close(body);
+    }
+    return scope.Close(String::Concat(head, body));
+  }
+
+  enum encoding encoding_;
+  char carry_[4]; // bytes of the character split by the last write
+  size_t have_;
+  size_t need_;   // utf8 only, bytes still missing from carry_
+};
+
+}  // namespace node
+
+NODE_MODULE(node_string_decoder, node::StringDecoder::Initialize);
@@ -22,12 +22,25 @@
 #include <node.h>
 #include <node_timer.h>
 #include <assert.h>
+#include <math.h>
 
 namespace node {
 
 using namespace v8;
 
 Persistent<FunctionTemplate> Timer::constructor_template;
+std::set<Timer*> Timer::s_timers;
+ev_tstamp Timer::s_granularity = 1.;
+
+// first point of the background grid at least after seconds from now
+static ev_tstamp GridAfter(ev_tstamp after, ev_tstamp granularity) {
+  ev_tstamp now = ev_now(EV_DEFAULT_UC);
+  return ceil((now + after) / granularity) * granularity - now;
+}
+
+static ev_tstamp GridRepeat(ev_tstamp repeat, ev_tstamp granularity) {
+  return repeat > 0 ? ceil(repeat / granularity) * granularity : 0.;
+}
 
 
 static Persistent<String> timeout_symbol;
@@ -71,7 +84,7 @@ Handle<Value> Timer::RepeatGetter(Local<String> property,
   assert(timer);
   assert(property == repeat_symbol);
 
-  Local<Integer> v = Integer::New(timer->watcher_.repeat);
+  Local<Integer> v = Integer::New(timer->repeat_ >= 0 ? timer->repeat_ : timer->watcher_.repeat);
 
   return scope.Close(v);
 }
@@ -85,7 +98,12 @@ void Timer::RepeatSetter(Local<String> property,
   assert(timer);
   assert(property == repeat_symbol);
 
-  timer->watcher_.repeat = NODE_V8_UNIXTIME(value);
+  ev_tstamp repeat = NODE_V8_UNIXTIME(value);
+  if (timer->repeat_ >= 0) {
+    timer->repeat_ = repeat;
+    repeat = GridRepeat(repeat, s_granularity);
+  }
+  timer->watcher_.repeat = repeat;
 }
 
 void Timer::OnTimeout(EV_P_ ev_timer *watcher, int revents) {
@@ -120,6 +138,7 @@ void Timer::OnTimeout(EV_P_ ev_timer *watcher, int revents) {
 
 
 Timer::~Timer() {
+  s_timers.erase(this);
   ev_timer_stop(EV_DEFAULT_UC_ &watcher_);
   NODE_LOGI("%s, Timer stop (%p)",__FUNCTION__, &watcher_);
 }
@@ -149,6 +168,17 @@ Handle<Value> Timer::Start(const Arguments& args) {
 
   ev_tstamp after = NODE_V8_UNIXTIME(args[0]);
   ev_tstamp repeat = NODE_V8_UNIXTIME(args[1]);
+  if (!timer->node_) {
+    timer->node_ = Node::GetCurrentNode();
+    s_timers.insert(timer);
+  }
+  timer->repeat_ = -1.;
+  if (timer->node_->paused()) {
+    timer->repeat_ = repeat;
+    after = GridAfter(after, s_granularity);
+    repeat = GridRepeat(repeat, s_granularity);
+  }
+
   ev_timer_init(&timer->watcher_, Timer::OnTimeout, after, repeat);
   timer->watcher_.data = timer;
 
@@ -190,6 +220,10 @@ Handle<Value> Timer::Again(const Arguments& args) {
 
   if (args.Length() > 0) {
     ev_tstamp repeat = NODE_V8_UNIXTIME(args[0]);
+    if (repeat > 0 && timer->repeat_ >= 0) {
+      timer->repeat_ = repeat;
+      repeat = GridRepeat(repeat, s_granularity);
+    }
     if (repeat > 0) timer->watcher_.repeat = repeat;
   }
 
@@ -209,5 +243,52 @@ Handle<Value> Timer::Again(const Arguments& args) {
 }
 
 
+void Timer::Coalesce(ev_tstamp granularity) {
+  repeat_ = watcher_.repeat;
+  if (!ev_is_active(&watcher_)) {
+    watcher_.repeat = GridRepeat(repeat_, granularity);
+    return;
+  }
+
+  ev_tstamp remaining = ev_timer_remaining(EV_DEFAULT_UC_ &watcher_);
+  ev_timer_stop(EV_DEFAULT_UC_ &watcher_);
+  ev_timer_set(&watcher_, GridAfter(remaining, granularity), GridRepeat(repeat_, granularity));
+  ev_timer_start(EV_DEFAULT_UC_ &watcher_);
+}
+
+void Timer::Restore() {
+  ev_tstamp repeat = repeat_;
+  repeat_ = -1.;
+  if (!ev_is_active(&watcher_)) {
+    watcher_.repeat = repeat;
+    return;
+  }
+
+  // the grid only ever delays, keep the earlier of the two deadlines
+  ev_tstamp remaining = ev_timer_remaining(EV_DEFAULT_UC_ &watcher_);
+  if (repeat > 0 && repeat < remaining) {
+    remaining = repeat;
+  }
+  ev_timer_stop(EV_DEFAULT_UC_ &watcher_);
+  ev_timer_set(&watcher_, remaining, repeat);
+  ev_timer_start(EV_DEFAULT_UC_ &watcher_);
+}
+
+void Timer::Background(Node *node, bool background, ev_tstamp granularity) {
+  s_granularity = granularity;
+  for (std::set<Timer*>::iterator it = s_timers.begin(); it != s_timers.end(); it++) {
+    Timer *timer = *it;
+    if (timer->node_ != node || (timer->repeat_ >= 0) == background) {
+      continue;
+    }
+    if (background) {
+      timer->Coalesce(granularity);
+    } else {
+      timer->Restore();
+    }
+  }
+}
+
+
 }  // namespace node
 //
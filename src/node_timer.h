@@ -26,6 +26,7 @@
 #include <node_object_wrap.h>
 #include <v8.h>
 #include <ev.h>
+#include <set>
 
 namespace node {
 
@@ -33,10 +34,15 @@ class Timer : ObjectWrap {
  public:
   static void Initialize(v8::Handle<v8::Object> target);
 
+  // proteus: while a node is paused its timers fire on a grid of
+  // granularity seconds, so the page wakes up at most once per step.
+  // background false restores the original timeouts, see Node::onPause
+  static void Background(Node *node, bool background, ev_tstamp granularity);
+
  protected:
   static v8::Persistent<v8::FunctionTemplate> constructor_template;
 
-  Timer() : ObjectWrap() {
+  Timer() : ObjectWrap(), node_(0), repeat_(-1.) {
     // dummy timeout values
     ev_timer_init(&watcher_, OnTimeout, 0., 1.);
     watcher_.data = this;
@@ -57,7 +63,16 @@ class Timer : ObjectWrap {
  private:
   static void OnTimeout(EV_P_ ev_timer *watcher, int revents);
   void Stop();
+  void Coalesce(ev_tstamp granularity);
+  void Restore();
   ev_timer watcher_;
+
+  // node that started the timer
+  Node *node_;
+  // repeat asked for by js while coalesced, -1 otherwise
+  ev_tstamp repeat_;
+  static std::set<Timer*> s_timers;
+  static ev_tstamp s_granularity;
 };
 
 }  // namespace node
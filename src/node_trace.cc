@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <node.h>
+#include <node_trace.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace node {
+
+#define TRACE_MAX_ARGS 8
+#define TRACE_STR_SIZE 96
+#define TRACE_LINE_SIZE 512
+
+enum TraceArgType { TRACE_INT, TRACE_LONG, TRACE_LLONG, TRACE_DOUBLE, TRACE_PTR, TRACE_STR };
+
+union TraceArg {
+  long long i;
+  double d;
+  const void* p;
+};
+
+struct TraceRecord {
+  // 0 while the record is being written
+  volatile unsigned int seq;
+  unsigned char prio;
+  unsigned char nargs;
+  unsigned char types[TRACE_MAX_ARGS];
+  int tid;
+  uint64_t time;
+  const char* tag;
+  const char* fmt;
+  TraceArg args[TRACE_MAX_ARGS];
+  // %s arguments, copied back to back, args[].p points in here
+  char str[TRACE_STR_SIZE];
+};
+
+struct TraceRing {
+  TraceRing* next;
+  // set while a thread owns the ring, cleared when it exits
+  volatile int claimed;
+  int tid;
+  unsigned int head;
+  TraceRecord* records;
+};
+
+unsigned int NodeTrace::s_entries = 0;
+static TraceRing* volatile s_rings = 0;
+static pthread_key_t s_ringKey;
+static pthread_once_t s_ringKeyOnce = PTHREAD_ONCE_INIT;
+
+static void ReleaseRing(void* ring) {
+  static_cast<TraceRing*>(ring)->claimed = 0;
+}
+
+static void CreateRingKey() {
+  pthread_key_create(&s_ringKey, ReleaseRing);
+}
+
+static TraceRing* CurrentRing(unsigned int entries) {
+  TraceRing* ring = static_cast<TraceRing*>(pthread_getspecific(s_ringKey));
+  if (ring) {
+    return ring;
+  }
+
+  // reuse the ring of a thread that is gone, a ring is never unlinked
+  for (ring = s_rings; ring; ring = ring->next) {
+    if (__sync_bool_compare_and_swap(&ring->claimed, 0, 1)) {
+      break;
+    }
+  }
+
+  if (!ring) {
+    ring = static_cast<TraceRing*>(calloc(1, sizeof(TraceRing)));
+    TraceRecord* records = static_cast<TraceRecord*>(calloc(entries, sizeof(TraceRecord)));
+    if (!ring || !records) {
+      free(ring);
+      free(records);
+      return 0;
+    }
+    ring->records = records;
+    ring->claimed = 1;
+
+    TraceRing* head;
+    do {
+      head = s_rings;
+      ring->next = head;
+    } while (!__sync_bool_compare_and_swap(&s_rings, head, ring));
+  }
+
+  ring->tid = gettid();
+  pthread_setspecific(s_ringKey, ring);
+  return ring;
+}
+
+void NodeTrace::Initialize(unsigned int entries) {
+  unsigned int size = 1;
+  while (size < entries) {
+    size <<= 1;
+  }
+  pthread_once(&s_ringKeyOnce, CreateRingKey);
+  s_entries = entries ? size : 0;
+}
+
+// Walks fmt the way printf does and calls cb for each conversion with the
+// spec (from '%' up to the conversion character), the number of '*' in it
+// and the type of the argument it consumes.
+template <typename T>
+static bool WalkFormat(const char* fmt, T& cb) {
+  for (const char* p = fmt; *p; p++) {
+    if (*p != '%') {
+      continue;
+    }
+    const char* spec = p++;
+    if (*p == '%') {
+      continue;
+    }
+
+    int stars = 0;
+    while (*p && strchr("-+ #0123456789.*", *p)) {
+      stars += *p == '*';
+      p++;
+    }
+
+    int longs = 0;
+    while (*p && strchr("hlLqjzt", *p)) {
+      longs += (*p == 'l' || *p == 'z' || *p == 't') ? 1 : (*p == 'q' || *p == 'L' || *p == 'j') ? 2 : 0;
+      p++;
+    }
+
+    TraceArgType type;
+    switch (*p) {
+      case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+        type = longs >= 2 ? TRACE_LLONG : longs ? TRACE_LONG : TRACE_INT;
+        break;
+      case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+        type = TRACE_DOUBLE;
+        break;
+      case 's':
+        type = TRACE_STR;
+        break;
+      case 'p': case 'n':
+        type = TRACE_PTR;
+        break;
+      default:
+        return false;
+    }
+    if (!cb(spec, p + 1 - spec, stars, type)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// pulls the arguments of each conversion off the va_list into the record
+struct TraceCollector {
+  TraceRecord* rec;
+  va_list* ap;
+  size_t strUsed;
+
+  bool add(TraceArgType type) {
+    if (rec->nargs == TRACE_MAX_ARGS) {
+      return false;
+    }
+    TraceArg& arg = rec->args[rec->nargs];
+    switch (type) {
+      case TRACE_INT: arg.i = va_arg(*ap, int); break;
+      case TRACE_LONG: arg.i = va_arg(*ap, long); break;
+      case TRACE_LLONG: arg.i = va_arg(*ap, long long); break;
+      case TRACE_DOUBLE: arg.d = va_arg(*ap, double); break;
+      case TRACE_PTR: arg.p = va_arg(*ap, void*); break;
+      case TRACE_STR: {
+        const char* s = va_arg(*ap, const char*);
+        if (!s) {
+          s = "(null)";
+        }
+        size_t len = strlen(s);
+        size_t room = TRACE_STR_SIZE - strUsed - 1;
+        len = len < room ? len : room;
+        memcpy(rec->str + strUsed, s, len);
+        rec->str[strUsed + len] = 0;
+        arg.p = rec->str + strUsed;
+        strUsed += len + (strUsed + len + 1 < TRACE_STR_SIZE ? 1 : 0);
+        break;
+      }
+    }
+    rec->types[rec->nargs++] = type;
+    return true;
+  }
+
+  bool operator()(const char* spec, size_t len, int stars, TraceArgType type) {
+    for (int i = 0; i < stars; i++) {
+      if (!add(TRACE_INT)) {
+        return false;
+      }
+    }
+    return add(type);
+  }
+};
+
+void NodeTrace::Record(int prio, const char* tag, const char* fmt, va_list ap) {
+  TraceRing* ring = CurrentRing(s_entries);
+  if (!ring) {
+    return;
+  }
+
+  unsigned int seq = ++ring->head;
+  TraceRecord* rec = &ring->records[seq & (s_entries - 1)];
+  rec->seq = 0;
+  __sync_synchronize();
+
+  rec->prio = prio;
+  rec->nargs = 0;
+  rec->tid = ring->tid;
+  rec->time = uv_hrtime();
+  rec->tag = tag;
+  rec->fmt = fmt;
+
+  va_list args;
+  va_copy(args, ap);
+  TraceCollector collector = { rec, &args, 0 };
+  WalkFormat(fmt, collector);
+  va_end(args);
+
+  __sync_synchronize();
+  rec->seq = seq;
+}
+
+template <typename T>
+static int FormatArg(char* buf, size_t size, const char* spec, int stars, const int* star, T value) {
+  switch (stars) {
+    case 0: return snprintf(buf, size, spec, value);
+    case 1: return snprintf(buf, size, spec, star[0], value);
+    default: return snprintf(buf, size, spec, star[0], star[1], value);
+  }
+}
+
+// formats a record back into a line, a conversion at a time
+struct TraceFormatter {
+  const TraceRecord* rec;
+  char* line;
+  size_t pos;
+  const char* from;
+  unsigned int arg;
+
+  void append(const char* s, size_t len) {
+    size_t room = TRACE_LINE_SIZE - pos - 1;
+    len = len < room ? len : room;
+    memcpy(line + pos, s, len);
+    pos += len;
+    line[pos] = 0;
+  }
+
+  bool operator()(const char* spec, size_t len, int stars, TraceArgType type) {
+    append(from, spec - from);
+    from = spec + len;
+    if (arg + stars >= rec->nargs || stars > 2) {
+      append("...", 3);
+      return false;
+    }
+
+    int star[2] = { 0, 0 };
+    for (int i = 0; i < stars; i++) {
+      star[i] = (int) rec->args[arg++].i;
+    }
+
+    char conv[32];
+    if (len >= sizeof(conv)) {
+      return false;
+    }
+    memcpy(conv, spec, len);
+    conv[len] = 0;
+
+    const TraceArg& a = rec->args[arg++];
+    char* out = line + pos;
+    size_t room = TRACE_LINE_SIZE - pos;
+    int n = 0;
+    switch (type) {
+      case TRACE_INT: n = FormatArg(out, room, conv, stars, star, (int) a.i); break;
+      case TRACE_LONG: n = FormatArg(out, room, conv, stars, star, (long) a.i); break;
+      case TRACE_LLONG: n = FormatArg(out, room, conv, stars, star, a.i); break;
+      case TRACE_DOUBLE: n = FormatArg(out, room, conv, stars, star, a.d); break;
+      case TRACE_STR: n = FormatArg(out, room, conv, stars, star, (const char*) a.p); break;
+      case TRACE_PTR:
+        // %n would write through a stale pointer
+        n = conv[len - 1] == 'n' ? 0 : FormatArg(out, room, conv, stars, star, a.p);
+        break;
+    }
+    pos += n < 0 ? 0 : ((size_t) n < room ? n : room - 1);
+    return true;
+  }
+};
+
+void NodeTrace::Dump(void (*out)(const char* line, void* data), void* data) {
+  if (!s_entries) {
+    return;
+  }
+
+  static const char PRIO[] = "U_VDIWEFS";
+  char line[TRACE_LINE_SIZE];
+  for (TraceRing* ring = s_rings; ring; ring = ring->next) {
+    unsigned int head = ring->head;
+    unsigned int count = head < s_entries ? head : s_entries;
+    for (unsigned int seq = head - count + 1; seq != head + 1; seq++) {
+      const TraceRecord* slot = &ring->records[seq & (s_entries - 1)];
+      if (slot->seq != seq) {
+        // overwritten or being written while we dump
+        continue;
+      }
+
+      // the writer doesn't wait for us, format from a copy and drop it if
+      // the record was reused meanwhile
+      TraceRecord copy;
+      __sync_synchronize();
+      memcpy(&copy, slot, sizeof(copy));
+      __sync_synchronize();
+      if (slot->seq != seq || copy.nargs > TRACE_MAX_ARGS) {
+        continue;
+      }
+      for (unsigned int i = 0; i < copy.nargs; i++) {
+        if (copy.types[i] == TRACE_STR) {
+          copy.args[i].p = copy.str + ((const char*) copy.args[i].p - slot->str);
+        }
+      }
+      const TraceRecord* rec = &copy;
+
+      int n = snprintf(line, sizeof(line), "T%d %.3f %c/%s: ", rec->tid, rec->time / 1e6,
+          PRIO[rec->prio < sizeof(PRIO) - 1 ? rec->prio : 0], rec->tag);
+      TraceFormatter formatter = { rec, line, n < 0 ? 0 : (size_t) n, rec->fmt, 0 };
+      if (WalkFormat(rec->fmt, formatter)) {
+        formatter.append(formatter.from, strlen(formatter.from));
+      }
+      out(line, data);
+    }
+  }
+}
+
+}  // namespace node
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NODE_TRACE_H_
+#define NODE_TRACE_H_
+
+#include <stdarg.h>
+#include <stdint.h>
+
+namespace node {
+
+/**
+ * Binary trace of the DAPILog messages, one ring per thread.
+ *
+ * A record keeps the priority, the tag and format pointers and the raw
+ * arguments (strings are copied), formatting only happens when the trace
+ * is dumped. Writing needs no lock, each thread owns its ring. Rings of
+ * exited threads are reused by new ones, so the eio pool doesn't grow the
+ * trace. Tags and formats have to be string literals, as with the
+ * NODE_LOG macros.
+ */
+class NodeTrace {
+  public:
+    // entries per thread, rounded up to a power of 2
+    static void Initialize(unsigned int entries);
+    static bool enabled() { return s_entries != 0; }
+
+    static void Record(int prio, const char* tag, const char* fmt, va_list ap);
+
+    // formats the records of every ring, oldest first, and hands the lines
+    // to out. Also called from the crash handler, so no allocation
+    static void Dump(void (*out)(const char* line, void* data), void* data);
+
+  private:
+    static unsigned int s_entries;
+};
+
+}  // namespace node
+
+#endif  // NODE_TRACE_H_
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <node_utf8.h>
+#include <node_cpu.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define NODE_UTF8_SSE2
+#endif
+
+namespace node {
+
+// no blocks, the scalar loops do it all
+static size_t scalar_ascii(const uint8_t *src, size_t len) {
+  return 0;
+}
+
+static size_t scalar_widen(const uint8_t *src, size_t len, uint16_t *dst) {
+  return 0;
+}
+
+static size_t scalar_narrow(const uint16_t *src, size_t len, uint8_t *dst) {
+  return 0;
+}
+
+static const Utf8Kernels s_scalar = { "scalar", scalar_ascii, scalar_widen, scalar_narrow };
+
+
+#ifdef NODE_UTF8_SSE2
+
+#define SSE2 __attribute__((target("sse2")))
+
+SSE2 static size_t sse2_ascii(const uint8_t *src, size_t len) {
+  const uint8_t *start = src;
+  while (len >= 16) {
+    __m128i in = _mm_loadu_si128((const __m128i*) src);
+    if (_mm_movemask_epi8(in)) {
+      break;
+    }
+    src += 16;
+    len -= 16;
+  }
+  return src - start;
+}
+
+SSE2 static size_t sse2_widen(const uint8_t *src, size_t len, uint16_t *dst) {
+  const uint8_t *start = src;
+  const __m128i zero = _mm_setzero_si128();
+  while (len >= 16) {
+    __m128i in = _mm_loadu_si128((const __m128i*) src);
+    if (_mm_movemask_epi8(in)) {
+      break;
+    }
+    _mm_storeu_si128((__m128i*) dst, _mm_unpacklo_epi8(in, zero));
+    _mm_storeu_si128((__m128i*) (dst + 8), _mm_unpackhi_epi8(in, zero));
+    src += 16;
+    dst += 16;
+    len -= 16;
+  }
+  return src - start;
+}
+
+SSE2 static size_t sse2_narrow(const uint16_t *src, size_t len, uint8_t *dst) {
+  const uint16_t *start = src;
+  const __m128i high = _mm_set1_epi16((short) 0xff80);
+  while (len >= 16) {
+    __m128i a = _mm_loadu_si128((const __m128i*) src);
+    __m128i b = _mm_loadu_si128((const __m128i*) (src + 8));
+    __m128i any = _mm_and_si128(_mm_or_si128(a, b), high);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(any, _mm_setzero_si128())) != 0xffff) {
+      break;
+    }
+    _mm_storeu_si128((__m128i*) dst, _mm_packus_epi16(a, b));
+    src += 16;
+    dst += 16;
+    len -= 16;
+  }
+  return src - start;
+}
+
+static const Utf8Kernels s_sse2 = { "sse2", sse2_ascii, sse2_widen, sse2_narrow };
+
+#undef SSE2
+
+#endif  // NODE_UTF8_SSE2
+
+
+static const Utf8Kernels *s_kernels;
+
+// Picked once, racing threads pick the same kernels
+static const Utf8Kernels* Kernels() {
+  if (s_kernels) {
+    return s_kernels;
+  }
+
+  const Utf8Kernels *kernels = &s_scalar;
+  if (cpu_simd_enabled()) {
+#ifdef NODE_UTF8_SSE2
+    if (cpu_has_sse2()) {
+      kernels = &s_sse2;
+    }
+#endif
+    if (utf8_neon_kernels()) {
+      kernels = utf8_neon_kernels();
+    }
+  }
+  s_kernels = kernels;
+  return s_kernels;
+}
+
+const char* utf8_impl() {
+  return Kernels()->name;
+}
+
+
+size_t utf8_ascii_prefix(const char *src, size_t len) {
+  const uint8_t *in = (const uint8_t*) src;
+  size_t i = Kernels()->ascii(in, len);
+  while (i < len && in[i] < 0x80) {
+    i++;
+  }
+  return i;
+}
+
+
+static inline bool continuation(uint8_t c) {
+  return (c & 0xc0) == 0x80;
+}
+
+ssize_t utf8_decode(const char *src, size_t len, uint16_t *dst) {
+  const Utf8Kernels *kernels = Kernels();
+  const uint8_t *in = (const uint8_t*) src;
+  uint16_t *out = dst;
+  size_t i = 0;
+
+  while (i < len) {
+    // ASCII runs a block at a time
+    size_t n = kernels->widen(in + i, len - i, out);
+    i += n;
+    out += n;
+    if (i >= len) {
+      break;
+    }
+
+    uint8_t c = in[i];
+    if (c < 0x80) {
+      *out++ = c;
+      i++;
+    } else if (c >= 0xc2 && c <= 0xdf) {
+      if (i + 1 >= len || !continuation(in[i + 1])) {
+        return -1;
+      }
+      *out++ = ((c & 0x1f) << 6) | (in[i + 1] & 0x3f);
+      i += 2;
+    } else if (c >= 0xe0 && c <= 0xef) {
+      if (i + 2 >= len || !continuation(in[i + 1]) || !continuation(in[i + 2])) {
+        return -1;
+      }
+      // overlong forms and surrogates
+      if ((c == 0xe0 && in[i + 1] < 0xa0) || (c == 0xed && in[i + 1] >= 0xa0)) {
+        return -1;
+      }
+      *out++ = ((c & 0x0f) << 12) | ((in[i + 1] & 0x3f) << 6) | (in[i + 2] & 0x3f);
+      i += 3;
+    } else if (c >= 0xf0 && c <= 0xf4) {
+      if (i + 3 >= len || !continuation(in[i + 1]) || !continuation(in[i + 2]) ||
+          !continuation(in[i + 3])) {
+        return -1;
+      }
+      // overlong forms and past U+10FFFF
+      if ((c == 0xf0 && in[i + 1] < 0x90) || (c == 0xf4 && in[i + 1] >= 0x90)) {
+        return -1;
+      }
+      *out++ = 0xfffd;
+      i += 4;
+    } else {
+      return -1;
+    }
+  }
+  return out - dst;
+}
+
+
+size_t utf8_encode(const uint16_t *src, size_t len, char *dst, size_t capacity,
+                   size_t *consumed) {
+  const Utf8Kernels *kernels = Kernels();
+  uint8_t *out = (uint8_t*) dst;
+  size_t pos = 0;
+  size_t i = 0;
+
+  while (i < len && pos < capacity) {
+    // ASCII runs a block at a time
+    size_t room = capacity - pos < len - i ? capacity - pos : len - i;
+    size_t n = kernels->narrow(src + i, room, out + pos);
+    i += n;
+    pos += n;
+    if (i >= len || pos >= capacity) {
+      break;
+    }
+
+    uint16_t c = src[i];
+    if (c < 0x80) {
+      out[pos++] = c;
+    } else if (c < 0x800) {
+      if (pos + 2 > capacity) {
+        break;
+      }
+      out[pos++] = 0xc0 | (c >> 6);
+      out[pos++] = 0x80 | (c & 0x3f);
+    } else {
+      if (pos + 3 > capacity) {
+        break;
+      }
+      out[pos++] = 0xe0 | (c >> 12);
+      out[pos++] = 0x80 | ((c >> 6) & 0x3f);
+      out[pos++] = 0x80 | (c & 0x3f);
+    }
+    i++;
+  }
+
+  *consumed = i;
+  return pos;
+}
+
+}  // namespace node
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NODE_UTF8_H_
+#define NODE_UTF8_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace node {
+
+/**
+ * Vectorized kernels for the 7-bit ASCII runs, whole blocks only. They
+ * return the number of input units consumed and stop at the first block
+ * holding anything else.
+ */
+struct Utf8Kernels {
+  const char *name;
+  size_t (*ascii)(const uint8_t *src, size_t len);
+  size_t (*widen)(const uint8_t *src, size_t len, uint16_t *dst);
+  size_t (*narrow)(const uint16_t *src, size_t len, uint8_t *dst);
+};
+
+// NEON kernels, NULL if the cpu or the build has no NEON
+const Utf8Kernels* utf8_neon_kernels();
+
+// length of the 7-bit ASCII prefix of src
+size_t utf8_ascii_prefix(const char *src, size_t len);
+
+/**
+ * Validates and decodes src to UTF-16 into dst, which holds len units.
+ * Returns the units written, or -1 for invalid UTF-8 (overlong forms,
+ * surrogates, truncated sequences). Like v8 only the BMP is supported,
+ * a 4 byte sequence decodes to U+FFFD.
+ */
+ssize_t utf8_decode(const char *src, size_t len, uint16_t *dst);
+
+/**
+ * Encodes UTF-16 units into at most capacity bytes, whole characters
+ * only. Every unit is encoded on its own, surrogates included, which is
+ * what String::WriteUtf8 and String::Utf8Length do. *consumed is set to
+ * the units encoded, the bytes written are returned.
+ */
+size_t utf8_encode(const uint16_t *src, size_t len, char *dst, size_t capacity,
+                   size_t *consumed);
+
+// name of the kernels in use: "neon", "sse2" or "scalar"
+const char* utf8_impl();
+
+}  // namespace node
+
+#endif  // NODE_UTF8_H_
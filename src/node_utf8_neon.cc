@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Built with NEON enabled on ARM (see Android.libnode.mk), only used once
+// the cpu is known to have it. Empty on other targets.
+
+#include <node_utf8.h>
+#include <node_cpu.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+namespace node {
+
+static inline bool any(uint8x16_t v) {
+  uint64x2_t v64 = vreinterpretq_u64_u8(v);
+  return vgetq_lane_u64(v64, 0) | vgetq_lane_u64(v64, 1);
+}
+
+static size_t neon_ascii(const uint8_t *src, size_t len) {
+  const uint8_t *start = src;
+  while (len >= 16) {
+    if (any(vandq_u8(vld1q_u8(src), vdupq_n_u8(0x80)))) {
+      break;
+    }
+    src += 16;
+    len -= 16;
+  }
+  return src - start;
+}
+
+static size_t neon_widen(const uint8_t *src, size_t len, uint16_t *dst) {
+  const uint8_t *start = src;
+  while (len >= 16) {
+    uint8x16_t in = vld1q_u8(src);
+    if (any(vandq_u8(in, vdupq_n_u8(0x80)))) {
+      break;
+    }
+    vst1q_u16(dst, vmovl_u8(vget_low_u8(in)));
+    vst1q_u16(dst + 8, vmovl_u8(vget_high_u8(in)));
+    src += 16;
+    dst += 16;
+    len -= 16;
+  }
+  return src - start;
+}
+
+static size_t neon_narrow(const uint16_t *src, size_t len, uint8_t *dst) {
+  const uint16_t *start = src;
+  while (len >= 16) {
+    uint16x8_t a = vld1q_u16(src);
+    uint16x8_t b = vld1q_u16(src + 8);
+    uint16x8_t high = vandq_u16(vorrq_u16(a, b), vdupq_n_u16(0xff80));
+    if (any(vreinterpretq_u8_u16(high))) {
+      break;
+    }
+    vst1q_u8(dst, vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+    src += 16;
+    dst += 16;
+    len -= 16;
+  }
+  return src - start;
+}
+
+static const Utf8Kernels s_neon = { "neon", neon_ascii, neon_widen, neon_narrow };
+
+const Utf8Kernels* utf8_neon_kernels() {
+  return cpu_has_neon() ? &s_neon : NULL;
+}
+
+}  // namespace node
+
+#else
+
+namespace node {
+
+const Utf8Kernels* utf8_neon_kernels() {
+  return NULL;
+}
+
+}  // namespace node
+
+#endif
@@ -1,8 +1,8 @@
 #include <node.h>
 #include <node_buffer.h>
+#include <node_read_pool.h>
 
-#define SLAB_SIZE (1024 * 1024)
-#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define WRITEV_STACK_BUFS 16
 
 // Rules:
 //
@@ -40,11 +40,9 @@ namespace node {
 using namespace v8;
 
 static Persistent<Function> constructor;
-static size_t slab_used;
-static uv_tcp_t* handle_that_last_alloced;
 
-static Persistent<String> slab_sym;
 static Persistent<String> buffer_sym;
+static Persistent<String> storage_sym;
 static Persistent<String> write_queue_size_sym;
 
 class TCPWrap;
@@ -84,6 +82,8 @@ class TCPWrap {
     NODE_SET_PROTOTYPE_METHOD(t, "readStart", ReadStart);
     NODE_SET_PROTOTYPE_METHOD(t, "readStop", ReadStop);
     NODE_SET_PROTOTYPE_METHOD(t, "write", Write);
+    NODE_SET_PROTOTYPE_METHOD(t, "writev", Writev);
+    NODE_SET_PROTOTYPE_METHOD(t, "sendFile", SendFile);
     NODE_SET_PROTOTYPE_METHOD(t, "connect", Connect);
     NODE_SET_PROTOTYPE_METHOD(t, "shutdown", Shutdown);
     NODE_SET_PROTOTYPE_METHOD(t, "close", Close);
@@ -92,8 +92,8 @@ class TCPWrap {
 
     constructor = Persistent<Function>::New(t->GetFunction());
 
-    slab_sym = Persistent<String>::New(String::NewSymbol("slab"));
     buffer_sym = Persistent<String>::New(String::NewSymbol("buffer"));
+    storage_sym = Persistent<String>::New(String::NewSymbol("storage"));
     write_queue_size_sym =
       Persistent<String>::New(String::NewSymbol("writeQueueSize"));
 
@@ -124,11 +124,16 @@ class TCPWrap {
     object_ = v8::Persistent<v8::Object>::New(object);
     object_->SetPointerInInternalField(0, this);
 
+    // The read buffers of the context the handle lives in.
+    read_pool_ = ReadPool::ForContext();
+    read_hint_ = 0;
+
     UpdateWriteQueueSize();
   }
 
   ~TCPWrap() {
     assert(object_.IsEmpty());
+    read_pool_->Unref();
   }
 
   // Free the C++ object on the close callback.
@@ -256,56 +261,20 @@ class TCPWrap {
     return scope.Close(Integer::New(r));
   }
 
-  static inline char* NewSlab(Handle<Object> global, Handle<Object> wrap_obj) {
-    Buffer* b = Buffer::New(SLAB_SIZE);
-    global->SetHiddenValue(slab_sym, b->handle_);
-    assert(Buffer::Length(b) == SLAB_SIZE);
-    slab_used = 0;
-    wrap_obj->SetHiddenValue(slab_sym, b->handle_);
-    return Buffer::Data(b);
-  }
-
   static uv_buf_t OnAlloc(uv_stream_t* handle, size_t suggested_size) {
     HandleScope scope;
 
     TCPWrap* wrap = static_cast<TCPWrap*>(handle->data);
     assert(&wrap->handle_ == (uv_tcp_t*)handle);
 
-    char* slab = NULL;
-
     // proteus: test-tcp-wrap-listen.js
     Context::Scope context(wrap->object_->CreationContext());
     NODE_ASSERT(Context::InContext());
 
-    Handle<Object> global = Context::GetCurrent()->Global();
-    Local<Value> slab_v = global->GetHiddenValue(slab_sym);
-
-    if (slab_v.IsEmpty()) {
-      // No slab currently. Create a new one.
-      slab = NewSlab(global, wrap->object_);
-    } else {
-      // Use existing slab.
-      Local<Object> slab_obj = slab_v->ToObject();
-      slab = Buffer::Data(slab_obj);
-      assert(Buffer::Length(slab_obj) == SLAB_SIZE);
-      assert(SLAB_SIZE >= slab_used);
-
-      // If less than 64kb is remaining on the slab allocate a new one.
-      if (SLAB_SIZE - slab_used < 64 * 1024) {
-        slab = NewSlab(global, wrap->object_);
-      } else {
-        wrap->object_->SetHiddenValue(slab_sym, slab_obj);
-      }
-    }
-
-    uv_buf_t buf;
-    buf.base = slab + slab_used;
-    buf.len = MIN(SLAB_SIZE - slab_used, suggested_size);
-
-    wrap->slab_offset_ = slab_used;
-    slab_used += buf.len;
-
-    handle_that_last_alloced = (uv_tcp_t*)handle;
+    // Sized after what this handle read lately rather than suggested_size.
+    uv_buf_t buf = wrap->read_pool_->Alloc(
+        ReadPool::ReserveSize(wrap->read_hint_, suggested_size));
+    assert(buf.base);
 
     return buf;
   }
@@ -324,15 +293,9 @@ class TCPWrap {
     Context::Scope context(wrap->object_->CreationContext());
     NODE_ASSERT(Context::InContext());
 
-    // Remove the reference to the slab to avoid memory leaks;
-    Local<Value> slab_v = wrap->object_->GetHiddenValue(slab_sym);
-    wrap->object_->SetHiddenValue(slab_sym, v8::Null());
-
     if (nread < 0)  {
       // EOF or Error
-      if (handle_that_last_alloced == (uv_tcp_t*)handle) {
-        slab_used -= buf.len;
-      }
+      wrap->read_pool_->Release(buf);
 
       SetErrno(uv_last_error().code);
       Node::MakeCallback(wrap->object_, "onread", 0, NULL);
@@ -341,18 +304,22 @@ class TCPWrap {
 
     assert(nread <= buf.len);
 
-    if (handle_that_last_alloced == (uv_tcp_t*)handle) {
-      slab_used -= (buf.len - nread);
+    if (nread == 0) {
+      // EAGAIN
+      wrap->read_pool_->Release(buf);
+      return;
     }
 
-    if (nread > 0) {
-      Local<Value> argv[3] = {
-        slab_v,
-        Integer::New(wrap->slab_offset_),
-        Integer::New(nread)
-      };
-      Node::MakeCallback(wrap->object_, "onread", 3, argv);
-    }
+    size_t offset;
+    Local<Object> buffer = wrap->read_pool_->Claim(buf, nread, &offset);
+    ReadPool::Update(&wrap->read_hint_, nread, buf.len);
+
+    Local<Value> argv[3] = {
+      buffer,
+      Integer::NewFromUnsigned(offset),
+      Integer::New(nread)
+    };
+    Node::MakeCallback(wrap->object_, "onread", 3, argv);
   }
 
   // TODO: share me?
@@ -449,6 +416,146 @@ class TCPWrap {
     }
   }
 
+  // handle.sendFile(fd, offset, length)
+  //
+  // Queues length bytes of the file fd from offset behind the writes before
+  // it, see uv_sendfile(). Completes like write(); fd must stay open until
+  // then.
+  static Handle<Value> SendFile(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    int fd = args[0]->Int32Value();
+    int64_t offset = args[1]->IntegerValue();
+    int64_t length = args[2]->IntegerValue();
+
+    if (fd < 0 || offset < 0 || length < 0) {
+      SetErrno(UV_EINVAL);
+      return scope.Close(v8::Null());
+    }
+
+    ReqWrap* req_wrap = new ReqWrap((uv_handle_t*) &wrap->handle_,
+                                    (void*)AfterWrite);
+
+    int r = uv_sendfile(&req_wrap->req_, fd, offset, length);
+
+    wrap->UpdateWriteQueueSize();
+
+    if (r) {
+      SetErrno(uv_last_error().code);
+      delete req_wrap;
+      return scope.Close(v8::Null());
+    } else {
+      return scope.Close(req_wrap->object_);
+    }
+  }
+
+  // Encoding of chunk i: one name for every string chunk or an array of
+  // names in step with the chunks. utf8 if missing.
+  static enum encoding ChunkEncoding(Handle<Value> encodings, uint32_t i) {
+    if (encodings->IsArray()) {
+      return Node::ParseEncoding(Handle<Array>::Cast(encodings)->Get(i), UTF8);
+    }
+    return Node::ParseEncoding(encodings, UTF8);
+  }
+
+  // handle.writev(chunks, [encodings])
+  //
+  // Submits an array of Buffers and strings as a single write request. The
+  // strings are encoded back to back into one storage buffer; lib/net_uv.js
+  // turns ucs2 and base64 strings into Buffers first.
+  static Handle<Value> Writev(const Arguments& args) {
+    HandleScope scope;
+
+    UNWRAP
+
+    assert(args[0]->IsArray());
+    Local<Array> chunks = Local<Array>::Cast(args[0]);
+    Local<Value> encodings = args[1];
+    uint32_t count = chunks->Length();
+
+    if (count == 0) {
+      SetErrno(UV_EINVAL);
+      return scope.Close(v8::Null());
+    }
+
+    // First pass sizes the strings.
+    size_t storage_size = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      Local<Value> chunk = chunks->Get(i);
+      if (Buffer::HasInstance(chunk)) continue;
+      enum encoding enc = ChunkEncoding(encodings, i);
+      assert(enc != UCS2 && enc != BASE64);
+      ssize_t len = Node::DecodeBytes(chunk, enc);
+      if (len < 0) {
+        SetErrno(UV_EINVAL);
+        return scope.Close(v8::Null());
+      }
+      storage_size += len;
+    }
+
+    ReqWrap* req_wrap = new ReqWrap((uv_handle_t*) &wrap->handle_,
+                                    (void*)AfterWrite);
+
+    req_wrap->object_->SetHiddenValue(buffer_sym, chunks);
+
+    char* storage = NULL;
+    if (storage_size > 0) {
+      Buffer* b = Buffer::New(storage_size);
+      req_wrap->object_->SetHiddenValue(storage_sym, b->handle_);
+      storage = Buffer::Data(b);
+    }
+
+    uv_buf_t bufs_stack[WRITEV_STACK_BUFS];
+    uv_buf_t* bufs = bufs_stack;
+    if (count > WRITEV_STACK_BUFS) {
+      bufs = new uv_buf_t[count];
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+      Local<Value> chunk = chunks->Get(i);
+      if (Buffer::HasInstance(chunk)) {
+        Local<Object> buffer_obj = chunk->ToObject();
+        bufs[i].base = Buffer::Data(buffer_obj);
+        bufs[i].len = Buffer::Length(buffer_obj);
+      } else {
+        enum encoding enc = ChunkEncoding(encodings, i);
+        size_t len = Node::DecodeBytes(chunk, enc);
+        ssize_t written = Node::DecodeWrite(storage, len, chunk, enc);
+        if (written < 0) {
+          // e.g. a bad hex digit, queue nothing
+          if (bufs != bufs_stack) {
+            delete [] bufs;
+          }
+          delete req_wrap;
+          SetErrno(UV_EINVAL);
+          return scope.Close(v8::Null());
+        }
+        bufs[i].base = storage;
+        bufs[i].len = written;
+        storage += len;
+      }
+    }
+
+    // uv_write copies the buf array, the data stays referenced by req_wrap.
+    int r = uv_write(&req_wrap->req_, bufs, count);
+
+    if (bufs != bufs_stack) {
+      delete [] bufs;
+    }
+
+    wrap->UpdateWriteQueueSize();
+
+    if (r) {
+      SetErrno(uv_last_error().code);
+      delete req_wrap;
+      return scope.Close(v8::Null());
+    } else {
+      return scope.Close(req_wrap->object_);
+    }
+  }
+
   static void AfterConnect(uv_req_t* req, int status) {
     ReqWrap* req_wrap = (ReqWrap*) req->data;
     TCPWrap* wrap = (TCPWrap*) req->handle->data;
@@ -572,7 +679,8 @@ class TCPWrap {
 
   uv_tcp_t handle_;
   Persistent<Object> object_;
-  size_t slab_offset_;
+  ReadPool* read_pool_;
+  size_t read_hint_; // recent read size, see ReadPool::Update
   friend class ReqWrap;
 };
 
@@ -1,5 +1,8 @@
 #include <node.h>
 
+#include <stdint.h>
+#include <vector>
+
 // Rules:
 //
 // - Do not throw from handle methods. Set errno.
@@ -222,6 +225,441 @@ class TimerWrap {
 };
 
 
+#define WHEEL_UNWRAP \
+  assert(!args.Holder().IsEmpty()); \
+  assert(args.Holder()->InternalFieldCount() > 0); \
+  TimerWheel* wheel =  \
+      static_cast<TimerWheel*>(args.Holder()->GetPointerFromInternalField(0)); \
+  if (!wheel) { \
+    SetErrno(UV_EBADF); \
+    return scope.Close(Integer::New(-1)); \
+  }
+
+// A hierarchical timer wheel for all the timers of one context (see
+// lib/timers_uv.js), on a single uv timer.
+//
+// Timers are numbered entries, JS keeps the id to object mapping, so adding,
+// resetting and removing one is O(1) and needs no handle per timer. Time is
+// counted in milliseconds. Level k has kSlots slots of kSlots^k ms each; a
+// timer sits in the lowest level that reaches its expiry and moves down a
+// level (cascades) when the wheel below comes round to it, timers beyond
+// the top level wait in its last slot. The uv timer is only started for the
+// next occupied slot or cascade, never to tick through empty ones.
+//
+// Expired entries are handed to wheel.ontimeout(ids) in one call and their
+// ids are reused only after it returns.
+class TimerWheel {
+ public:
+  static void Initialize(Handle<Object> target) {
+    HandleScope scope;
+
+    Local<FunctionTemplate> constructor = FunctionTemplate::New(New);
+    constructor->InstanceTemplate()->SetInternalFieldCount(1);
+    constructor->SetClassName(String::NewSymbol("TimerWheel"));
+
+    NODE_SET_PROTOTYPE_METHOD(constructor, "add", Add);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "reset", Reset);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "remove", Remove);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "stats", Stats);
+    NODE_SET_PROTOTYPE_METHOD(constructor, "close", Close);
+
+    target->Set(String::NewSymbol("TimerWheel"), constructor->GetFunction());
+  }
+
+ private:
+  static const int kBits = 6;
+  static const int kSlots = 1 << kBits;
+  static const int kLevels = 4;
+  static const uint32_t kNone = 0xffffffff;
+
+  enum { FREE, ARMED, FIRING };
+
+  struct Entry {
+    int64_t expires;
+    uint32_t prev;
+    uint32_t next; // or the next free entry
+    uint8_t level;
+    uint8_t slot;
+    uint8_t state;
+  };
+
+  static Handle<Value> New(const Arguments& args) {
+    assert(args.IsConstructCall());
+
+    HandleScope scope;
+    TimerWheel *wheel = new TimerWheel(args.This());
+    assert(wheel);
+
+    return scope.Close(args.This());
+  }
+
+  TimerWheel(Handle<Object> object) {
+    active_ = false;
+    int r = uv_timer_init(&handle_);
+    handle_.data = this;
+    assert(r == 0);
+    assert(object->InternalFieldCount() > 0);
+    object_ = v8::Persistent<v8::Object>::New(object);
+    object_->SetPointerInInternalField(0, this);
+
+    // Only armed timers keep the loop alive, as with TimerWrap.
+    uv_unref();
+
+    for (int k = 0; k < kLevels; k++) {
+      for (int i = 0; i < kSlots; i++) {
+        heads_[k][i] = tails_[k][i] = kNone;
+      }
+      occupied_[k] = 0;
+      counts_[k] = 0;
+    }
+    free_ = kNone;
+    armed_ = 0;
+    current_ = uv_now();
+    scheduled_ = -1;
+    added_ = removed_ = reset_ = fired_ = cascaded_ = wakeups_ = 0;
+  }
+
+  ~TimerWheel() {
+    if (!active_) uv_ref();
+    assert(object_.IsEmpty());
+  }
+
+  void StateChange() {
+    bool was_active = active_;
+    active_ = uv_is_active((uv_handle_t*) &handle_);
+
+    if (!was_active && active_) {
+      uv_ref();
+    } else if (was_active && !active_) {
+      uv_unref();
+    }
+  }
+
+  static void OnClose(uv_handle_t* handle) {
+    TimerWheel* wheel = static_cast<TimerWheel*>(handle->data);
+    delete wheel;
+  }
+
+  static inline uint64_t RotateRight(uint64_t bits, int n) {
+    n &= kSlots - 1;
+    return n ? (bits >> n) | (bits << (kSlots - n)) : bits;
+  }
+
+  uint32_t NewEntry() {
+    uint32_t id = free_;
+    if (id != kNone) {
+      free_ = entries_[id].next;
+    } else {
+      id = entries_.size();
+      entries_.push_back(Entry());
+    }
+    return id;
+  }
+
+  void FreeEntry(uint32_t id) {
+    entries_[id].state = FREE;
+    entries_[id].next = free_;
+    free_ = id;
+  }
+
+  // Files an entry by its expiry. The slot at current_ has been taken,
+  // except while cascading into it.
+  void Link(uint32_t id, bool cascading) {
+    Entry& e = entries_[id];
+    int64_t delta = e.expires - current_;
+    int64_t first = cascading ? current_ : current_ + 1;
+    int64_t when = e.expires > first ? e.expires : first;
+    int level = 0;
+
+    while (level < kLevels - 1 && delta >= ((int64_t) 1 << (kBits * (level + 1)))) {
+      level++;
+    }
+    if (delta >= ((int64_t) 1 << (kBits * kLevels))) {
+      // past the top level, wait in its last slot
+      when = current_ + ((int64_t) 1 << (kBits * kLevels)) - 1;
+    }
+
+    int slot = (when >> (kBits * level)) & (kSlots - 1);
+    e.level = level;
+    e.slot = slot;
+    e.next = kNone;
+    e.prev = tails_[level][slot];
+    if (e.prev == kNone) {
+      heads_[level][slot] = id;
+    } else {
+      entries_[e.prev].next = id;
+    }
+    tails_[level][slot] = id;
+    occupied_[level] |= (uint64_t) 1 << slot;
+    counts_[level]++;
+  }
+
+  void Unlink(uint32_t id) {
+    Entry& e = entries_[id];
+    if (e.prev == kNone) {
+      heads_[e.level][e.slot] = e.next;
+    } else {
+      entries_[e.prev].next = e.next;
+    }
+    if (e.next == kNone) {
+      tails_[e.level][e.slot] = e.prev;
+    } else {
+      entries_[e.next].prev = e.prev;
+    }
+    if (heads_[e.level][e.slot] == kNone) {
+      occupied_[e.level] &= ~((uint64_t) 1 << e.slot);
+    }
+    counts_[e.level]--;
+  }
+
+  // Detaches a slot, returning its first entry.
+  uint32_t TakeSlot(int level, int slot) {
+    uint32_t id = heads_[level][slot];
+    for (uint32_t i = id; i != kNone; i = entries_[i].next) {
+      counts_[level]--;
+    }
+    heads_[level][slot] = tails_[level][slot] = kNone;
+    occupied_[level] &= ~((uint64_t) 1 << slot);
+    return id;
+  }
+
+  // The next tick with a slot to expire or cascade, INT64_MAX for none.
+  int64_t NextTick() {
+    int64_t next = INT64_MAX;
+    for (int k = 0; k < kLevels; k++) {
+      if (!occupied_[k]) continue;
+      int64_t base = current_ >> (kBits * k);
+      int start = (base + 1) & (kSlots - 1);
+      int64_t distance = __builtin_ctzll(RotateRight(occupied_[k], start)) + 1;
+      int64_t tick = (base + distance) << (kBits * k);
+      if (tick < next) next = tick;
+    }
+    return next;
+  }
+
+  // Moves the clock up to now, collecting what expired in firing_.
+  void Advance(int64_t now) {
+    while (current_ < now) {
+      int64_t next = NextTick();
+      if (next > now) {
+        current_ = now;
+        break;
+      }
+      current_ = next;
+
+      for (int k = 1; k < kLevels; k++) {
+        if (current_ & (((int64_t) 1 << (kBits * k)) - 1)) break;
+        int slot = (current_ >> (kBits * k)) & (kSlots - 1);
+        uint32_t id = TakeSlot(k, slot);
+        while (id != kNone) {
+          uint32_t next_id = entries_[id].next;
+          Link(id, true);
+          cascaded_++;
+          id = next_id;
+        }
+      }
+
+      uint32_t id = TakeSlot(0, current_ & (kSlots - 1));
+      while (id != kNone) {
+        entries_[id].state = FIRING;
+        firing_.push_back(id);
+        armed_--;
+        id = entries_[id].next;
+      }
+    }
+  }
+
+  // Points the uv timer at the next tick, or stops it.
+  void Schedule() {
+    int64_t next = armed_ ? NextTick() : INT64_MAX;
+
+    if (next == INT64_MAX) {
+      if (scheduled_ >= 0) {
+        uv_timer_stop(&handle_);
+        scheduled_ = -1;
+      }
+    } else if (next != scheduled_) {
+      int64_t timeout = next - uv_now();
+      uv_timer_start(&handle_, OnTimeout, timeout > 0 ? timeout : 0, 0);
+      scheduled_ = next;
+    }
+
+    StateChange();
+  }
+
+  uint32_t Arm(uint32_t id, int64_t msecs) {
+    Entry& e = entries_[id];
+    e.expires = uv_now() + (msecs > 0 ? msecs : 0);
+    e.state = ARMED;
+    Link(id, false);
+    Schedule();
+    return id;
+  }
+
+  // var id = wheel.add(msecs)
+  static Handle<Value> Add(const Arguments& args) {
+    HandleScope scope;
+
+    WHEEL_UNWRAP
+
+    uint32_t id = wheel->NewEntry();
+    if (wheel->armed_++ == 0) wheel->current_ = uv_now();
+    wheel->added_++;
+    wheel->Arm(id, args[0]->IntegerValue());
+
+    return scope.Close(Integer::NewFromUnsigned(id));
+  }
+
+  // id = wheel.reset(id, msecs), a new id if it was not armed
+  static Handle<Value> Reset(const Arguments& args) {
+    HandleScope scope;
+
+    WHEEL_UNWRAP
+
+    uint32_t id = args[0]->Uint32Value();
+    int64_t msecs = args[1]->IntegerValue();
+
+    if (id < wheel->entries_.size() && wheel->entries_[id].state == ARMED) {
+      wheel->Unlink(id);
+      wheel->reset_++;
+    } else {
+      id = wheel->NewEntry();
+      if (wheel->armed_++ == 0) wheel->current_ = uv_now();
+      wheel->added_++;
+    }
+    wheel->Arm(id, msecs);
+
+    return scope.Close(Integer::NewFromUnsigned(id));
+  }
+
+  // wheel.remove(id)
+  static Handle<Value> Remove(const Arguments& args) {
+    HandleScope scope;
+
+    WHEEL_UNWRAP
+
+    uint32_t id = args[0]->Uint32Value();
+
+    if (id < wheel->entries_.size() && wheel->entries_[id].state == ARMED) {
+      wheel->Unlink(id);
+      wheel->FreeEntry(id);
+      wheel->armed_--;
+      wheel->removed_++;
+      if (wheel->armed_ == 0) wheel->Schedule();
+    }
+
+    return scope.Close(Integer::New(0));
+  }
+
+  static Handle<Value> Stats(const Arguments& args) {
+    HandleScope scope;
+
+    WHEEL_UNWRAP
+
+    Local<Array> levels = Array::New(kLevels);
+    for (int k = 0; k < kLevels; k++) {
+      Local<Object> level = Object::New();
+      level->Set(String::NewSymbol("resolution"),
+                 Number::New((double) ((int64_t) 1 << (kBits * k))));
+      level->Set(String::NewSymbol("slots"),
+                 Integer::New(__builtin_popcountll(wheel->occupied_[k])));
+      level->Set(String::NewSymbol("timers"),
+                 Integer::NewFromUnsigned(wheel->counts_[k]));
+      levels->Set(k, level);
+    }
+
+    Local<Object> o = Object::New();
+    o->Set(String::NewSymbol("active"), Integer::NewFromUnsigned(wheel->armed_));
+    o->Set(String::NewSymbol("entries"),
+           Integer::NewFromUnsigned(wheel->entries_.size()));
+    o->Set(String::NewSymbol("levels"), levels);
+    o->Set(String::NewSymbol("added"), Number::New(wheel->added_));
+    o->Set(String::NewSymbol("reset"), Number::New(wheel->reset_));
+    o->Set(String::NewSymbol("removed"), Number::New(wheel->removed_));
+    o->Set(String::NewSymbol("fired"), Number::New(wheel->fired_));
+    o->Set(String::NewSymbol("cascaded"), Number::New(wheel->cascaded_));
+    o->Set(String::NewSymbol("wakeups"), Number::New(wheel->wakeups_));
+    return scope.Close(o);
+  }
+
+  static Handle<Value> Close(const Arguments& args) {
+    HandleScope scope;
+
+    WHEEL_UNWRAP
+
+    int r = uv_close((uv_handle_t*) &wheel->handle_, OnClose);
+
+    if (r) SetErrno(uv_last_error().code);
+
+    wheel->StateChange();
+
+    assert(!wheel->object_.IsEmpty());
+    wheel->object_->SetPointerInInternalField(0, NULL);
+    wheel->object_.Dispose();
+    wheel->object_.Clear();
+
+    return scope.Close(Integer::New(r));
+  }
+
+  static void OnTimeout(uv_timer_t* handle, int status) {
+    HandleScope scope;
+
+    TimerWheel* wheel = static_cast<TimerWheel*>(handle->data);
+    assert(wheel);
+
+    wheel->wakeups_++;
+    wheel->scheduled_ = -1;
+    wheel->Advance(uv_now());
+    wheel->Schedule();
+
+    if (wheel->firing_.empty()) return;
+
+    Local<Array> ids = Array::New(wheel->firing_.size());
+    for (size_t i = 0; i < wheel->firing_.size(); i++) {
+      ids->Set(i, Integer::NewFromUnsigned(wheel->firing_[i]));
+    }
+    wheel->fired_ += wheel->firing_.size();
+
+    Local<Value> argv[1] = { ids };
+    Node::MakeCallback(wheel->object_, "ontimeout", 1, argv);
+
+    // Closing only frees the wheel from the uv close callback.
+    for (size_t i = 0; i < wheel->firing_.size(); i++) {
+      wheel->FreeEntry(wheel->firing_[i]);
+    }
+    wheel->firing_.clear();
+  }
+
+  uv_timer_t handle_;
+  Persistent<Object> object_;
+  bool active_;
+
+  std::vector<Entry> entries_;
+  std::vector<uint32_t> firing_;
+  uint32_t free_;
+  uint32_t heads_[kLevels][kSlots];
+  uint32_t tails_[kLevels][kSlots];
+  uint64_t occupied_[kLevels];
+  uint32_t counts_[kLevels];
+  uint32_t armed_;
+  int64_t current_;   // the wheel's clock, ms
+  int64_t scheduled_; // tick the uv timer is started for, -1 if stopped
+
+  double added_;
+  double reset_;
+  double removed_;
+  double fired_;
+  double cascaded_;
+  double wakeups_;
+};
+
+
+static void InitTimerWrap(Handle<Object> target) {
+  TimerWrap::Initialize(target);
+  TimerWheel::Initialize(target);
+}
+
+
 }  // namespace node
 
-NODE_MODULE(node_timer_wrap, node::TimerWrap::Initialize);
+NODE_MODULE(node_timer_wrap, node::InitTimerWrap);
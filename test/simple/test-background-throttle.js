@@ -0,0 +1,61 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+var stats = process.backgroundStats();
+assert.equal(stats.paused, 0);
+assert.equal(stats.background, false);
+assert.ok(stats.granularity > 0);
+
+var paused = 0, resumed = 0;
+process.on('pause', function() { paused++; });
+process.on('resume', function() { resumed++; });
+
+test.pause(true);
+test.pause(true);
+assert.equal(paused, 1);
+assert.equal(process.backgroundStats().paused, 1);
+
+// timers started while paused land on the background grid
+var granularity = process.backgroundStats().granularity;
+var start = Date.now();
+setTimeout(function() {
+  var elapsed = Date.now() - start;
+  assert.ok(elapsed >= 10);
+  test.pause(false);
+  assert.equal(resumed, 1);
+  assert.equal(process.backgroundStats().paused, 0);
+
+  // and back to their own timeouts on resume
+  start = Date.now();
+  setTimeout(function() {
+    assert.ok(Date.now() - start < granularity);
+  }, 10);
+}, 10);
+
+process.on('exit', function() {
+  var stats = process.backgroundStats();
+  assert.equal(typeof stats.wakeups, 'number');
+  assert.equal(typeof stats.wakeupsPerMinute, 'number');
+  assert.equal(stats.paused, 0);
+});
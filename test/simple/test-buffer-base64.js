@@ -0,0 +1,73 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+// covers the vectorized blocks, the scalar remainder and the fallback for
+// blocks with whitespace or padding
+
+var table = 'ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/';
+
+function encode(buf) {
+  var out = '';
+  for (var i = 0; i < buf.length; i += 3) {
+    var v = buf[i] << 16 | (i + 1 < buf.length ? buf[i + 1] << 8 : 0) |
+            (i + 2 < buf.length ? buf[i + 2] : 0);
+    out += table[v >> 18] + table[(v >> 12) & 63] +
+           (i + 1 < buf.length ? table[(v >> 6) & 63] : '=') +
+           (i + 2 < buf.length ? table[v & 63] : '=');
+  }
+  return out;
+}
+
+function check(length) {
+  var buf = new Buffer(length);
+  for (var i = 0; i < length; i++) buf[i] = (i * 131 + length) & 0xff;
+
+  var str = buf.toString('base64');
+  assert.equal(str, encode(buf));
+  assert.equal(Buffer.byteLength(str, 'base64'), length);
+  assert.deepEqual(new Buffer(str, 'base64'), buf);
+
+  // line breaks every 76 characters, like MIME
+  var wrapped = str.replace(/.{76}/g, '$&\r\n');
+  assert.deepEqual(new Buffer(wrapped, 'base64'), buf);
+
+  // garbage is skipped, decoding stops at padding
+  var mid = (str.length >> 3) << 2;
+  var dirty = str.slice(0, mid) + ' \n*' + str.slice(mid);
+  assert.deepEqual(new Buffer(dirty, 'base64'), buf);
+  if (mid > 0) {
+    assert.deepEqual(new Buffer(str.slice(0, mid) + '==' + str.slice(mid), 'base64'),
+                     buf.slice(0, mid / 4 * 3));
+  }
+}
+
+for (var length = 0; length < 300; length++) {
+  check(length);
+}
+[1023, 1024, 4095, 65536, 65537, 1024 * 1024 + 1].forEach(check);
+
+// unpadded input
+assert.equal(new Buffer('YWJj', 'base64').toString(), 'abc');
+assert.equal(new Buffer('YWI', 'base64').toString(), 'ab');
+assert.equal(new Buffer('YQ', 'base64').toString(), 'a');
@@ -0,0 +1,75 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+// covers the vectorized blocks and the scalar remainder
+
+function toHex(buf) {
+  var out = '';
+  for (var i = 0; i < buf.length; i++) {
+    out += (buf[i] < 16 ? '0' : '') + buf[i].toString(16);
+  }
+  return out;
+}
+
+function check(length) {
+  var buf = new Buffer(length);
+  for (var i = 0; i < length; i++) buf[i] = (i * 151 + length) & 0xff;
+
+  var str = buf.toString('hex');
+  assert.equal(str, toHex(buf));
+  assert.deepEqual(new Buffer(str, 'hex'), buf);
+  assert.deepEqual(new Buffer(str.toUpperCase(), 'hex'), buf);
+
+  // a bad digit anywhere fails the whole write
+  if (length > 0) {
+    var at = (length * 7) % str.length;
+    ['g', ' ', 'İ', '耰'].forEach(function(c) {
+      var bad = str.slice(0, at) + c + str.slice(at + 1);
+      assert.throws(function() {
+        new Buffer(length).write(bad, 'hex');
+      }, /Invalid hex string/);
+    });
+  }
+}
+
+for (var length = 0; length < 100; length++) {
+  check(length);
+}
+[255, 256, 4097, 65536].forEach(check);
+
+// odd number of digits
+assert.throws(function() {
+  new Buffer(2).write('abc', 'hex');
+}, /Invalid hex string/);
+
+// the write stops at the end of the buffer
+var buf = new Buffer(2);
+assert.equal(buf.write('a1b2c3', 0, 'hex'), 2);
+assert.equal(Buffer._charsWritten, 4);
+assert.equal(buf.toString('hex'), 'a1b2');
+
+var buf = new Buffer(4);
+buf.fill(0);
+assert.equal(buf.write('ff', 3, 'hex'), 1);
+assert.equal(buf.toString('hex', 1, 4), '0000ff');
@@ -0,0 +1,70 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+
+var b = new Buffer('abcdef\r\n--boundary\r\nabcdef');
+
+// bytes
+assert.equal(b.indexOf(0x61), 0);
+assert.equal(b.indexOf(0x0a), 7);
+assert.equal(b.indexOf(0x61, 1), 15);
+assert.equal(b.indexOf(0x7a), -1);
+assert.equal(b.lastIndexOf(0x61), 20);
+assert.equal(b.lastIndexOf(0x61, 14), 0);
+
+// strings, in utf8 by default
+assert.equal(b.indexOf('--boundary'), 8);
+assert.equal(b.indexOf('\r\n', 8), 18);
+assert.equal(b.indexOf('def', -3), 23);
+assert.equal(b.indexOf('x'), -1);
+assert.equal(b.indexOf(''), 0);
+assert.equal(b.lastIndexOf('\r\n'), 18);
+assert.equal(b.lastIndexOf('abc', 19), 0);
+assert.equal(b.lastIndexOf('abc', 20), 20);
+assert.equal(b.indexOf('2d2d', 'hex'), 8);
+assert.equal(new Buffer('xé€').indexOf('€'), 3);
+
+// buffers and slices
+assert.equal(b.indexOf(new Buffer('boundary')), 10);
+assert.equal(b.slice(10).indexOf('abc'), 10);
+assert.equal(b.slice(0, 5).indexOf('def'), -1);
+assert.equal(b.slice(0, 5).lastIndexOf('abc'), 0);
+assert.equal(b.slice(20).indexOf(b.slice(0, 6)), 0);
+
+// past the SIMD blocks and Horspool's minimum length
+var long = new Buffer(1000);
+long.fill(0x2d);
+var boundary = new Buffer('------WebKitFormBoundary7MA4YWxkTrZu0gW');
+boundary.copy(long, 900);
+assert.equal(long.indexOf(boundary), 900);
+assert.equal(long.lastIndexOf(boundary), 900);
+assert.equal(long.indexOf('-Web'), 905);
+assert.equal(long.lastIndexOf('--'), 998);
+assert.equal(long.indexOf(boundary, 901), -1);
+
+assert.throws(function() { b.indexOf({}); }, TypeError);
+
+// needles that can't be decoded throw instead of searching garbage
+assert.throws(function() { b.indexOf('zz', 'hex'); }, TypeError);
+assert.throws(function() { b.lastIndexOf('abzz', 'hex'); }, TypeError);
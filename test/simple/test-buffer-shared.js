@@ -0,0 +1,77 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// Buffers made by Buffer::NewShared (INodeCore::createSharedBuffer) alias
+// the memory of their backing object and keep it alive
+
+var common = require('../common');
+var assert = require('assert');
+var SlowBuffer = require('buffer').SlowBuffer;
+
+// aliasing, writes through either side are seen by the other
+var backing = new SlowBuffer(16);
+backing.fill(0, 0, backing.length);
+var shared = SlowBuffer.makeShared(backing);
+assert.ok(shared instanceof SlowBuffer);
+assert.notStrictEqual(shared, backing);
+assert.equal(shared.length, backing.length);
+
+backing[0] = 0x61;
+assert.equal(shared[0], 0x61);
+shared[15] = 0x7a;
+assert.equal(backing[15], 0x7a);
+shared.write('node', 4);
+assert.equal(backing.toString('utf8', 4, 8), 'node');
+
+// a fast Buffer shares just its slice of the parent
+var parent = new Buffer('0123456789');
+var slice = parent.slice(2, 6);
+var sharedSlice = SlowBuffer.makeShared(slice);
+assert.equal(sharedSlice.length, 4);
+assert.equal(sharedSlice.toString(), '2345');
+sharedSlice[0] = 0x78;
+assert.equal(parent.toString(), '01x3456789');
+
+// empty backing
+assert.equal(SlowBuffer.makeShared(new SlowBuffer(0)).length, 0);
+
+// objects without external array data are refused
+assert.throws(function() { SlowBuffer.makeShared({}); }, TypeError);
+assert.throws(function() { SlowBuffer.makeShared('abc'); }, TypeError);
+assert.throws(function() { SlowBuffer.makeShared(); }, TypeError);
+
+// lifetime, the backing is only referenced by the shared buffer now,
+// memory pressure from external allocations drives full collections
+var kept = SlowBuffer.makeShared(new Buffer('still here'));
+for (var i = 0; i < 256; i++) {
+  new SlowBuffer(1024 * 1024);
+}
+if (typeof gc === 'function') gc();
+assert.equal(kept.length, 10);
+assert.equal(kept.toString(), 'still here');
+
+// the backing outlives every shared buffer on it
+var outer = SlowBuffer.makeShared(SlowBuffer.makeShared(new Buffer('abc')));
+for (i = 0; i < 256; i++) {
+  new SlowBuffer(1024 * 1024);
+}
+assert.equal(outer.toString(), 'abc');
@@ -0,0 +1,61 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var SlowBuffer = require('buffer').SlowBuffer;
+
+var before = process.slabStats();
+if (!before.enabled) {
+  console.log('skipping, NODE_SLAB=0');
+  return;
+}
+
+assert.equal(before.chunkSize, 65536);
+assert.equal(before.classes.length, 10);
+assert.equal(before.classes[0].size, 16);
+assert.equal(before.classes[9].size, 8192);
+
+// small buffers come from their size class
+var small = [];
+for (var i = 0; i < 100; i++) {
+  small.push(new SlowBuffer(100));
+}
+var large = new SlowBuffer(20000);
+
+var after = process.slabStats();
+assert.equal(after.classes[3].allocs - before.classes[3].allocs, 100);
+assert.ok(after.classes[3].chunks >= 1);
+assert.ok(after.blocks >= before.blocks + 101);
+assert.ok(after.used >= before.used + 100 * 128);
+assert.ok(after.large >= before.large + 20000);
+
+// the data is where it is expected to be
+for (var i = 0; i < small.length; i++) {
+  small[i].fill(i);
+}
+for (var i = 0; i < small.length; i++) {
+  assert.equal(small[i][0], i);
+  assert.equal(small[i][99], i);
+}
+large.fill(0xaa);
+assert.equal(large[19999], 0xaa);
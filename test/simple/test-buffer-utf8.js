@@ -0,0 +1,75 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+
+var before = process.utf8Stats();
+assert.equal(typeof before.impl, 'string');
+
+// ASCII, both sides of the SIMD block size
+[0, 1, 15, 16, 17, 63, 64, 65, 1000].forEach(function(n) {
+  var s = new Array(n + 1).join('a');
+  var b = new Buffer(s, 'utf8');
+  assert.equal(b.length, n);
+  assert.equal(b.toString('utf8'), s);
+});
+
+// large ASCII slices are external strings
+var big = new Array(128 * 1024 + 1).join('x');
+assert.equal(new Buffer(big).toString(), big);
+
+// mixed, multibyte characters after a long ASCII run
+var mixed = new Array(100).join('abc') + 'é€Āz';
+var b = new Buffer(mixed);
+assert.equal(b.length, 297 + 2 + 3 + 2 + 1);
+assert.equal(b.toString(), mixed);
+assert.equal(b.toString('utf8', 297, 299), 'é');
+var long = new Array(2000).join('€');
+assert.equal(new Buffer(long).toString(), long);
+
+// invalid UTF-8 still decodes the way v8 does
+var invalid = new Buffer([0x61, 0xff, 0x62, 0xc3]);
+assert.equal(invalid.toString().charAt(0), 'a');
+assert.equal(invalid.toString().length, 4);
+
+// writes stop at whole characters
+var buf = new Buffer(4);
+assert.equal(buf.write('ab€', 0, 'utf8'), 2);
+assert.equal(Buffer._charsWritten, 2);
+assert.equal(buf.write('a€', 0, 'utf8'), 4);
+assert.equal(Buffer._charsWritten, 2);
+assert.equal(buf.toString('utf8', 0, 4), 'a€');
+assert.equal(buf.write('abcdef', 1, 'utf8'), 3);
+assert.equal(Buffer._charsWritten, 3);
+
+// no trailing NUL
+buf.fill(0x7a);
+assert.equal(buf.write('ab'), 2);
+assert.equal(buf.toString(), 'abzz');
+
+var after = process.utf8Stats();
+assert.ok(after.slice.ascii > before.slice.ascii);
+assert.ok(after.slice.external > before.slice.external);
+assert.ok(after.slice.decoded > before.slice.decoded);
+assert.ok(after.write.ascii > before.write.ascii);
+assert.ok(after.write.mixed > before.write.mixed);
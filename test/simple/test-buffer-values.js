@@ -0,0 +1,104 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+var buf = new Buffer([0, 1, 0, 2, 0xff, 0xfe, 0x3f, 0x80, 0, 0]);
+
+assert.deepEqual(buf.readValues('uint8', 0, 4, 'big'), [0, 1, 0, 2]);
+assert.deepEqual(buf.readValues('int8', 4, 2, 'little'), [-1, -2]);
+assert.deepEqual(buf.readValues('uint16', 0, 3, 'big'), [1, 2, 65534]);
+assert.deepEqual(buf.readValues('int16', 0, 3, 'little'), [256, 512, -257]);
+assert.deepEqual(buf.readValues('uint32', 0, 1, 'big'), [0x00010002]);
+assert.deepEqual(buf.readValues('int32', 2, 1, 'big'), [0x0002fffe]);
+assert.deepEqual(buf.readValues('float', 6, 1, 'big'), [1]);
+assert.deepEqual(buf.readValues('uint16', 10, 0, 'big'), []);
+
+// the single value accessors agree with the bulk ones
+for (var i = 0; i + 1 < buf.length; i++) {
+  assert.equal(buf.readValues('int16', i, 1, 'big')[0],
+               buf.readInt16(i, 'big'));
+  assert.equal(buf.readValues('uint16', i, 1, 'little')[0],
+               buf.readUInt16(i, 'little'));
+}
+
+// round trips, on a slice so the parent offset is exercised
+var pool = new Buffer(64);
+pool.fill(0xaa);
+var slice = pool.slice(5, 37);
+
+var doubles = [0, -0.5, 1e300, Infinity];
+assert.equal(slice.writeValues('double', doubles, 0, 'little'), 32);
+assert.deepEqual(slice.readValues('double', 0, 4, 'little'), doubles);
+assert.equal(pool[4], 0xaa);
+assert.equal(pool[37], 0xaa);
+
+assert.equal(slice.writeValues('int16', [1, -1, 300, -300], 2, 'big'), 8);
+assert.equal(slice.slice(2, 10).toString('hex'), '0001ffff012cfed4');
+assert.deepEqual(slice.readValues('int16', 2, 4, 'big'), [1, -1, 300, -300]);
+
+// bulk writes wrap integers instead of checking them
+slice.writeValues('uint8', [256, -1, 3.7, NaN], 0, 'big');
+assert.deepEqual(slice.readValues('uint8', 0, 4, 'big'), [0, 255, 3, 0]);
+slice.writeValues('uint32', [0x100000001], 0, 'little');
+assert.equal(slice.readUInt32(0, 'little'), 1);
+
+// bounds are the slice's, not the parent's
+assert.throws(function() {
+  slice.readValues('uint32', 30, 1, 'big');
+});
+assert.throws(function() {
+  slice.writeValues('uint8', new Array(33), 0, 'big');
+});
+assert.throws(function() {
+  slice.readInt32(29, 'big');
+});
+assert.throws(function() {
+  slice.writeDouble(1, 25, 'little');
+});
+
+// bad arguments
+assert.throws(function() {
+  buf.readValues('int64', 0, 1, 'big');
+});
+assert.throws(function() {
+  buf.readValues('uint8', 0, 1, 'middle');
+});
+assert.throws(function() {
+  buf.writeValues('uint8', 5, 0, 'big');
+});
+
+// the SlowBuffer methods check bounds themselves
+assert.throws(function() {
+  pool.parent._readDouble(pool.parent.length - 4, true);
+}, RangeError);
+assert.throws(function() {
+  slice.readUInt8(-1, 'big');
+});
+
+// they take the byte order as a bool and stay out of the public names, a
+// SlowBuffer handed to JS has none of the Buffer accessors
+var SlowBuffer = require('buffer').SlowBuffer;
+['readUInt16', 'writeUInt16', 'readDouble', 'writeDouble',
+ 'readValues', 'writeValues'].forEach(function(name) {
+  assert.equal(typeof SlowBuffer.prototype[name], 'undefined', name);
+});
@@ -0,0 +1,67 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+
+var stats = process.compileCacheStats();
+if (!stats.enabled) {
+  console.error('compile cache disabled, skipping');
+  process.exit(0);
+}
+
+// big enough to be cached, unique so the first load is always a miss
+var file = path.join(common.tmpDir, 'compile-cache.js');
+var source = '// ' + Date.now() + '\n';
+for (var i = 0; i < 100; i++) {
+  source += 'exports.f' + i + ' = function() { return ' + i + '; };\n';
+}
+fs.writeFileSync(file, source);
+
+var before = process.compileCacheStats();
+assert.equal(require(file).f42(), 42);
+var miss = process.compileCacheStats();
+assert.equal(miss.misses, before.misses + 1);
+
+// the entry is written in the background, load it again once it's there
+function reload() {
+  if (process.compileCacheStats().writing) {
+    setTimeout(reload, 10);
+    return;
+  }
+
+  var written = process.compileCacheStats();
+  assert.ok(written.size > before.size || written.evicted > before.evicted);
+  assert.ok(written.size <= written.limit);
+
+  delete require.cache[file];
+  assert.equal(require(file).f99(), 99);
+  var hit = process.compileCacheStats();
+  assert.equal(hit.hits, written.hits + 1);
+  assert.equal(hit.misses, written.misses);
+  assert.equal(hit.errors, 0);
+  assert.equal(hit.entries, written.entries);
+
+  fs.unlinkSync(file);
+}
+reload();
@@ -0,0 +1,71 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var dgram = require('dgram');
+
+var N = 100;
+var received = [];
+var batches = 0;
+
+var server = dgram.createSocket('udp4');
+server.setBatchSize(16);
+assert.throws(function() { server.setBatchSize(0); });
+assert.throws(function() { server.setBatchSize(65); });
+
+server.on('messages', function(msgs, rinfos) {
+  batches++;
+  assert.equal(msgs.length, rinfos.length);
+  assert.ok(msgs.length <= 16);
+  for (var i = 0; i < msgs.length; i++) {
+    assert.equal(rinfos[i].address, '127.0.0.1');
+    assert.equal(rinfos[i].size, msgs[i].length);
+    received.push(msgs[i].toString());
+  }
+  if (received.length == N) {
+    client.close();
+    server.close();
+  }
+});
+
+server.bind(common.PORT, '127.0.0.1');
+
+var buffers = [];
+for (var i = 0; i < N; i++) {
+  buffers.push(new Buffer('datagram ' + i));
+}
+
+var client = dgram.createSocket('udp4');
+var sent;
+client.sendBatch(buffers, common.PORT, '127.0.0.1', function(err, n) {
+  if (err) throw err;
+  sent = n;
+});
+
+process.on('exit', function() {
+  assert.equal(sent, N);
+  assert.equal(received.length, N);
+  for (var i = 0; i < N; i++) {
+    assert.equal(received[i], 'datagram ' + i);
+  }
+  assert.ok(batches < N);
+});
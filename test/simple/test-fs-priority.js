@@ -0,0 +1,77 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+
+// only the requests made inside fn are tagged
+var tagged = 0;
+var ret = fs.withPriority(fs.PRIORITY_BACKGROUND, function() {
+  fs.stat(__filename, function(err) {
+    assert.ifError(err);
+    tagged++;
+  });
+  return 42;
+});
+assert.equal(ret, 42);
+assert.throws(function() { fs.withPriority('high', function() {}); });
+
+// clamped to the eio range
+fs.withPriority(100, function() {
+  assert.equal(process.binding('fs').setPriority(-100), 4);
+});
+
+// the priority is restored when fn throws
+assert.throws(function() {
+  fs.withPriority(fs.PRIORITY_BACKGROUND, function() {
+    throw new Error('fn');
+  });
+}, /fn/);
+assert.equal(process.binding('fs').setPriority(fs.PRIORITY_DEFAULT),
+             fs.PRIORITY_DEFAULT);
+
+var before = process.eioStats();
+var pending = 50, done = 0;
+for (var i = 0; i < pending; i++) {
+  var stat = function() {
+    fs.stat(__filename, function(err, stats) {
+      assert.ifError(err);
+      done++;
+    });
+  };
+  if (i % 2) {
+    fs.withPriority(fs.PRIORITY_BACKGROUND, stat);
+  } else {
+    stat();
+  }
+}
+
+process.on('exit', function() {
+  assert.equal(done, pending);
+  assert.equal(tagged, 1);
+  var after = process.eioStats();
+  assert.ok(after.drains > before.drains);
+  assert.ok(after.completed >= before.completed + pending);
+  assert.ok(after.wakeups > before.wakeups);
+  assert.ok(after.maxReqs >= 10);
+  assert.equal(after.depth.count, after.drains);
+});
@@ -82,3 +82,85 @@ assert.throws(function() {
   parser.execute(buffer, 0, request.length);
 }, Error, 'hello world');
 
+
+//
+// Headers and the URL are collected natively and arrive with
+// onHeadersComplete, even when split across execute() calls
+//
+
+function run(parser, message, pieces) {
+  var b = new Buffer(message, 'binary');
+  var step = Math.ceil(b.length / pieces);
+  for (var off = 0; off < b.length; off += step) {
+    var ret = parser.execute(b, off, Math.min(step, b.length - off));
+    assert.ok(!(ret instanceof Error), ret);
+  }
+}
+
+[1, 3, 17].forEach(function(pieces) {
+  var parser = new HTTPParser('request');
+  var info = null;
+  parser.onHeadersComplete = function(i) {
+    info = i;
+  };
+  run(parser, 'POST /some/path?x=1#frag HTTP/1.1\r\n' +
+              'Host: example.com\r\n' +
+              'X-Custom-HEADER: Some Value\r\n' +
+              'Content-Length: 0\r\n' +
+              '\r\n', pieces);
+  assert.equal(info.method, 'POST');
+  assert.equal(info.url, '/some/path?x=1#frag');
+  assert.deepEqual(info.headers, ['host', 'example.com',
+                                  'x-custom-header', 'Some Value',
+                                  'content-length', '0']);
+});
+
+// more headers than fit natively, and trailers, go through onHeaders
+var parser = new HTTPParser('request');
+var flushed = [];
+var flushedUrl = '';
+var headers = null;
+var trailers = null;
+parser.onHeaders = function(h, url) {
+  if (headers) {
+    trailers = h;
+  } else {
+    flushed = flushed.concat(h);
+    flushedUrl += url;
+  }
+};
+parser.onHeadersComplete = function(info) {
+  headers = flushed.concat(info.headers);
+  assert.equal(flushedUrl + info.url, '/many');
+};
+var message = 'POST /many HTTP/1.1\r\nTransfer-Encoding: chunked\r\n';
+for (var i = 0; i < 40; i++) {
+  message += 'H' + i + ': ' + i + '\r\n';
+}
+message += '\r\n1\r\na\r\n0\r\nTrailer-One: t1\r\n\r\n';
+run(parser, message, 7);
+assert.equal(headers.length, 2 * 41);
+assert.equal(headers[0], 'transfer-encoding');
+assert.equal(headers[2 * 41 - 2], 'h39');
+assert.equal(headers[2 * 41 - 1], '39');
+assert.deepEqual(trailers, ['trailer-one', 't1']);
+
+// without onHeaders all of them, and the whole URL, arrive with
+// onHeadersComplete
+var parser = new HTTPParser('request');
+var info = null;
+parser.onHeadersComplete = function(i) {
+  info = i;
+};
+var message = 'GET /many/without/onHeaders HTTP/1.1\r\n';
+for (var i = 0; i < 70; i++) {
+  message += 'H' + i + ': ' + i + '\r\n';
+}
+message += '\r\n';
+run(parser, message, 11);
+assert.equal(info.url, '/many/without/onHeaders');
+assert.equal(info.headers.length, 2 * 70);
+for (var i = 0; i < 70; i++) {
+  assert.equal(info.headers[2 * i], 'h' + i);
+  assert.equal(info.headers[2 * i + 1], String(i));
+}
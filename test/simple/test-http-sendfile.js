@@ -0,0 +1,214 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// fs.ReadStream piped to an http response on a net_uv socket is sent with
+// socket.sendFile(): Content-Length and chunked framing, ranges, the
+// fallback for files that aren't regular ones and a file that gets shorter
+// than the range after the response was framed.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+var http = require('http');
+var net = require('net');
+var net_uv = require('net_uv');
+
+var file = path.join(common.fixturesDir, 'person.jpg');
+var data = fs.readFileSync(file).toString('binary');
+var shrinking = path.join(common.tmpDir, 'sendfile-shrinking');
+var bigLength = 16 * 1024 * 1024;
+
+var sendFiles = [];
+var sendFileErrors = [];
+var shrinkOnSend = false;
+
+var httpServer = http.createServer(function(req, res) {
+  switch (req.url) {
+    case '/whole':
+      fs.createReadStream(file).pipe(res);
+      break;
+
+    case '/range':
+      fs.createReadStream(file, { start: 100, end: 1099 }).pipe(res);
+      break;
+
+    case '/chunked':
+      res.setHeader('Transfer-Encoding', 'chunked');
+      fs.createReadStream(file, { start: 0, end: 999 }).pipe(res);
+      break;
+
+    case '/device':
+      fs.createReadStream('/dev/zero', { start: 0, end: 99 }).pipe(res);
+      break;
+
+    case '/shrinking':
+      // the body is framed for the whole file, which loses all but 10
+      // bytes while the big write ahead of it still keeps it queued
+      res.writeHead(200, { 'Content-Length': bigLength + 1000 });
+      var big = new Buffer(bigLength);
+      big.fill(0x61);
+      res.write(big);
+      shrinkOnSend = true;
+      fs.createReadStream(shrinking).pipe(res);
+      break;
+  }
+});
+
+var server = net_uv.createServer(function(socket) {
+  var sendFile = socket.sendFile;
+  socket.sendFile = function(fd, offset, length, cb) {
+    sendFiles.push(length);
+    var ret = sendFile.call(this, fd, offset, length, function(err) {
+      if (err) sendFileErrors.push(err);
+      cb(err);
+    });
+    if (shrinkOnSend) {
+      shrinkOnSend = false;
+      var fd = fs.openSync(shrinking, 'r+');
+      fs.truncateSync(fd, 10);
+      fs.closeSync(fd);
+    }
+    return ret;
+  };
+  httpServer.emit('connection', socket);
+});
+
+// Sends the requests for paths on one connection, the last one closes it,
+// and calls back with everything the server sent.
+function fetch(paths, cb) {
+  var requests = paths.map(function(p, i) {
+    return 'GET ' + p + ' HTTP/1.1\r\nHost: localhost\r\n' +
+           (i == paths.length - 1 ? 'Connection: close\r\n' : '') + '\r\n';
+  });
+  var raw = '';
+  var c = net.createConnection(common.PORT);
+  c.setEncoding('binary');
+  c.on('connect', function() {
+    c.write(requests.join(''));
+  });
+  c.on('data', function(d) {
+    raw += d;
+  });
+  c.on('close', function() {
+    cb(raw);
+  });
+}
+
+// Splits raw into responses, framed by Content-Length or chunked.
+function parse(raw) {
+  var responses = [];
+  while (raw.length) {
+    var end = raw.indexOf('\r\n\r\n');
+    assert.ok(end > 0);
+    var head = raw.slice(0, end).toLowerCase();
+    raw = raw.slice(end + 4);
+
+    var res = { head: head, body: '' };
+    var m = /content-length: (\d+)/.exec(head);
+    if (m) {
+      res.length = +m[1];
+      res.body = raw.slice(0, res.length);
+      raw = raw.slice(res.length);
+    } else {
+      assert.ok(/transfer-encoding: chunked/.test(head));
+      res.chunked = true;
+      for (;;) {
+        var line = raw.indexOf('\r\n');
+        var size = parseInt(raw.slice(0, line), 16);
+        raw = raw.slice(line + 2);
+        if (size === 0) {
+          raw = raw.slice(2);
+          break;
+        }
+        res.body += raw.slice(0, size);
+        assert.equal(raw.slice(size, size + 2), '\r\n');
+        raw = raw.slice(size + 2);
+      }
+    }
+    responses.push(res);
+  }
+  return responses;
+}
+
+var done = 0;
+
+server.listen(common.PORT, function() {
+  // keep-alive, the first response has to end where its Content-Length says
+  fetch(['/whole', '/range', '/chunked'], function(raw) {
+    var responses = parse(raw);
+    assert.equal(responses.length, 3);
+
+    assert.equal(responses[0].length, data.length);
+    assert.equal(responses[0].body, data);
+
+    assert.equal(responses[1].length, 1000);
+    assert.equal(responses[1].body, data.slice(100, 1100));
+
+    assert.ok(responses[2].chunked);
+    assert.equal(responses[2].body, data.slice(0, 1000));
+
+    assert.deepEqual(sendFiles, [data.length, 1000, 1000]);
+    done++;
+    device();
+  });
+});
+
+// not a regular file, read and written as usual
+function device() {
+  fetch(['/device'], function(raw) {
+    var responses = parse(raw);
+    assert.equal(responses.length, 1);
+    assert.ok(responses[0].chunked);
+    assert.equal(responses[0].body, new Array(101).join('\0'));
+    assert.equal(sendFiles.length, 3);
+    done++;
+    shrink();
+  });
+}
+
+// the file ends before the range, the response can't be completed and the
+// connection is destroyed instead of leaving the client waiting
+function shrink() {
+  var b = new Buffer(1000);
+  b.fill(0x62);
+  fs.writeFileSync(shrinking, b);
+
+  fetch(['/shrinking'], function(raw) {
+    var end = raw.indexOf('\r\n\r\n');
+    assert.ok(/content-length: 16778216/i.test(raw.slice(0, end)));
+    assert.equal(raw.length - end - 4, bigLength + 10);
+    assert.equal(raw.slice(-10), 'bbbbbbbbbb');
+
+    assert.equal(sendFiles[3], 1000);
+    assert.equal(sendFileErrors.length, 1);
+    assert.equal(sendFileErrors[0].code, 'EOF');
+
+    fs.unlinkSync(shrinking);
+    server.close();
+    done++;
+  });
+}
+
+process.on('exit', function() {
+  assert.equal(done, 3);
+});
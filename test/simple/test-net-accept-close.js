@@ -19,8 +19,33 @@
 // OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
-#include <node.h>
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
 
-int main(int argc, char *argv[]) {
-  return node::Start(argc, argv);
-}
+// The server is closed from the first 'connection' listener. Peers accepted
+// in the same batch must not be handed out afterwards, they are closed
+var N = 10;
+var connections = 0;
+var closed = 0;
+
+var server = net.createServer(function(socket) {
+  connections++;
+  socket.destroy();
+  server.close();
+});
+
+server.listen(common.PORT, function() {
+  for (var i = 0; i < N; i++) {
+    var client = net.createConnection(common.PORT);
+    client.on('error', function() {});
+    client.on('close', function() {
+      closed++;
+    });
+  }
+});
+
+process.on('exit', function() {
+  assert.equal(connections, 1);
+  assert.equal(closed, N);
+});
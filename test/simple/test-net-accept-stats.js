@@ -0,0 +1,61 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var N = 20;
+
+function sum(a) {
+  return a.reduce(function(x, y) { return x + y; }, 0);
+}
+
+var before = process.acceptStats();
+assert.equal(before.batch.length, 5);
+assert.equal(sum(before.batch), before.wakeups);
+
+var connections = 0;
+var server = net.createServer(function(socket) {
+  connections++;
+  socket.end();
+  if (connections == N) server.close();
+});
+
+server.listen(common.PORT, function() {
+  for (var i = 0; i < N; i++) {
+    net.createConnection(common.PORT).on('end', function() {
+      this.destroy();
+    });
+  }
+});
+
+process.on('exit', function() {
+  assert.equal(connections, N);
+
+  var after = process.acceptStats();
+  assert.equal(after.accepted - before.accepted, N);
+  assert.ok(after.wakeups > before.wakeups);
+  assert.ok(after.wakeups - before.wakeups <= N);
+  assert.equal(sum(after.batch), after.wakeups);
+  assert.ok(after.maxBatch >= 1);
+  assert.equal(after.emfile, before.emfile);
+});
@@ -0,0 +1,95 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+var net = require('net_uv');
+
+var file = path.join(common.fixturesDir, 'person.jpg');
+var data = fs.readFileSync(file);
+var fd = fs.openSync(file, 'r');
+
+// all of the file, then a slice of it, around ordinary writes
+var chunks = [];
+var sendFileCallbacks = 0;
+
+var server = net.createServer(function(socket) {
+  socket.on('data', function(d) {
+    chunks.push(d);
+  });
+  socket.on('end', function() {
+    socket.end();
+    server.close();
+  });
+});
+
+server.listen(common.PORT, function() {
+  var c = net.createConnection(common.PORT);
+
+  // still connecting, goes through the connect queue
+  c.write('head');
+  c.sendFile(fd, 0, data.length, function(err) {
+    assert.ok(!err);
+    sendFileCallbacks++;
+  });
+
+  c.on('connect', function() {
+    c.write('mid');
+    c.sendFile(fd, 100, 1000, function(err) {
+      assert.ok(!err);
+      sendFileCallbacks++;
+    });
+    // nothing to send still completes in order
+    c.sendFile(fd, 0, 0, function(err) {
+      assert.ok(!err);
+      assert.equal(sendFileCallbacks, 2);
+      sendFileCallbacks++;
+    });
+    c.end('tail');
+  });
+});
+
+process.on('exit', function() {
+  fs.closeSync(fd);
+  assert.equal(sendFileCallbacks, 3);
+
+  var total = 0;
+  chunks.forEach(function(c) { total += c.length; });
+  var received = new Buffer(total);
+  var offset = 0;
+  chunks.forEach(function(c) {
+    c.copy(received, offset);
+    offset += c.length;
+  });
+
+  assert.equal(received.length, 4 + data.length + 3 + 1000 + 4);
+  assert.equal(received.toString('binary', 0, 4), 'head');
+  assert.equal(received.slice(4, 4 + data.length).toString('base64'),
+               data.toString('base64'));
+  offset = 4 + data.length;
+  assert.equal(received.toString('binary', offset, offset + 3), 'mid');
+  offset += 3;
+  assert.equal(received.slice(offset, offset + 1000).toString('base64'),
+               data.slice(100, 1100).toString('base64'));
+  assert.equal(received.toString('binary', offset + 1000), 'tail');
+});
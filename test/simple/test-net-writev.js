@@ -0,0 +1,73 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net_uv');
+
+var expected = 'queued' + 'ab' + 'cdé' + 'hi' + 'hi' + 'corked' + 'xy' + 'z' + 'end';
+var received = '';
+var writevCallbacks = 0;
+var corkCallbacks = 0;
+
+var server = net.createServer(function(socket) {
+  socket.setEncoding('utf8');
+  socket.on('data', function(d) {
+    received += d;
+  });
+  socket.on('end', function() {
+    socket.end();
+    server.close();
+  });
+});
+
+server.listen(common.PORT, function() {
+  var c = net.createConnection(common.PORT);
+
+  // still connecting, goes through the connect queue
+  c.writev(['que', new Buffer('ued')]);
+
+  c.on('connect', function() {
+    // strings in several encodings mixed with Buffers, empty chunks dropped
+    var ret = c.writev([new Buffer('ab'), '', 'cdé', '6869', 'aGk='],
+                       ['utf8', 'utf8', 'utf8', 'hex', 'base64'],
+                       function() { writevCallbacks++; });
+    assert.equal(typeof ret, 'boolean');
+
+    // nested corks flush on the outermost uncork
+    c.cork();
+    c.write('cor');
+    c.writev([new Buffer('ked')]);
+    c.cork();
+    c.write('xy', function() { corkCallbacks++; });
+    assert.equal(c.uncork(), false);
+    c.write(new Buffer('z'), function() { corkCallbacks++; });
+    c.uncork();
+
+    c.end('end');
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(received, expected);
+  assert.equal(writevCallbacks, 1);
+  assert.equal(corkCallbacks, 2);
+});
@@ -0,0 +1,57 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+function checkHistogram(h) {
+  assert.equal(typeof h.count, 'number');
+  assert.equal(typeof h.sum, 'number');
+  assert.ok(h.max <= h.sum);
+  assert.equal(h.buckets.length, 16);
+  var total = h.buckets.reduce(function(a, b) { return a + b; }, 0);
+  assert.equal(total, h.count);
+}
+
+function checkStats(stats) {
+  assert.ok(stats.loops >= 1);
+  checkHistogram(stats.poll);
+  ['EV_START', 'EV_POLL', 'EV_PENDING', 'EV_WATCHER'].forEach(function(c) {
+    checkHistogram(stats.lockWait[c]);
+  });
+  checkHistogram(stats.invokePending);
+  checkHistogram(stats.pendingCallbacks);
+  checkHistogram(stats.tick);
+}
+
+var before = process.loopStats();
+checkStats(before);
+
+process.nextTick(function() {
+  setTimeout(function() {
+    var after = process.loopStats();
+    checkStats(after);
+    assert.ok(after.invokePending.count > before.invokePending.count);
+    assert.ok(after.pendingCallbacks.sum > before.pendingCallbacks.sum);
+    assert.ok(after.tick.count > before.tick.count);
+    assert.ok(after.lockWait.EV_WATCHER.count > before.lockWait.EV_WATCHER.count);
+  }, 10);
+});
@@ -0,0 +1,50 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var spawn = require('child_process').spawn;
+
+if (process.argv[2] === 'child') {
+  // verbose, below the default level, only ends up in the trace
+  process.log(2, 'trace marker %d');
+  console.log(process.traceDump());
+  return;
+}
+
+var env = {};
+for (var k in process.env) env[k] = process.env[k];
+env.NODE_TRACE = '64';
+delete env.NODE_DEBUG;
+
+var child = spawn(process.execPath, [__filename, 'child'], { env: env });
+var out = '';
+child.stdout.setEncoding('utf8');
+child.stdout.on('data', function(d) { out += d; });
+child.on('exit', function(code) {
+  assert.equal(code, 0);
+  assert.ok(/T\d+ [\d.]+ V\/node-js: trace marker %d/.test(out), out);
+});
+
+// off by default
+if (!process.env.NODE_TRACE) {
+  assert.equal(process.traceDump(), '');
+}
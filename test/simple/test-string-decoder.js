@@ -82,3 +82,31 @@ for (var j = 2; j < buffer.length; j++) {
 }
 console.log(' crayon!');
 
+// large ascii and mixed chunks, and the spelling of the encoding
+decoder = new StringDecoder('UTF-8');
+assert.equal(decoder.encoding, 'utf8');
+var ascii = new Array(100001).join('x');
+assert.equal(decoder.write(new Buffer(ascii)), ascii);
+var mixed = new Array(1001).join('a€b');
+buffer = new Buffer(mixed);
+assert.equal(decoder.write(buffer.slice(0, 3002)) +
+             decoder.write(buffer.slice(3002)), mixed);
+
+// ucs2, split within a unit and within a surrogate pair
+expected = 'a\ud83d\ude00b';
+buffer = new Buffer([0x61, 0x00, 0x3d, 0xd8, 0x00, 0xde, 0x62, 0x00]);
+for (var i = 1; i < buffer.length; i++) {
+  decoder = new StringDecoder('ucs2');
+  assert.equal(decoder.encoding, 'ucs2');
+  var first = decoder.write(buffer.slice(0, i));
+  assert.equal(first, expected.slice(0, i < 2 ? 0 : i < 6 ? 1 : 3));
+  assert.equal(first + decoder.write(buffer.slice(i)), expected);
+}
+
+// stateless encodings
+decoder = new StringDecoder('hex');
+assert.equal(decoder.write(new Buffer([0xde, 0xad])), 'dead');
+decoder = new StringDecoder('base64');
+assert.equal(decoder.write(new Buffer('node')), 'bm9kZQ==');
+
+assert.throws(function() { new StringDecoder('utf8').write('x'); }, TypeError);
@@ -0,0 +1,89 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net_uv');
+
+var before = process.readPoolStats();
+assert.equal(before.slabSize, 1024 * 1024);
+
+var big = new Buffer(300 * 1024);
+for (var i = 0; i < big.length; i++) big[i] = i % 251;
+
+var chunks = [];
+var received = 0;
+
+var server = net.createServer(function(socket) {
+  socket.on('data', function(d) {
+    chunks.push(d);
+    received += d.length;
+  });
+  socket.on('end', function() {
+    socket.end();
+    server.close();
+  });
+});
+
+server.listen(common.PORT, function() {
+  var c = net.createConnection(common.PORT);
+  c.on('connect', function() {
+    // a few small writes, read one at a time
+    var small = 0;
+    (function next() {
+      if (small++ < 5) {
+        c.write('small ' + small, function() { setTimeout(next, 10); });
+      } else {
+        c.end(big);
+      }
+    })();
+  });
+});
+
+process.on('exit', function() {
+  var prefix = 'small 1small 2small 3small 4small 5';
+  assert.equal(received, prefix.length + big.length);
+
+  var all = new Buffer(received);
+  var off = 0;
+  chunks.forEach(function(d) {
+    d.copy(all, off);
+    off += d.length;
+  });
+  assert.equal(all.toString('ascii', 0, prefix.length), prefix);
+  for (var i = 0; i < big.length; i++) {
+    assert.equal(all[prefix.length + i], i % 251);
+  }
+
+  var after = process.readPoolStats();
+  assert.ok(after.reads > before.reads);
+  assert.ok(after.allocs >= after.reads - before.reads);
+  // the small reads were copied out, and no reservation asked for more
+  // than 64KB
+  assert.ok(after.compacted - before.compacted >= 5);
+  assert.ok(after.reserved - before.reserved <=
+            64 * 1024 * (after.allocs - before.allocs));
+  // the big one was handed out of a slab that is still around
+  assert.ok(after.slabs >= 1);
+  assert.ok(after.used > 0);
+  assert.ok(after.pinned >= after.used);
+  assert.equal(after.pinned, after.slabs * after.slabSize);
+});
@@ -0,0 +1,65 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var timers = require('timers_uv');
+
+// an idle timeout re-armed from its own callback keeps firing
+var self = { _onTimeout: function() {
+  if (++selfFired < 3) timers.active(self);
+}};
+var selfFired = 0;
+timers.enroll(self, 10);
+timers.active(self);
+
+// two timeouts that expire in the same batch, the first one to fire re-arms
+// the other one before its callback ran. It fires once, on the new timeout,
+// and can still be removed afterwards
+var fired = [];
+var start = Date.now();
+function pair(name, other) {
+  return { _onTimeout: function() {
+    fired.push(name);
+    if (fired.length == 1) {
+      timers.active(other());
+    } else {
+      assert.ok(Date.now() - start >= 39, name + ' fired on the old timeout');
+      timers.active(this);
+      timers.unenroll(this);
+    }
+  }};
+}
+var a = pair('a', function() { return b; });
+var b = pair('b', function() { return a; });
+timers.enroll(a, 20);
+timers.enroll(b, 20);
+timers.active(a);
+timers.active(b);
+
+process.on('exit', function() {
+  assert.equal(selfFired, 3);
+  assert.equal(fired.length, 2);
+  assert.notEqual(fired[0], fired[1]);
+  assert.equal(a._timerId, -1);
+  assert.equal(b._timerId, -1);
+  assert.equal(timers.wheelStats().active, 0);
+});
@@ -0,0 +1,87 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var timers = require('timers_uv');
+
+var order = [];
+var start = Date.now();
+
+// timeouts on every level of the wheel, added out of order
+[300, 5, 70, 0, 5, 4200].forEach(function(ms, i) {
+  timers.setTimeout(function(a, b) {
+    assert.equal(a, i);
+    assert.equal(b, 'x');
+    assert.ok(Date.now() - start >= ms - 1, ms + 'ms fired early');
+    order.push(ms);
+  }, ms, i, 'x');
+});
+
+var stats = timers.wheelStats();
+assert.equal(stats.active, 6);
+assert.equal(stats.levels.length, 4);
+assert.equal(stats.levels[0].timers +
+             stats.levels[1].timers +
+             stats.levels[2].timers, 6);
+
+// cancelled before and by an earlier timeout
+var cancelled = timers.setTimeout(function() {
+  assert.fail('cleared timeout fired');
+}, 10);
+timers.clearTimeout(cancelled);
+
+var late = timers.setTimeout(function() {
+  assert.fail('cleared timeout fired');
+}, 80);
+timers.setTimeout(function() {
+  timers.clearTimeout(late);
+}, 60);
+
+// re-arming an idle timeout moves it instead of adding one
+var item = {};
+var idleFired = 0;
+item._onTimeout = function() { idleFired++; };
+timers.enroll(item, 50);
+timers.active(item);
+var added = timers.wheelStats().added;
+var bumps = 0;
+var bump = timers.setInterval(function() {
+  timers.active(item);
+  if (++bumps == 5) timers.clearInterval(bump);
+}, 20);
+assert.equal(timers.wheelStats().added, added + 1);
+
+var ticks = 0;
+var interval = timers.setInterval(function() {
+  if (++ticks == 3) timers.clearInterval(interval);
+}, 15);
+
+process.on('exit', function() {
+  assert.deepEqual(order, [0, 5, 5, 70, 300, 4200]);
+  assert.equal(ticks, 3);
+  assert.equal(bumps, 5);
+  assert.equal(idleFired, 1);
+  var stats = timers.wheelStats();
+  assert.equal(stats.active, 0);
+  assert.ok(stats.cascaded > 0);
+  assert.ok(stats.wakeups < stats.fired + 10);
+});